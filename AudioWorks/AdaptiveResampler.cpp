@@ -0,0 +1,152 @@
+//
+//  AdaptiveResampler.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "AdaptiveResampler.hpp"
+
+AdaptiveResampler::AdaptiveResampler(int nChannels, double nominal, int maxBlockLength) : numChannels(nChannels), nominalRatio(nominal), ratio(nominal) {
+
+    if (nominalRatio <= 0.0) {
+        printf("%s: Invalid ratio %f. Using 1.0\n", __PRETTY_FUNCTION__, nominalRatio);
+        nominalRatio = ratio = 1.0;
+    }
+
+    /* Enough for one maximum-length block at the fastest allowed ratio, plus the filter's reach on either side */
+    capacity = (int)ceil(maxBlockLength * nominalRatio * (1.0 + kResamplerMaxRatioDeviation)) + 2 * kResamplerTaps;
+
+    history.resize(numChannels);
+    for (int i = 0; i < numChannels; i++)
+        history[i].assign(capacity, 0.0f);
+    coefficients.resize(kResamplerTaps);
+
+    designTable();
+    reset();
+}
+
+void AdaptiveResampler::setRatio(double r) {
+
+    double lo = nominalRatio * (1.0 - kResamplerMaxRatioDeviation);
+    double hi = nominalRatio * (1.0 + kResamplerMaxRatioDeviation);
+    ratio = r < lo ? lo : (r > hi ? hi : r);
+}
+
+int AdaptiveResampler::inputNeeded(int numOutput) {
+
+    if (numOutput <= 0)
+        return 0;
+
+    /* The last output sample reads up to kResamplerTaps/2 samples past its position */
+    double last = position + (numOutput - 1) * ratio;
+    int needed = (int)floor(last) + kResamplerTaps / 2 + 1 - historyLength;
+    return needed > 0 ? needed : 0;
+}
+
+int AdaptiveResampler::write(const float *interleaved, int numFrames) {
+
+    int n = capacity - historyLength;
+    n = numFrames < n ? numFrames : n;
+
+    for (int ch = 0; ch < numChannels; ch++) {
+        float *dst = &history[ch][historyLength];
+        const float *src = interleaved + ch;
+        for (int i = 0; i < n; i++, src += numChannels)
+            dst[i] = *src;
+    }
+
+    historyLength += n;
+    return n;
+}
+
+bool AdaptiveResampler::read(float * const *output, int numOutput) {
+
+    if (inputNeeded(numOutput) > 0) {
+        for (int ch = 0; ch < numChannels; ch++)
+            memset(output[ch], 0, numOutput * sizeof(float));
+        return false;
+    }
+
+    const int halfTaps = kResamplerTaps / 2;
+
+    for (int i = 0; i < numOutput; i++) {
+
+        /* Coefficients for this fractional position, interpolated between the two nearest phases */
+        int base = (int)floor(position);
+        double phase = (position - base) * kResamplerPhases;
+        int p = (int)phase;
+        float a = (float)(phase - p);
+        const float *h0 = &table[p * kResamplerTaps];
+        const float *h1 = h0 + kResamplerTaps;
+        for (int k = 0; k < kResamplerTaps; k++)
+            coefficients[k] = h0[k] + a * (h1[k] - h0[k]);
+
+        /* Same coefficients for every channel */
+        int first = base - halfTaps + 1;
+        for (int ch = 0; ch < numChannels; ch++) {
+            const float *x = &history[ch][first];
+            float sum = 0.0f;
+            for (int k = 0; k < kResamplerTaps; k++)
+                sum += coefficients[k] * x[k];
+            output[ch][i] = sum;
+        }
+
+        position += ratio;
+    }
+
+    /* Discard input no future output sample can reach */
+    int consumed = (int)floor(position) - halfTaps + 1;
+    if (consumed > 0) {
+        for (int ch = 0; ch < numChannels; ch++)
+            memmove(&history[ch][0], &history[ch][consumed], (historyLength - consumed) * sizeof(float));
+        historyLength -= consumed;
+        position -= consumed;
+    }
+
+    return true;
+}
+
+void AdaptiveResampler::reset() {
+
+    /* Start with half a filter of silence so the first output sample has something to look back at */
+    historyLength = kResamplerTaps / 2 - 1;
+    for (int ch = 0; ch < numChannels; ch++)
+        memset(&history[ch][0], 0, historyLength * sizeof(float));
+    position = historyLength;
+}
+
+#pragma mark - Private Methods
+/* Blackman-windowed sinc, one row per fractional delay p/kResamplerPhases. Row p, tap k weights the input sample (k - kResamplerTaps/2 + 1 - p/kResamplerPhases) samples from the output position. */
+void AdaptiveResampler::designTable() {
+
+    /* Cutoff a little below the lower of the two Nyquist frequencies, in cycles per input sample */
+    double cutoff = 0.45 * (nominalRatio > 1.0 ? 1.0 / nominalRatio : 1.0);
+    const int halfTaps = kResamplerTaps / 2;
+
+    table.resize((kResamplerPhases + 1) * kResamplerTaps);
+
+    for (int p = 0; p <= kResamplerPhases; p++) {
+
+        double frac = (double)p / kResamplerPhases;
+        double sum = 0.0;
+
+        for (int k = 0; k < kResamplerTaps; k++) {
+
+            double t = k - halfTaps + 1 - frac;                     // Distance from the output position
+            double x = 2.0 * cutoff * t;
+            double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double w = (t + halfTaps) / kResamplerTaps;             // Window position in [0, 1]
+            double blackman = 0.42 - 0.5 * cos(2.0 * M_PI * w) + 0.08 * cos(4.0 * M_PI * w);
+            blackman = w < 0.0 || w > 1.0 ? 0.0 : blackman;
+
+            table[p * kResamplerTaps + k] = (float)(sinc * blackman);
+            sum += sinc * blackman;
+        }
+
+        /* Unity gain at DC for every phase */
+        for (int k = 0; k < kResamplerTaps; k++)
+            table[p * kResamplerTaps + k] /= sum;
+    }
+}
@@ -0,0 +1,65 @@
+//
+//  AdaptiveResampler.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef AdaptiveResampler_hpp
+#define AdaptiveResampler_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#define kResamplerTaps (16)             // Sinc taps per output sample
+#define kResamplerPhases (64)           // Filter table resolution; coefficients between phases are interpolated linearly
+#define kResamplerMaxRatioDeviation (0.01)  // How far setRatio() may stray from the nominal ratio
+
+/* Multichannel sample rate converter whose ratio can change from block to block, for tracking clock drift between devices.
+
+    Each output sample is a kResamplerTaps-point windowed-sinc interpolation of the input at a fractional position. Coefficients come from a polyphase table interpolated between neighboring phases, and are computed once per output sample and shared by all channels. The cutoff is set from the nominal ratio, so small ratio changes don't need a new table. All buffers are allocated up front; nothing here allocates after construction. */
+class AdaptiveResampler {
+
+    int numChannels;
+    int capacity;                   // Input frames we can buffer
+    double nominalRatio;            // Input samples per output sample
+    double ratio;
+
+    std::vector<float> table;       // (kResamplerPhases + 1) rows of kResamplerTaps coefficients
+    std::vector<std::vector<float> > history;   // Buffered input per channel
+    int historyLength;
+    double position;                // Input position of the next output sample, relative to history[0]
+    std::vector<float> coefficients;
+
+#pragma mark - Private Methods
+    void designTable();
+
+public:
+
+    /* ratio is input rate / output rate. maxBlockLength is the longest output block read() will be asked for. */
+    AdaptiveResampler(int nChannels, double nominal, int maxBlockLength);
+
+    /* Set the current ratio, within kResamplerMaxRatioDeviation of nominal */
+    void setRatio(double r);
+
+    /* Input frames write() must supply before read() can produce numOutput frames at the current ratio */
+    int inputNeeded(int numOutput);
+
+    /* Append interleaved input frames. Returns the number accepted. */
+    int write(const float *interleaved, int numFrames);
+
+    /* Produce numOutput frames into one row per channel. Returns false (and outputs silence) if there wasn't enough input. */
+    bool read(float * const *output, int numOutput);
+
+    /* Drop buffered input and start over */
+    void reset();
+
+    double getRatio() { return ratio; }
+    double getNominalRatio() { return nominalRatio; }
+    int getBufferedFrames() { return historyLength; }
+};
+
+#endif /* AdaptiveResampler_hpp */
@@ -23,8 +23,21 @@
 @property NSWindow *scopeWindow;
 @property ScopeViewController *scopeViewController;
 
+/* Periodically lets the audio controller adjust its buffer length, and picks up latency measurements */
+@property NSTimer *latencyTunerClock;
+@property bool latencyMeasurementPending;
+
 - (IBAction)openPreferencesWindow:(id)sender;
 - (IBAction)openScopeWindow:(id)sender;
+- (IBAction)showChannelDelays:(id)sender;
+- (IBAction)showAudioFeatures:(id)sender;
+- (IBAction)measureRoundTripLatency:(id)sender;
+- (IBAction)showBufferLengthDecisions:(id)sender;
+- (IBAction)addAggregateInputDevice:(id)sender;
+- (IBAction)addAggregateInputFile:(id)sender;
+- (IBAction)removeAggregateInputs:(id)sender;
+- (IBAction)showAggregateInputStatus:(id)sender;
+- (void)serviceLatencyTuner;
 
 @end
 
@@ -19,6 +19,8 @@
 @synthesize preferencesViewController;
 @synthesize scopeWindow;
 @synthesize scopeViewController;
+@synthesize latencyTunerClock;
+@synthesize latencyMeasurementPending;
 
 - (void)applicationDidFinishLaunching:(NSNotification *)aNotification {
     
@@ -43,12 +45,29 @@
 //    NSLog(@"%s: %@", __PRETTY_FUNCTION__, [scopeWindow.contentView constraintsAffectingLayoutForOrientation:NSLayoutConstraintOrientationHorizontal]);
     
     [self openScopeWindow:self];
+    
+    latencyTunerClock = [NSTimer scheduledTimerWithTimeInterval:0.25
+                                                         target:self
+                                                       selector:@selector(serviceLatencyTuner)
+                                                       userInfo:nil
+                                                        repeats:YES];
 }
 
 - (void)applicationWillTerminate:(NSNotification *)aNotification {
     // Insert code here to tear down your application
 }
 
+- (void)serviceLatencyTuner {
+    
+    audioController->serviceLatencyTuner();
+    
+    LatencyMeasurement result;
+    if (latencyMeasurementPending && audioController->getLatencyMeasurement(&result)) {
+        latencyMeasurementPending = false;
+        [self showLatencyMeasurement:result];
+    }
+}
+
 - (IBAction)openPreferencesWindow:(id)sender {
     [preferencesWindow makeKeyAndOrderFront:preferencesWindow];
 }
@@ -57,6 +76,270 @@
     [scopeWindow makeKeyAndOrderFront:scopeWindow];
 }
 
+/* Delay of every input channel relative to the first, from the scope's cross-channel analyzer */
+- (IBAction)showChannelDelays:(id)sender {
+    
+    int nChannels = audioController->getNumInputChannels();
+    NSMutableString *text = [NSMutableString string];
+    float delay, peak, coherence;
+    
+    for (int i = 1; i < nChannels; i++) {
+        if ([scopeViewController getDelayOfChannel:i relativeTo:0 delay:&delay peak:&peak coherence:&coherence])
+            [text appendFormat:@"Channel %d: %+.3f ms (peak %.2f, coherence %.2f)\n", i+1, delay * 1000.0f, peak, coherence];
+    }
+    
+    if (nChannels < 2)
+        [text appendString:@"Open at least two input channels to compare them."];
+    else if (!audioController->streamIsActive())
+        [text appendString:@"\nThe stream isn't running, so these are from the recording history only."];
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setMessageText:@"Delays Relative to Channel 1"];
+    [alert setInformativeText:text];
+    [alert runModal];
+}
+
+/* Latest spectral features and onset count of every input channel, from the scope's feature log */
+- (IBAction)showAudioFeatures:(id)sender {
+    
+    int nChannels = audioController->getNumInputChannels();
+    NSMutableString *text = [NSMutableString string];
+    FeatureEvent event;
+    unsigned long nOnsets;
+    
+    for (int i = 0; i < nChannels; i++) {
+        if ([scopeViewController getFeaturesOfChannel:i latest:&event onsets:&nOnsets])
+            [text appendFormat:@"Channel %d: %.1f dBFS, centroid %.0f Hz, rolloff %.0f Hz, %lu onsets\n", i+1, 20.0f * log10f(event.rms + 1e-9f), event.centroid, event.rolloff, nOnsets];
+        else
+            [text appendFormat:@"Channel %d: no features yet\n", i+1];
+    }
+    
+    if (!audioController->streamIsActive())
+        [text appendString:@"\nThe stream isn't running."];
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setMessageText:@"Audio Features"];
+    [alert setInformativeText:text];
+    [alert runModal];
+}
+
+#pragma mark - Latency Measurement
+/* Play a test sequence on an output channel and listen for it on an input channel. Connect them with a cable (or put a microphone by the speaker) first. */
+- (IBAction)measureRoundTripLatency:(id)sender {
+    
+    if (!audioController->streamIsActive() || audioController->latencyMeasurementInProgress()) {
+        NSAlert *alert = [[NSAlert alloc] init];
+        [alert setMessageText:@"Can't measure latency now"];
+        [alert setInformativeText:audioController->streamIsActive() ? @"A measurement is already running." : @"Start audio in Preferences first."];
+        [alert runModal];
+        return;
+    }
+    
+    NSView *channels = [[NSView alloc] initWithFrame:NSMakeRect(0, 0, 260, 56)];
+    NSPopUpButton *outputSelector = [[NSPopUpButton alloc] initWithFrame:NSMakeRect(0, 30, 260, 26) pullsDown:NO];
+    NSPopUpButton *inputSelector = [[NSPopUpButton alloc] initWithFrame:NSMakeRect(0, 0, 260, 26) pullsDown:NO];
+    for (int i = 0; i < audioController->getNumOutputChannels(); i++)
+        [outputSelector addItemWithTitle:[NSString stringWithFormat:@"Output channel %d", i+1]];
+    for (int i = 0; i < audioController->getNumInputChannels(); i++)
+        [inputSelector addItemWithTitle:[NSString stringWithFormat:@"Input channel %d", i+1]];
+    [channels addSubview:outputSelector];
+    [channels addSubview:inputSelector];
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setMessageText:@"Measure Round-Trip Latency"];
+    [alert setInformativeText:@"A noise burst about 12 dB below full scale will replace the output channel's audio for about a second. Connect it to the input channel first."];
+    [alert setAccessoryView:channels];
+    [alert addButtonWithTitle:@"Measure"];
+    [alert addButtonWithTitle:@"Cancel"];
+    if ([alert runModal] != NSAlertFirstButtonReturn)
+        return;
+    
+    latencyMeasurementPending = audioController->startLatencyMeasurement((int)[outputSelector indexOfSelectedItem], (int)[inputSelector indexOfSelectedItem]);
+}
+
+- (void)showLatencyMeasurement:(LatencyMeasurement)result {
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    if (result.valid) {
+        [alert setMessageText:[NSString stringWithFormat:@"Round-trip latency: %.2f ms (%.1f frames)", result.latencySeconds * 1000.0, result.latencyFrames]];
+        [alert setInformativeText:[NSString stringWithFormat:@"The host reports %.2f ms. Peak ratio %.1f%@.", result.reportedSeconds * 1000.0, result.peakRatio, result.inverted ? @", polarity inverted" : @""]];
+    }
+    else {
+        [alert setMessageText:@"Couldn't measure the round-trip latency"];
+        [alert setInformativeText:@"The test sequence wasn't found clearly on the input. Check the loopback connection and levels."];
+    }
+    [alert runModal];
+}
+
+#pragma mark - Buffer Length Tuning
+/* The latency tuner's decisions, with a button to pin the current buffer length for the show (or release it) */
+- (IBAction)showBufferLengthDecisions:(id)sender {
+    
+    const std::vector<LatencyTunerDecision> &decisions = audioController->getLatencyDecisionLog();
+    float sampleRate = audioController->getSampleRate();
+    int bufferLength = audioController->getAudioBufferLength();
+    bool pinned = audioController->getAudioBufferLengthPinned();
+    
+    NSMutableString *text = [NSMutableString string];
+    for (int i = 0; i < (int)decisions.size(); i++)
+        [text appendFormat:@"%9.1f s  %4d -> %4d  %s\n", decisions[i].frame / sampleRate, decisions[i].fromBufferLength, decisions[i].toBufferLength, decisions[i].reason.c_str()];
+    if (decisions.empty())
+        [text appendString:@"No decisions yet. Turn on \"Auto-tune latency\" in Preferences to let the tuner choose a buffer length."];
+    
+    NSScrollView *scrollView = [[NSScrollView alloc] initWithFrame:NSMakeRect(0, 0, 480, 200)];
+    NSTextView *textView = [[NSTextView alloc] initWithFrame:NSMakeRect(0, 0, 480, 200)];
+    [textView setEditable:NO];
+    [textView setFont:[NSFont userFixedPitchFontOfSize:11.0]];
+    [textView setString:text];
+    [scrollView setDocumentView:textView];
+    [scrollView setHasVerticalScroller:YES];
+    [textView scrollToEndOfDocument:nil];
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setMessageText:@"Buffer Length Decisions"];
+    [alert setInformativeText:[NSString stringWithFormat:@"The buffer length is %d frames (%.2f ms)%@.", bufferLength, 1000.0f * bufferLength / sampleRate, pinned ? @", pinned" : @""]];
+    [alert setAccessoryView:scrollView];
+    [alert addButtonWithTitle:@"Close"];
+    [alert addButtonWithTitle:pinned ? @"Unpin" : [NSString stringWithFormat:@"Pin %d Frames", bufferLength]];
+    if ([alert runModal] != NSAlertSecondButtonReturn)
+        return;
+    
+    if (pinned)
+        audioController->unpinAudioBufferLength();
+    else if (!audioController->pinAudioBufferLength(bufferLength)) {
+        NSAlert *failure = [[NSAlert alloc] init];
+        [failure setMessageText:[NSString stringWithFormat:@"Couldn't pin the buffer length at %d frames", bufferLength]];
+        [failure setInformativeText:@"The audio devices didn't accept it."];
+        [failure runModal];
+    }
+}
+
+#pragma mark - Aggregate Inputs
+/* Aggregate inputs can only change while the stream is closed. Close it, make the change, and put the stream back the way it was. Returns the change's result. */
+- (bool)changeWithStreamClosed:(bool (^)(void))change {
+    
+    bool streamWasActive = audioController->streamIsActive();
+    bool streamWasOpen = audioController->streamIsOpen();
+    if (streamWasActive) audioController->stopStream();
+    if (streamWasOpen) audioController->closeStream();
+    
+    bool success = change();
+    
+    bool reopened = true;
+    if (streamWasOpen) reopened &= audioController->openStream();
+    if (streamWasActive && reopened) reopened &= audioController->startStream();
+    
+    if (!reopened) {
+        NSAlert *alert = [[NSAlert alloc] init];
+        [alert setMessageText:@"Couldn't restart audio"];
+        [alert setInformativeText:@"The stream didn't reopen with the new aggregate inputs. Remove them or choose other devices in Preferences."];
+        [alert runModal];
+    }
+    
+    return success;
+}
+
+- (void)showAggregateInputError:(NSString *)message {
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setMessageText:message];
+    [alert setInformativeText:[NSString stringWithFormat:@"Aggregate inputs add up to %d channels in total, and a device can't be both the primary and an aggregate input.", kMaxNumAudioChannels]];
+    [alert runModal];
+}
+
+/* Add every channel of another input device (as many as fit) after the primary input's */
+- (IBAction)addAggregateInputDevice:(id)sender {
+    
+    std::map<PaDeviceIndex, std::string> devNames = audioController->getAvailableInputDeviceNames();
+    PaDeviceIndex primary = audioController->getSelectedInputDeviceIdx();
+    
+    NSPopUpButton *deviceSelector = [[NSPopUpButton alloc] initWithFrame:NSMakeRect(0, 0, 260, 26) pullsDown:NO];
+    for (auto it = devNames.begin(); it != devNames.end(); ++it) {
+        if (it->first == primary)
+            continue;
+        [deviceSelector addItemWithTitle:[NSString stringWithFormat:@"%s", it->second.c_str()]];
+        [[deviceSelector lastItem] setTag:it->first];
+    }
+    
+    if ([deviceSelector numberOfItems] == 0) {
+        [self showAggregateInputError:@"No other input devices"];
+        return;
+    }
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setMessageText:@"Add Aggregate Input Device"];
+    [alert setInformativeText:@"Its channels are added after the current input channels, resampled onto the primary input device's clock."];
+    [alert setAccessoryView:deviceSelector];
+    [alert addButtonWithTitle:@"Add"];
+    [alert addButtonWithTitle:@"Cancel"];
+    if ([alert runModal] != NSAlertFirstButtonReturn)
+        return;
+    
+    PaDeviceIndex idx = (PaDeviceIndex)[deviceSelector selectedTag];
+    int nChannels = std::min(audioController->getMaxNumInputChannels(idx), kMaxNumAudioChannels - audioController->getNumInputChannels());
+    
+    bool added = [self changeWithStreamClosed:^bool {
+        return audioController->addAggregateInputDevice(idx, nChannels) >= 0;
+    }];
+    
+    if (!added)
+        [self showAggregateInputError:[NSString stringWithFormat:@"Couldn't add %@", [deviceSelector titleOfSelectedItem]]];
+}
+
+/* Add a WAV file as a stand-in input device, optionally with its clock offset to exercise drift compensation */
+- (IBAction)addAggregateInputFile:(id)sender {
+    
+    NSTextField *offsetField = [[NSTextField alloc] initWithFrame:NSMakeRect(0, 0, 260, 22)];
+    [offsetField setPlaceholderString:@"Clock offset in ppm (default 0)"];
+    
+    NSOpenPanel *panel = [NSOpenPanel openPanel];
+    [panel setAllowedFileTypes:@[@"wav"]];
+    [panel setAllowsMultipleSelection:NO];
+    [panel setMessage:@"Choose a WAV file to add as an aggregate input"];
+    [panel setAccessoryView:offsetField];
+    if ([panel runModal] != NSModalResponseOK)
+        return;
+    
+    std::string path = [[[panel URL] path] UTF8String];
+    double offsetPPM = [offsetField doubleValue];
+    
+    bool added = [self changeWithStreamClosed:^bool {
+        return audioController->addAggregateInputFile(path, offsetPPM) >= 0;
+    }];
+    
+    if (!added)
+        [self showAggregateInputError:[NSString stringWithFormat:@"Couldn't add %@", [[panel URL] lastPathComponent]]];
+}
+
+- (IBAction)removeAggregateInputs:(id)sender {
+    
+    [self changeWithStreamClosed:^bool {
+        audioController->removeAggregateInputs();
+        return true;
+    }];
+}
+
+/* Drift and FIFO health of each aggregate input */
+- (IBAction)showAggregateInputStatus:(id)sender {
+    
+    int nSources = audioController->getNumAggregateInputs();
+    NSMutableString *text = [NSMutableString string];
+    
+    for (int i = 0; i < nSources; i++) {
+        AggregateSourceStatus status = audioController->getAggregateInputStatus(i);
+        [text appendFormat:@"%s: %d ch, %.0f Hz nominal, %.2f Hz measured (%+.1f ppm), ratio %.6f, FIFO %.0f frames, %lu underflows, %lu overflows\n",
+         status.name.c_str(), status.numChannels, status.nominalRate, status.measuredRate, status.driftPPM, status.ratio, status.fifoFill, status.underflows, status.overflows];
+    }
+    
+    if (nSources == 0)
+        [text appendString:@"No aggregate inputs. Add a device or file from the Audio menu."];
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setMessageText:@"Aggregate Inputs"];
+    [alert setInformativeText:text];
+    [alert runModal];
+}
+
 @end
 
 
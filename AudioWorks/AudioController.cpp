@@ -8,13 +8,32 @@
 
 #include "AudioController.hpp"
 
-AudioController::AudioController() : audioBufferLength(kDefaultAudioBufferLength), _streamIsOpen(false), numInputChannels(0), numOutputChannels(0), sampleRate(kDefaultAudioSampleRate), recordingBufferLength(kRecordingBufferDuration * kDefaultAudioSampleRate), numRecordingBuffers(0), outputGain(1.0) {
+AudioController::AudioController() : audioBufferLength(kDefaultAudioBufferLength), _streamIsOpen(false), numInputChannels(0), numPrimaryInputChannels(0), numOutputChannels(0), sampleRate(kDefaultAudioSampleRate), recordingBufferLength(kRecordingBufferDuration * kDefaultAudioSampleRate), numRecordingBuffers(0), numRecordedFrames(0), recordingWriteEnd(0), recordingReaders(0), recordingBuffersValid(false), roundTripLatency(0.0), lowLatencyMode(false), pendingBufferLength(0) {
     
-    recBufferMutex = new pthread_mutex_t;
+    timeline = new CaptureTimeline();
+    latencyProbe = new LatencyProbe();
+    
+    latencyTuner = new LatencyTuner(audioBufferLength);
+    aggregator = new DeviceAggregator();
+    history = NULL;
+    historyEnabled = false;
+    
+    parameters = new ParameterAutomation(kNumAudioParameters, sampleRate);
+    parameters->setInitialValue(kAudioParameterOutputGain, 1.0f);
+    parameters->setInitialValue(kAudioParameterMute, 1.0f);
+    resetCallbackStatistics();
     
     /* Initialize portaudio, get available devices, and initialize input stream info */
     paSetup();
     allocateRecordingBuffers(false);
+    
+    /* Compressed history is opt-in (setHistoryEnabled()); it can hold a lot of memory */
+    history = new CompressedHistory(this);
+    
+    /* Start from cached device capabilities and re-probe in the background */
+    capabilityCache = new DeviceCapabilityCache(capabilityCachePath(), &portAudioMutex);
+    capabilityCache->load();
+    capabilityCache->revalidate();
 }
 
 AudioController::~AudioController() {
@@ -24,9 +43,18 @@ AudioController::~AudioController() {
     if (_streamIsOpen)
         Pa_AbortStream(stream);
     
+    delete history;             // Stops the encoder before the recording buffers go away
+    delete aggregator;          // Closes any secondary streams
+    delete capabilityCache;     // Stops any background probing before we terminate portaudio
+    
     error = Pa_Terminate();
     if (error != paNoError)
         printf("%s: PaError = %s\n", __PRETTY_FUNCTION__, Pa_GetErrorText(error));
+    
+    delete latencyTuner;
+    delete parameters;
+    delete latencyProbe;
+    delete timeline;
 }
 
 #pragma mark - Private Methods
@@ -76,6 +104,15 @@ PaError AudioController::paSetup() {
 
 void AudioController::allocateRecordingBuffers(bool reallocate) {
    
+    /* The history encoder reads the recording buffers, so stop it while they change */
+    if (history)
+        history->stop();
+    
+    /* Turn away new readers and wait for any that are mid-copy */
+    recordingBuffersValid = false;
+    while (recordingReaders > 0)
+        std::this_thread::yield();
+    
     recordingBufferLength = (int)kRecordingBufferDuration * sampleRate;
     
     /* Delete old buffers if we're reallocating. */
@@ -85,41 +122,92 @@ void AudioController::allocateRecordingBuffers(bool reallocate) {
         delete [] recBuffers;           // Delete row pointer array
     }
     
-    printf("nInputChannels = %d, numRecordingBuffers = %d\n", numInputChannels, numRecordingBuffers);
-    /* If we're allocating new channels, create a mutex for each new channel. */
-    if (numRecordingBuffers < numInputChannels) {
-        for (int i = numRecordingBuffers; i < numInputChannels; i++) {
-            pthread_mutex_init(&recBufferMutex[i], NULL);
-            printf("%s: new mutex for channel %d\n", __PRETTY_FUNCTION__, i);
-        }
-    }
-    
-    /* Allocate a recording buffer for each input channel */
+    /* Allocate a (silent) recording buffer for each input channel */
     recBuffers = new SAMPLE *[numInputChannels];
-    for (int i = 0; i < numInputChannels; i++) {
-        recBuffers[i] = new SAMPLE[recordingBufferLength];
-    }
+    for (int i = 0; i < numInputChannels; i++)
+        recBuffers[i] = new SAMPLE[recordingBufferLength]();
+    numRecordedFrames = 0;
+    recordingWriteEnd = 0;
+    timeline->reset(sampleRate);
     
     numRecordingBuffers = numInputChannels;
+    recordingBuffersValid = true;
+    
+    /* Frame numbering starts over, so the old history no longer lines up */
+    if (history) {
+        history->reset();
+        if (historyEnabled)
+            history->start();
+    }
 }
 
-void AudioController::appendToRecordingBuffer(SAMPLE *inBuffer, int channel, int length) {
+/* Append a block to every channel's ring. Readers don't lock: recordingWriteEnd tells them which frames might have been overwritten while they copied. */
+void AudioController::writeRecordingBuffers(SAMPLE * const *inBuffers, int length) {
     
-    if (channel >= numInputChannels) {
-        printf("%s: Invalid input channel index %d. %d input channels open.\n", __PRETTY_FUNCTION__, channel, numInputChannels);
-        return;
+    unsigned long long start = numRecordedFrames.load(std::memory_order_relaxed);
+    recordingWriteEnd.store(start + length, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    int idx = (int)(start % recordingBufferLength);
+    int first = recordingBufferLength - idx < length ? recordingBufferLength - idx : length;
+    
+    for (int j = 0; j < numInputChannels; j++) {
+        memcpy(&recBuffers[j][idx], inBuffers[j], first * sizeof(SAMPLE));
+        memcpy(&recBuffers[j][0], inBuffers[j] + first, (length - first) * sizeof(SAMPLE));
     }
-    if (length >= recordingBufferLength) {
-        printf("%s: Invalid requested buffer length %d. Recording buffer length = %d\n", __PRETTY_FUNCTION__, length, recordingBufferLength);
+    
+    numRecordedFrames.store(start + length, std::memory_order_release);
+}
+
+/* Copy frames [startFrame, startFrame + length) of channels [firstChannel, firstChannel + nChannels) into outBuffers. Every channel is read at the same sample positions; frames we don't have (or that were overwritten while we copied) read as zeros in every channel. */
+void AudioController::readRecordingBuffers(SAMPLE * const *outBuffers, int firstChannel, int nChannels, long long startFrame, int length) {
+    
+    /* The buffers are being reallocated, or no longer have these channels */
+    recordingReaders++;
+    if (!recordingBuffersValid || firstChannel + nChannels > numRecordingBuffers) {
+        recordingReaders--;
+        for (int j = 0; j < nChannels; j++)
+            memset(outBuffers[j], 0, length * sizeof(SAMPLE));
         return;
     }
     
-    pthread_mutex_lock(&recBufferMutex[channel]);
-    for (int i = 0; i < recordingBufferLength - length; i++)
-        recBuffers[channel][i] = recBuffers[channel][i+length];             // Shift old values back
-    for (int i = 0; i < length; i++)
-        recBuffers[channel][recordingBufferLength - (length-i)] = inBuffer[i];    // Append new values to the front
-    pthread_mutex_unlock(&recBufferMutex[channel]);
+    long long end = (long long)numRecordedFrames.load(std::memory_order_acquire);
+    long long begin = end - recordingBufferLength;
+    begin = begin > 0 ? begin : 0;
+    
+    long long copyStart = startFrame > begin ? startFrame : begin;
+    long long copyEnd = startFrame + length < end ? startFrame + length : end;
+    
+    for (int j = 0; j < nChannels; j++) {
+        
+        SAMPLE *out = outBuffers[j];
+        const SAMPLE *ring = recBuffers[firstChannel + j];
+        
+        if (copyEnd <= copyStart) {
+            memset(out, 0, length * sizeof(SAMPLE));
+            continue;
+        }
+        
+        memset(out, 0, (copyStart - startFrame) * sizeof(SAMPLE));
+        memset(out + (copyEnd - startFrame), 0, (startFrame + length - copyEnd) * sizeof(SAMPLE));
+        
+        int idx = (int)(copyStart % recordingBufferLength);
+        int n = (int)(copyEnd - copyStart);
+        int first = recordingBufferLength - idx < n ? recordingBufferLength - idx : n;
+        memcpy(out + (copyStart - startFrame), &ring[idx], first * sizeof(SAMPLE));
+        memcpy(out + (copyStart - startFrame) + first, &ring[0], (n - first) * sizeof(SAMPLE));
+    }
+    
+    /* Anything the callback may have started overwriting since we looked is suspect */
+    std::atomic_thread_fence(std::memory_order_acquire);
+    long long overwritten = (long long)recordingWriteEnd.load(std::memory_order_relaxed) - recordingBufferLength;
+    if (overwritten > copyStart && copyEnd > copyStart) {
+        long long zeroEnd = overwritten < copyEnd ? overwritten : copyEnd;
+        for (int j = 0; j < nChannels; j++)
+            memset(outBuffers[j] + (copyStart - startFrame), 0, (zeroEnd - copyStart) * sizeof(SAMPLE));
+    }
+    
+    recordingReaders--;
 }
 
 void AudioController::getRecordingBuffer(SAMPLE *outBuffer, int channel, int length) {
@@ -133,10 +221,7 @@ void AudioController::getRecordingBuffer(SAMPLE *outBuffer, int channel, int len
         return;
     }
     
-    pthread_mutex_lock(&recBufferMutex[channel]);
-    for (int i = 0; i < length; i++)
-        outBuffer[i] = recBuffers[channel][recordingBufferLength - (length-i)];
-    pthread_mutex_unlock(&recBufferMutex[channel]);
+    readRecordingBuffers(&outBuffer, channel, 1, (long long)numRecordedFrames - length, length);
 }
 
 void AudioController::getRecordingBuffer(SAMPLE *outBuffer, int channel, int startIdx, int endIdx) {
@@ -150,15 +235,109 @@ void AudioController::getRecordingBuffer(SAMPLE *outBuffer, int channel, int sta
         return;
     }
     
-    int length = endIdx - startIdx;
+    /* Index 0 is the oldest frame in the buffer */
+    long long oldestFrame = (long long)numRecordedFrames - recordingBufferLength;
+    readRecordingBuffers(&outBuffer, channel, 1, oldestFrame + startIdx, endIdx - startIdx);
+}
+
+/* Get samples by absolute position, where frame 0 is the first frame recorded since the buffers were allocated. Frames that have aged out of the recording buffer (or haven't been recorded yet) read as zeros. */
+void AudioController::getRecordingBufferFrom(SAMPLE *outBuffer, int channel, long long startFrame, int length) {
+    
+    if (channel >= numInputChannels) {
+        printf("%s: Invalid input channel index %d. %d input channels open.\n", __PRETTY_FUNCTION__, channel, numInputChannels);
+        return;
+    }
     
-    pthread_mutex_lock(&recBufferMutex[channel]);
-    for (int i = 0, j = startIdx; i < length; i++, j++)
-        outBuffer[i] = recBuffers[channel][j];
-    pthread_mutex_unlock(&recBufferMutex[channel]);
+    readRecordingBuffers(&outBuffer, channel, 1, startFrame, length);
 }
 
+/* Like getRecordingBufferFrom(), for channels [0, nChannels) at once, all at the same sample positions */
+void AudioController::getRecordingBuffersFrom(SAMPLE * const *outBuffers, int nChannels, long long startFrame, int length) {
+    
+    if (nChannels > numInputChannels) {
+        printf("%s: Invalid number of channels %d. %d input channels open.\n", __PRETTY_FUNCTION__, nChannels, numInputChannels);
+        return;
+    }
+    
+    readRecordingBuffers(outBuffers, 0, nChannels, startFrame, length);
+}
 
+void AudioController::getHistoryFrom(SAMPLE *outBuffer, int channel, long long startFrame, int length) {
+    
+    if (channel >= numInputChannels) {
+        printf("%s: Invalid input channel index %d. %d input channels open.\n", __PRETTY_FUNCTION__, channel, numInputChannels);
+        return;
+    }
+    
+    /* Frames from bufferStart on are still in the recording buffer (with a block of margin, since the oldest may be overwritten while we read) */
+    long long bufferStart = (long long)numRecordedFrames - recordingBufferLength + audioBufferLength;
+    long long split = startFrame + length < bufferStart ? startFrame + length : bufferStart;
+    
+    if (split > startFrame)
+        history->read(outBuffer, channel, startFrame, (int)(split - startFrame));
+    else
+        split = startFrame;
+    
+    if (split < startFrame + length)
+        getRecordingBufferFrom(outBuffer + (split - startFrame), channel, split, (int)(startFrame + length - split));
+}
+
+#pragma mark - Latency Measurement
+/* Play a maximum length sequence on an output channel and find it on an input channel (wired or acoustic loopback). The stream must be running; poll getLatencyMeasurement() for the result. */
+bool AudioController::startLatencyMeasurement(int outputChannel, int inputChannel) {
+    
+    if (outputChannel < 0 || outputChannel >= numOutputChannels) {
+        printf("%s: Invalid output channel index %d. %d output channels open.\n", __PRETTY_FUNCTION__, outputChannel, numOutputChannels);
+        return false;
+    }
+    if (inputChannel < 0 || inputChannel >= numInputChannels) {
+        printf("%s: Invalid input channel index %d. %d input channels open.\n", __PRETTY_FUNCTION__, inputChannel, numInputChannels);
+        return false;
+    }
+    if (!streamIsActive()) {
+        printf("%s: Start the stream before measuring latency\n", __PRETTY_FUNCTION__);
+        return false;
+    }
+    
+    return latencyProbe->arm(sampleRate, outputChannel, inputChannel);
+}
+
+/* Returns true once the measurement started by startLatencyMeasurement() has finished, with the result in *result. Valid results also become getRoundTripLatency(). */
+bool AudioController::getLatencyMeasurement(LatencyMeasurement *result) {
+    
+    if (latencyProbe->getState() != kLatencyProbeCaptured)
+        return false;
+    
+    int length = latencyProbe->getCaptureLength();
+
+    /* Polled too late; the capture has been overwritten */
+    if (latencyProbe->getStartFrame() < (long long)numRecordedFrames - recordingBufferLength) {
+        printf("%s: Latency capture is no longer in the recording buffers\n", __PRETTY_FUNCTION__);
+        memset(result, 0, sizeof(LatencyMeasurement));
+        latencyProbe->cancel();
+        return true;
+    }
+
+    std::vector<SAMPLE> recorded(length);
+    getRecordingBufferFrom(&recorded[0], latencyProbe->getInputChannel(), latencyProbe->getStartFrame(), length);
+    
+    *result = latencyProbe->analyze(&recorded[0]);
+    if (result->valid)
+        roundTripLatency = result->latencyFrames;
+    
+    return true;
+}
+
+long long AudioController::getOldestHistoryFrame() {
+    
+    long long bufferStart = (long long)numRecordedFrames - recordingBufferLength;
+    bufferStart = bufferStart > 0 ? bufferStart : 0;
+    if (!historyEnabled)
+        return bufferStart;
+    
+    long long historyStart = history->getOldestFrame();
+    return historyStart < bufferStart ? historyStart : bufferStart;
+}
 
 #pragma mark - Portaudio Callback
 int AudioController::processingCallback(const void* input, void* output,
@@ -166,33 +345,90 @@ int AudioController::processingCallback(const void* input, void* output,
                                         const PaStreamCallbackTimeInfo* timeInfo,
                                         PaStreamCallbackFlags statusFlags) {
 
+    std::chrono::steady_clock::time_point callbackStart = std::chrono::steady_clock::now();
+    unsigned long long blockStart = numRecordedFrames;
+    
     const SAMPLE *in = (const SAMPLE *)input;
     SAMPLE *out = (SAMPLE *)output;
 
     /* Deinterleave samples into buffer matrix with a row for each channel */
     SAMPLE inBuffers[numInputChannels][bufferLength];
     for (int i = 0; i < bufferLength; i++) {
-        for (int j = 0; j < numInputChannels; j++) {
+        for (int j = 0; j < numPrimaryInputChannels; j++) {
             inBuffers[j][i] = *in++;
         }
     }
     
-    /* Copy each channel's samples into recording buffers */
+    /* Secondary inputs fill the remaining rows, resampled onto our clock */
+    if (numInputChannels > numPrimaryInputChannels) {
+        SAMPLE *secondaryRows[numInputChannels - numPrimaryInputChannels];
+        for (int j = numPrimaryInputChannels; j < numInputChannels; j++)
+            secondaryRows[j - numPrimaryInputChannels] = inBuffers[j];
+        aggregator->pull(timeInfo, bufferLength, secondaryRows);
+    }
+    
+    /* Append to the recording buffers, and note when this block was captured and will be played */
+    SAMPLE *inRows[numInputChannels];
+    float peak = 0.0f, channelPeak;
     for (int j = 0; j < numInputChannels; j++) {
-        SAMPLE proc[bufferLength];
-        for (int i = 0; i < bufferLength; i++) {
-            proc[i] = inBuffers[j][i];
-        }
-        appendToRecordingBuffer(proc, j, (int)bufferLength);
+        inRows[j] = inBuffers[j];
+        vDSP_maxmgv(inBuffers[j], 1, &channelPeak, bufferLength);
+        peak = channelPeak > peak ? channelPeak : peak;
     }
+    writeRecordingBuffers(inRows, (int)bufferLength);
+    
+    CaptureBlockTime blockTime;
+    blockTime.frame = blockStart;
+    blockTime.length = (int)bufferLength;
+    blockTime.inputTime = timeInfo->inputBufferAdcTime;
+    blockTime.outputTime = timeInfo->outputBufferDacTime;
+    blockTime.hostTime = std::chrono::duration<double>(callbackStart.time_since_epoch()).count();
+    timeline->push(blockTime);
 
-    /* Copy input samples into output, interleaved */
-    for (int i = 0; i < bufferLength; i++) {
-        for (int j = 0; j < numOutputChannels; j++) {
-            *out++ = inBuffers[j][i] * outputGain;
+    /* Copy input samples into output, interleaved, with gain and mute. Parameters that aren't ramping apply as scalars. */
+    for (int offset = 0; offset < bufferLength; offset += kParameterMaxBlockLength) {
+        
+        int n = (int)bufferLength - offset;
+        n = n > kParameterMaxBlockLength ? kParameterMaxBlockLength : n;
+        
+        parameters->process(blockStart + offset, n);
+        const float *gainRamp = parameters->getBlockValues(kAudioParameterOutputGain);
+        const float *muteRamp = parameters->getBlockValues(kAudioParameterMute);
+        
+        if (!gainRamp && !muteRamp) {
+            float gain = parameters->getValue(kAudioParameterOutputGain) * parameters->getValue(kAudioParameterMute);
+            for (int j = 0; j < numOutputChannels; j++)
+                vDSP_vsmul(&inBuffers[j][offset], 1, &gain, out + offset * numOutputChannels + j, numOutputChannels, n);
+        }
+        else {
+            SAMPLE gains[n];
+            float scalar;
+            if (gainRamp && muteRamp)
+                vDSP_vmul(gainRamp, 1, muteRamp, 1, gains, 1, n);
+            else {
+                scalar = parameters->getValue(gainRamp ? kAudioParameterMute : kAudioParameterOutputGain);
+                vDSP_vsmul(gainRamp ? gainRamp : muteRamp, 1, &scalar, gains, 1, n);
+            }
+            for (int j = 0; j < numOutputChannels; j++)
+                vDSP_vmul(&inBuffers[j][offset], 1, gains, 1, out + offset * numOutputChannels + j, numOutputChannels, n);
         }
     }
     
+    /* A round-trip latency measurement takes over its output channel while it runs */
+    latencyProbe->render(out, numOutputChannels, blockStart, (int)bufferLength, timeInfo->outputBufferDacTime - timeInfo->inputBufferAdcTime);
+    
+    /* Statistics for the latency tuner */
+    unsigned long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callbackStart).count();
+    statCallbacks++;
+    statBusyNanoseconds += elapsed;
+    if (statusFlags & (paInputUnderflow | paInputOverflow | paOutputUnderflow | paOutputOverflow))
+        statXruns++;
+    
+    unsigned long long prevMax = statMaxNanoseconds;
+    while (elapsed > prevMax && !statMaxNanoseconds.compare_exchange_weak(prevMax, elapsed));
+    float prevPeak = statInputPeak;
+    while (peak > prevPeak && !statInputPeak.compare_exchange_weak(prevPeak, peak));
+    
     return 0;
 }
 
@@ -244,30 +480,10 @@ std::vector<float> AudioController::getSupportedSampleRates(PaDeviceIndex inputD
     if(!validateDeviceIndex(outputDeviceIndex, __PRETTY_FUNCTION__))
         return rates;
     
-    /* Standard sample rates to test */
-    static double testRates[] = {8000.0, 9600.0, 11025.0, 12000.0, 16000.0, 22050.0, 24000.0, 32000.0, 44100.0, 48000.0, 88200.0, 96000.0, 192000.0, -1.0};      // Negative-terminated array
-    
-    /* Test input stream parameters */
-    PaStreamParameters inputParams;
-    inputParams.device = inputDeviceIndex;
-    inputParams.channelCount = devices[inputParams.device]->maxInputChannels;
-    inputParams.sampleFormat = paFloat32;
-    inputParams.suggestedLatency = 0;    // Ignored by Pa_IsFormatSupported
-    inputParams.hostApiSpecificStreamInfo = NULL;
-    
-    /* Test output stream parameters */
-    PaStreamParameters outputParams;
-    outputParams.device = outputDeviceIndex;
-    outputParams.channelCount = devices[outputParams.device]->maxOutputChannels;
-    outputParams.sampleFormat = paFloat32;
-    outputParams.suggestedLatency = 0;    // Ignored by Pa_IsFormatSupported
-    outputParams.hostApiSpecificStreamInfo = NULL;
-    
-    /* Add the test rate to the input vector if supported */
-    for (int i = 0; testRates[i] > 0; i++) {
-        if (Pa_IsFormatSupported(&inputParams, &outputParams, testRates[i]) == paFormatIsSupported)
-            rates.push_back(testRates[i]);
-    }
+    /* Full channel count on both devices, from the capability cache */
+    rates = capabilityCache->getSupportedSampleRates(inputDeviceIndex, devices[inputDeviceIndex]->maxInputChannels,
+                                                     outputDeviceIndex, devices[outputDeviceIndex]->maxOutputChannels,
+                                                     paFloat32);
     
     return rates;
 }
@@ -285,9 +501,17 @@ bool AudioController::setInputDevice(PaDeviceIndex deviceIndex) {
         return false;
     }
     
+    /* A device can't be both the primary and a secondary input; remove the aggregate inputs first */
+    std::vector<PaDeviceIndex> secondaryDevices = aggregator->getDevices();
+    if (std::find(secondaryDevices.begin(), secondaryDevices.end(), deviceIndex) != secondaryDevices.end()) {
+        printf("%s: Device #%d (%s) is already an aggregate input\n", __PRETTY_FUNCTION__, deviceIndex, devices[deviceIndex]->name);
+        return false;
+    }
+    
     /* The index of the device in the input devices list may not be the same as the index in the devices list, so set the device using its actual PaDeviceIndex (second in std::pair<const PaDeviceInfo*, PaDeviceIndex>) */
     inputStreamParams.device = deviceIndex;
-    inputStreamParams.suggestedLatency = devices[inputStreamParams.device]->defaultLowInputLatency;
+    updateSuggestedLatency();
+    latencyTuner->reset();
     printf("%s: Using input device %s\n", __PRETTY_FUNCTION__, devices[inputStreamParams.device]->name);
     
     return true;
@@ -308,7 +532,8 @@ bool AudioController::setOutputDevice(PaDeviceIndex deviceIndex) {
     
     /* The index of the device in the input devices list may not be the same as the index in the devices list, so set the device using its actual PaDeviceIndex (second in std::pair<const PaDeviceInfo*, PaDeviceIndex>) */
     outputStreamParams.device = deviceIndex;
-    outputStreamParams.suggestedLatency = devices[outputStreamParams.device]->defaultLowOutputLatency;
+    updateSuggestedLatency();
+    latencyTuner->reset();
     printf("%s: Using output device %s\n", __PRETTY_FUNCTION__, devices[outputStreamParams.device]->name);
     
     return true;
@@ -322,34 +547,24 @@ bool AudioController::setSampleRate(float fs) {
         return false;
     }
     
-    /* Test input stream parameters */
-    PaStreamParameters inputParams;
-    inputParams.device = inputStreamParams.device;
-    inputParams.channelCount = devices[inputStreamParams.device]->maxInputChannels;
-    inputParams.sampleFormat = paFloat32;
-    inputParams.suggestedLatency = 0;    // Ignored by Pa_IsFormatSupported
-    inputParams.hostApiSpecificStreamInfo = NULL;
+    std::vector<float> rates;
     
-    if (Pa_IsFormatSupported(&inputParams, NULL, fs) != paFormatIsSupported) {
+    rates = capabilityCache->getSupportedSampleRates(inputStreamParams.device, devices[inputStreamParams.device]->maxInputChannels, paNoDevice, 0, paFloat32);
+    if (std::find(rates.begin(), rates.end(), fs) == rates.end()) {
         printf("%s: Input device %s does not support sample rate %.0f\n", __PRETTY_FUNCTION__, devices[inputStreamParams.device]->name, fs);
         return false;
     }
     
-    /* Test output stream parameters */
-    PaStreamParameters outputParams;
-    outputParams.device = outputStreamParams.device;
-    outputParams.channelCount = devices[outputStreamParams.device]->maxOutputChannels;
-    outputParams.sampleFormat = paFloat32;
-    outputParams.suggestedLatency = 0;    // Ignored by Pa_IsFormatSupported
-    outputParams.hostApiSpecificStreamInfo = NULL;
-    
-    if (Pa_IsFormatSupported(NULL, &outputParams, fs) != paFormatIsSupported) {
+    rates = capabilityCache->getSupportedSampleRates(paNoDevice, 0, outputStreamParams.device, devices[outputStreamParams.device]->maxOutputChannels, paFloat32);
+    if (std::find(rates.begin(), rates.end(), fs) == rates.end()) {
         printf("%s: Output device %s does not support sample rate %.0f\n", __PRETTY_FUNCTION__, devices[outputStreamParams.device]->name, fs);
         return false;
     }
     
     sampleRate = fs;
+    parameters->setSampleRate(fs);
     allocateRecordingBuffers(true);     // Reallocate recording buffers
+    updateSuggestedLatency();
     
     return true;
 }
@@ -362,8 +577,15 @@ bool AudioController::setNumInputChannels(int nChannels) {
         return false;
     }
     
-    numInputChannels = nChannels;
-    inputStreamParams.channelCount = numInputChannels;
+    /* Primary plus aggregate channels are capped at kMaxNumAudioChannels, which per-channel scratch elsewhere (e.g. the scope's analysis buffers) is sized for */
+    if (nChannels + aggregator->getNumChannels() > kMaxNumAudioChannels) {
+        printf("%s: Invalid number of input channels %d (+ %d aggregate). Maximum = %d\n", __PRETTY_FUNCTION__, nChannels, aggregator->getNumChannels(), kMaxNumAudioChannels);
+        return false;
+    }
+    
+    numPrimaryInputChannels = nChannels;
+    numInputChannels = numPrimaryInputChannels + aggregator->getNumChannels();
+    inputStreamParams.channelCount = numPrimaryInputChannels;
     
     allocateRecordingBuffers(true);     // Reallocate recording buffers
     
@@ -384,6 +606,215 @@ bool AudioController::setNumOutputChannels(int nChannels) {
     return true;
 }
 
+/* Set the number of frames per callback, reopening the stream if it's open */
+bool AudioController::setAudioBufferLength(int length) {
+    
+    if (length < kLatencyTunerMinBufferLength || length > kLatencyTunerMaxBufferLength) {
+        printf("%s: Invalid buffer length %d. Must be in [%d, %d]\n", __PRETTY_FUNCTION__, length, kLatencyTunerMinBufferLength, kLatencyTunerMaxBufferLength);
+        return false;
+    }
+    
+    if (length == audioBufferLength)
+        return true;
+    
+    bool streamWasActive = streamIsActive();
+    bool streamWasOpen = _streamIsOpen;
+    if (streamWasActive) stopStream();
+    if (streamWasOpen) closeStream();
+    
+    int previousLength = audioBufferLength;
+    audioBufferLength = length;
+    updateSuggestedLatency();
+    pendingBufferLength = 0;
+    
+    /* If the devices won't take the new length, go back to the one that was working */
+    bool success = reopenStream(streamWasOpen, streamWasActive);
+    if (!success) {
+        printf("%s: Couldn't reopen the stream with buffer length %d. Reverting to %d\n", __PRETTY_FUNCTION__, length, previousLength);
+        audioBufferLength = previousLength;
+        updateSuggestedLatency();
+        if (!reopenStream(streamWasOpen, streamWasActive))
+            printf("%s: Couldn't reopen the stream with buffer length %d either\n", __PRETTY_FUNCTION__, previousLength);
+    }
+    latencyTuner->setBufferLength(audioBufferLength);
+    
+    resetCallbackStatistics();
+    
+    return success;
+}
+
+/* In low-latency mode the suggested latency follows the buffer length instead of the devices' default low latency. Returns false (and stays in the previous mode) if the stream couldn't be reopened with the new latency. */
+bool AudioController::setLowLatencyMode(bool enable) {
+    
+    if (enable == lowLatencyMode)
+        return true;
+    
+    lowLatencyMode = enable;
+    updateSuggestedLatency();
+    
+    /* Suggested latency only takes effect when the stream opens */
+    if (!_streamIsOpen)
+        return true;
+    
+    bool streamWasActive = streamIsActive();
+    if (streamWasActive) stopStream();
+    closeStream();
+    
+    bool success = reopenStream(true, streamWasActive);
+    if (!success) {
+        printf("%s: Couldn't reopen the stream %s low-latency mode. Reverting\n", __PRETTY_FUNCTION__, enable ? "in" : "out of");
+        lowLatencyMode = !enable;
+        updateSuggestedLatency();
+        if (!reopenStream(true, streamWasActive))
+            printf("%s: Couldn't reopen the stream with the previous latency either\n", __PRETTY_FUNCTION__);
+    }
+    
+    resetCallbackStatistics();
+    
+    return success;
+}
+
+/* Compress recorded audio in the background as it accumulates, or stop and free what we have */
+void AudioController::setHistoryEnabled(bool enable) {
+    
+    if (enable == historyEnabled)
+        return;
+    
+    history->stop();
+    history->reset();
+    historyEnabled = enable;
+    if (historyEnabled)
+        history->start();
+}
+
+void AudioController::setLatencyTuningEnabled(bool enable) {
+    
+    latencyTuner->setEnabled(enable);
+    pendingBufferLength = 0;
+    resetCallbackStatistics();
+}
+
+/* Collect callback statistics and let the tuner pick a new buffer length once per evaluation window. Stepping up happens right away since we're already glitching; stepping down waits for a quiet moment on the inputs. */
+void AudioController::serviceLatencyTuner() {
+    
+    if (!_streamIsOpen || !latencyTuner->isEnabled())
+        return;
+    
+    tunerCallbacks += statCallbacks.exchange(0);
+    tunerXruns += statXruns.exchange(0);
+    tunerBusyNanoseconds += statBusyNanoseconds.exchange(0);
+    unsigned long long maxNanoseconds = statMaxNanoseconds.exchange(0);
+    tunerMaxNanoseconds = maxNanoseconds > tunerMaxNanoseconds ? maxNanoseconds : tunerMaxNanoseconds;
+    bool quiet = statInputPeak.exchange(0.0f) < kLatencyTunerQuietLevel;
+    
+    if (pendingBufferLength && quiet) {
+        setAudioBufferLength(pendingBufferLength);
+        return;
+    }
+    
+    if (tunerCallbacks * audioBufferLength < kLatencyTunerWindowDuration * sampleRate)
+        return;
+    
+    double periodNanoseconds = 1e9 * audioBufferLength / sampleRate;
+    LatencyTunerStats stats;
+    stats.callbacks = tunerCallbacks;
+    stats.xruns = tunerXruns;
+    stats.meanLoad = tunerBusyNanoseconds / tunerCallbacks / periodNanoseconds;
+    stats.maxLoad = tunerMaxNanoseconds / periodNanoseconds;
+    
+    tunerCallbacks = tunerXruns = 0;
+    tunerBusyNanoseconds = 0.0;
+    tunerMaxNanoseconds = 0;
+    
+    /* While a step down is waiting, only a bad window (which cancels it) needs the tuner */
+    if (pendingBufferLength && stats.xruns == 0 && stats.maxLoad <= kLatencyTunerMaxLoad)
+        return;
+    pendingBufferLength = 0;
+    
+    int nextBufferLength;
+    if (!latencyTuner->evaluate(stats, numRecordedFrames, nextBufferLength))
+        return;
+    
+    if (nextBufferLength > audioBufferLength || quiet)
+        setAudioBufferLength(nextBufferLength);
+    else
+        pendingBufferLength = nextBufferLength;
+}
+
+/* Fix the buffer length for the show; the tuner leaves it alone until unpinned */
+bool AudioController::pinAudioBufferLength(int length) {
+    
+    if (length < kLatencyTunerMinBufferLength || length > kLatencyTunerMaxBufferLength) {
+        printf("%s: Invalid buffer length %d. Must be in [%d, %d]\n", __PRETTY_FUNCTION__, length, kLatencyTunerMinBufferLength, kLatencyTunerMaxBufferLength);
+        return false;
+    }
+    
+    latencyTuner->pin(length, numRecordedFrames);
+    return setAudioBufferLength(length);
+}
+
+void AudioController::unpinAudioBufferLength() {
+    latencyTuner->unpin(numRecordedFrames);
+}
+
+/* Add a secondary input device's channels after the primary input's */
+int AudioController::addAggregateInputDevice(PaDeviceIndex deviceIndex, int nChannels) {
+    
+    if (_streamIsOpen) {
+        printf("%s: Close the stream before adding aggregate inputs\n", __PRETTY_FUNCTION__);
+        return -1;
+    }
+    if(!validateDeviceIndex(deviceIndex, __PRETTY_FUNCTION__))
+        return -1;
+    if (deviceIndex == inputStreamParams.device) {
+        printf("%s: Device #%d (%s) is already the primary input\n", __PRETTY_FUNCTION__, deviceIndex, devices[deviceIndex]->name);
+        return -1;
+    }
+    if (numInputChannels + nChannels > kMaxNumAudioChannels) {
+        printf("%s: Invalid number of input channels %d (+ %d open). Maximum = %d\n", __PRETTY_FUNCTION__, nChannels, numInputChannels, kMaxNumAudioChannels);
+        return -1;
+    }
+    
+    int sourceIndex = aggregator->addDevice(deviceIndex, nChannels);
+    if (sourceIndex < 0)
+        return -1;
+    
+    numInputChannels = numPrimaryInputChannels + aggregator->getNumChannels();
+    allocateRecordingBuffers(true);
+    
+    return sourceIndex;
+}
+
+/* Add a WAV file as a stand-in input device whose clock runs rateOffsetPPM fast (or slow, if negative) */
+int AudioController::addAggregateInputFile(std::string path, double rateOffsetPPM) {
+    
+    if (_streamIsOpen) {
+        printf("%s: Close the stream before adding aggregate inputs\n", __PRETTY_FUNCTION__);
+        return -1;
+    }
+    
+    int sourceIndex = aggregator->addFile(path, rateOffsetPPM, audioBufferLength, kMaxNumAudioChannels - numInputChannels);
+    if (sourceIndex < 0)
+        return -1;
+    
+    numInputChannels = numPrimaryInputChannels + aggregator->getNumChannels();
+    allocateRecordingBuffers(true);
+    
+    return sourceIndex;
+}
+
+void AudioController::removeAggregateInputs() {
+    
+    if (_streamIsOpen) {
+        printf("%s: Close the stream before removing aggregate inputs\n", __PRETTY_FUNCTION__);
+        return;
+    }
+    
+    aggregator->removeAll();
+    numInputChannels = numPrimaryInputChannels;
+    allocateRecordingBuffers(true);
+}
+
 bool AudioController::openStream() {
     
     /* Make sure we've already specified an input device to use */
@@ -414,6 +845,7 @@ bool AudioController::openStream() {
     printStreamParameters(outputStreamParams, "\n== Output parameters:");
     
     /* Open the stream, passing the static render callback method and input stream parameters */
+    std::lock_guard<std::mutex> lock(portAudioMutex);
     PaError error = Pa_OpenStream(&stream,
                                   &inputStreamParams,
                                   &outputStreamParams,
@@ -427,6 +859,11 @@ bool AudioController::openStream() {
         return false;
     }
     
+    if (!aggregator->open(sampleRate, audioBufferLength)) {
+        Pa_CloseStream(stream);
+        return false;
+    }
+    
 //    PaUtil_InitializeBufferProcessor(bufferProcessor,
 //                                     numInputChannels,
 //                                     inputStreamParams.sampleFormat,
@@ -443,6 +880,10 @@ bool AudioController::openStream() {
 //                                     this);
     
     _streamIsOpen = true;
+    capabilityCache->setBusyDevices(inputStreamParams.device, outputStreamParams.device);
+    std::vector<PaDeviceIndex> secondaryDevices = aggregator->getDevices();
+    for (int i = 0; i < secondaryDevices.size(); i++)
+        capabilityCache->addBusyDevice(secondaryDevices[i]);
     
     return true;
 }
@@ -454,23 +895,26 @@ bool AudioController::closeStream() {
         return false;
     }
     
+    std::lock_guard<std::mutex> lock(portAudioMutex);
     PaError error = Pa_CloseStream(stream);
     if (error != paNoError) {
         printf("%s: PaError = %s\n", __PRETTY_FUNCTION__, Pa_GetErrorText(error));
         return false;
     }
+    aggregator->close();
     
     _streamIsOpen = false;
+    capabilityCache->setBusyDevices(paNoDevice, paNoDevice);
     
     return true;
 }
 
 bool AudioController::streamIsActive() {
     
-    if (!stream)
+    if (!_streamIsOpen)
         return false;
     
-    return Pa_IsStreamActive(&stream);
+    return Pa_IsStreamActive(stream) == 1;
 }
 
 bool AudioController::startStream() {
@@ -480,9 +924,17 @@ bool AudioController::startStream() {
         return false;
     }
     
+    /* Secondaries first, so their FIFOs are filling by the time the primary callback pulls from them */
+    std::lock_guard<std::mutex> lock(portAudioMutex);
+    if (!aggregator->start()) {
+        printf("%s: Couldn't start the aggregate inputs\n", __PRETTY_FUNCTION__);
+        aggregator->stop();     // Any that did start
+        return false;
+    }
     PaError error = Pa_StartStream(stream);
     if (error != paNoError) {
         printf("%s: PaError = %s\n", __PRETTY_FUNCTION__, Pa_GetErrorText(error));
+        aggregator->stop();
         return false;
     }
     
@@ -496,7 +948,9 @@ bool AudioController::stopStream() {
         return false;
     }
     
+    std::lock_guard<std::mutex> lock(portAudioMutex);
     PaError error = Pa_StopStream(stream);
+    aggregator->stop();
     if (error != paNoError) {
         printf("%s: PaError = %s\n", __PRETTY_FUNCTION__, Pa_GetErrorText(error));
         return false;
@@ -506,6 +960,60 @@ bool AudioController::stopStream() {
 }
 
 #pragma mark - Utility
+/* Open and/or start the stream again after changing its parameters. On failure the stream is left closed. */
+bool AudioController::reopenStream(bool open, bool start) {
+    
+    if (open && !openStream())
+        return false;
+    
+    if (start && !startStream()) {
+        closeStream();
+        return false;
+    }
+    
+    return true;
+}
+
+void AudioController::updateSuggestedLatency() {
+    
+    /* A measured round trip only holds for the devices, sample rate and buffering it was measured with */
+    roundTripLatency = 0.0;
+    
+    double latency = kLatencyTunerLatencyBuffers * audioBufferLength / sampleRate;
+    
+    if (inputStreamParams.device != paNoDevice)
+        inputStreamParams.suggestedLatency = lowLatencyMode ? latency : devices[inputStreamParams.device]->defaultLowInputLatency;
+    if (outputStreamParams.device != paNoDevice)
+        outputStreamParams.suggestedLatency = lowLatencyMode ? latency : devices[outputStreamParams.device]->defaultLowOutputLatency;
+}
+
+void AudioController::resetCallbackStatistics() {
+    
+    statCallbacks = 0;
+    statXruns = 0;
+    statBusyNanoseconds = 0;
+    statMaxNanoseconds = 0;
+    statInputPeak = 0.0f;
+    tunerCallbacks = 0;
+    tunerXruns = 0;
+    tunerBusyNanoseconds = 0.0;
+    tunerMaxNanoseconds = 0;
+}
+
+/* $HOME/Library/Caches/AudioWorks/DeviceCapabilities.txt, creating the directory if needed */
+std::string AudioController::capabilityCachePath() {
+    
+    const char *home = getenv("HOME");
+    std::string dir = std::string(home ? home : "/tmp") + "/" + kDeviceCapabilityCacheDirectory;
+    
+    /* mkdir -p */
+    for (size_t pos = dir.find('/', 1); pos != std::string::npos; pos = dir.find('/', pos + 1))
+        mkdir(dir.substr(0, pos).c_str(), 0755);
+    mkdir(dir.c_str(), 0755);
+    
+    return dir + "/" + kDeviceCapabilityCacheFile;
+}
+
 bool AudioController::validateDeviceIndex(PaDeviceIndex devIdx, std::string callingFunction) {
     
     bool success = false;
@@ -10,19 +10,46 @@
 #define AudioController_hpp
 
 #include <stdio.h>
-#include <pthread.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <portaudio.h>
 //#include <common/pa_process.h>
 #include <Accelerate/Accelerate.h>
 #include <vector>
 #include <string>
 #include <map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "LatencyTuner.hpp"
+#include "DeviceCapabilityCache.hpp"
+#include "DeviceAggregator.hpp"
+#include "CompressedHistory.hpp"
+#include "ParameterAutomation.hpp"
+#include "CaptureTimeline.hpp"
+#include "LatencyProbe.hpp"
 
 #define kDefaultAudioSampleType paFloat32
 #define kDefaultAudioSampleRate (44100.0f)
 #define kDefaultAudioBufferLength (512)
-#define kMaxNumAudioChannels (8)
+#define kMaxNumAudioChannels (16)       // Primary input plus aggregated secondaries
 #define kRecordingBufferDuration (10.0f)
+#define kMuteRampTime (0.005f)           // Seconds; long enough not to click
+
+/* Live controls, automated through a ParameterAutomation queue */
+typedef enum AudioParameter {
+    kAudioParameterOutputGain,
+    kAudioParameterMute,                // 1 plays, 0 mutes
+    kNumAudioParameters
+} AudioParameter;
+
+#define kDeviceCapabilityCacheDirectory "Library/Caches/AudioWorks"     // Relative to $HOME
+#define kDeviceCapabilityCacheFile "DeviceCapabilities.txt"
+#define kLatencyTunerWindowDuration (1.0f)      // Seconds of audio per tuner evaluation
+#define kLatencyTunerQuietLevel (0.003f)        // Input peak (about -50 dBFS) below which we may reopen the stream to step down
 
 typedef float SAMPLE;
 
@@ -38,24 +65,63 @@ class AudioController {
     int numInputChannels;
     int numOutputChannels;
     
-    SAMPLE outputGain;
+    ParameterAutomation *parameters;    // Changes from the UI, applied sample-accurately in the callback
+    
+    /* Latency tuning. The callback statistics are written by the audio thread and collected by serviceLatencyTuner(). */
+    bool lowLatencyMode;
+    LatencyTuner *latencyTuner;
+    std::atomic<unsigned long> statCallbacks;
+    std::atomic<unsigned long> statXruns;
+    std::atomic<unsigned long long> statBusyNanoseconds;
+    std::atomic<unsigned long long> statMaxNanoseconds;
+    std::atomic<float> statInputPeak;
+    unsigned long tunerCallbacks;       // Current evaluation window, accumulated on the main thread
+    unsigned long tunerXruns;
+    double tunerBusyNanoseconds;
+    unsigned long long tunerMaxNanoseconds;
+    int pendingBufferLength;            // Step down waiting for a quiet moment (0 if none)
     
     /* Devices */
     std::vector<const PaDeviceInfo *> devices;
+    DeviceCapabilityCache *capabilityCache;
+    std::mutex portAudioMutex;          // Serializes our stream calls with the cache's background probing
     
-    /* Array of recording buffers */
+    /* Secondary inputs, resampled onto the primary input's timeline as channels numPrimaryInputChannels and up */
+    DeviceAggregator *aggregator;
+    int numPrimaryInputChannels;
+    
+    /* Recording buffers: a ring per channel, written by the callback without locks */
     int recordingBufferLength;
     int numRecordingBuffers;
     SAMPLE **recBuffers;
-    pthread_mutex_t *recBufferMutex;
+    std::atomic<unsigned long long> numRecordedFrames;          // Global sample counter: frames written to every channel since the buffers were allocated
+    std::atomic<unsigned long long> recordingWriteEnd;          // End of the block being written, so readers can tell what may have been overwritten
+    CaptureTimeline *timeline;                                  // Host timestamps of each recorded block
+    
+    /* Readers on other threads (the scope frame producer, analysis threads) hold recordingReaders while they copy. Reallocation clears recordingBuffersValid, waits for them to finish and sets it again once the new buffers are published; reads in between come back as zeros. */
+    std::atomic<int> recordingReaders;
+    std::atomic<bool> recordingBuffersValid;
+    
+    /* Round-trip latency measurement */
+    LatencyProbe *latencyProbe;
+    double roundTripLatency;            // Frames, from the last valid measurement with the current devices, rate and buffer length (0 if none)
+    
+    /* Lossless compressed copy of everything recorded, kept well past the recording buffers. Off unless asked for. */
+    CompressedHistory *history;
+    bool historyEnabled;
     
 #pragma mark - Private Utility
     PaError paSetup();
     void allocateRecordingBuffers(bool reallocate);
-    void appendToRecordingBuffer(SAMPLE *inBuffer, int channel, int length);
+    void writeRecordingBuffers(SAMPLE * const *inBuffers, int length);
+    void readRecordingBuffers(SAMPLE * const *outBuffers, int firstChannel, int nChannels, long long startFrame, int length);
     bool validateDeviceIndex(PaDeviceIndex devIdx, std::string callingFunction);
     void printDeviceInfo(const PaDeviceInfo *device);
     void printStreamParameters(const PaStreamParameters _params, std::string title);
+    void updateSuggestedLatency();
+    bool reopenStream(bool open, bool start);
+    void resetCallbackStatistics();
+    std::string capabilityCachePath();
     
 #pragma mark - Portaudio Callback
     /* Portaudio requires a static callback method, so the staticProcessingCallback() passes control to the instance-specified processingCallback() */
@@ -87,8 +153,10 @@ public:
     int getMaxNumInputChannels(PaDeviceIndex deviceIndex);
     int getMaxNumOutputChannels(PaDeviceIndex deviceIndex);
     std::vector<float> getSupportedSampleRates(PaDeviceIndex inputDeviceIndex, PaDeviceIndex outputDeviceIndex);
+    unsigned long getDeviceCapabilityGeneration() { return capabilityCache->getGeneration(); }     // Changes when background probing finds new capabilities
     float getSampleRate() { return sampleRate; }
     int getNumInputChannels() { return numInputChannels; }
+    int getNumPrimaryInputChannels() { return numPrimaryInputChannels; }
     int getNumOutputChannels() { return numOutputChannels; }
     int getAudioBufferLength() { return audioBufferLength; }
     int getRecordingBufferLength() { return recordingBufferLength; }
@@ -96,7 +164,32 @@ public:
     float getRecordingBufferDuration() { return (float)recordingBufferLength / sampleRate; }
     void getRecordingBuffer(SAMPLE *outBuffer, int channel, int length);
     void getRecordingBuffer(SAMPLE *outBuffer, int channel, int startIdx, int endIdx);
-    float getOutputGain() { return outputGain; }
+    void getRecordingBufferFrom(SAMPLE *outBuffer, int channel, long long startFrame, int length);
+    void getRecordingBuffersFrom(SAMPLE * const *outBuffers, int nChannels, long long startFrame, int length);
+    unsigned long long getNumRecordedFrames() { return numRecordedFrames; }
+    
+    /* Capture timestamps by absolute recorded frame: when it hit the ADC (in stream time), or its whole callback block */
+    bool getFrameInputTime(unsigned long long frame, double *inputTime) { return timeline->getInputTime(frame, inputTime); }
+    bool getFrameBlockTime(unsigned long long frame, CaptureBlockTime *block) { return timeline->getBlock(frame, block); }
+    
+    /* Loopback latency measurement. Output frame n comes back on input frame n + getRoundTripLatency(). */
+    bool startLatencyMeasurement(int outputChannel, int inputChannel);
+    bool getLatencyMeasurement(LatencyMeasurement *result);
+    bool latencyMeasurementInProgress() { LatencyProbeState s = latencyProbe->getState(); return s == kLatencyProbeArmed || s == kLatencyProbePlaying; }
+    double getRoundTripLatency() { return roundTripLatency; }
+    
+    /* Long lookback. Frames still in the recording buffers are read from there, older ones are decoded from the compressed history. Frames we no longer have read as zeros. */
+    void getHistoryFrom(SAMPLE *outBuffer, int channel, long long startFrame, int length);
+    long long getOldestHistoryFrame();
+    size_t getHistoryMemoryUsage() { return history->getMemoryUsage(); }
+    float getHistoryCompressionRatio() { return history->getCompressionRatio(); }
+    bool getHistoryEnabled() { return historyEnabled; }
+    float getOutputGain() { return parameters->getTargetValue(kAudioParameterOutputGain); }
+    bool getMuted() { return parameters->getTargetValue(kAudioParameterMute) == 0.0f; }
+    bool getLowLatencyMode() { return lowLatencyMode; }
+    bool getLatencyTuningEnabled() { return latencyTuner->isEnabled(); }
+    bool getAudioBufferLengthPinned() { return latencyTuner->isPinned(); }
+    const std::vector<LatencyTunerDecision> &getLatencyDecisionLog() { return latencyTuner->getLog(); }
     
     /* Setters */
     bool setInputDevice(PaDeviceIndex inputDeviceIdx);
@@ -104,7 +197,27 @@ public:
     bool setSampleRate(float fs);
     bool setNumInputChannels(int nChannels);
     bool setNumOutputChannels(int nChannels);
-    void setOutputGain(float gain) { outputGain = gain; }
+    void setOutputGain(float gain, float rampTime = kParameterDefaultRampTime) { parameters->schedule(kAudioParameterOutputGain, gain, kParameterImmediate, rampTime); }
+    void setMuted(bool mute) { parameters->schedule(kAudioParameterMute, mute ? 0.0f : 1.0f, kParameterImmediate, kMuteRampTime); }
+    
+    /* Schedule a parameter change at an absolute recorded frame (see getNumRecordedFrames()), ramping over rampTime seconds. Call from one thread only (normally the main thread). */
+    bool scheduleParameter(AudioParameter parameter, float value, unsigned long long frame, float rampTime = kParameterDefaultRampTime) { return parameters->schedule(parameter, value, frame, rampTime); }
+    bool setAudioBufferLength(int length);
+    bool setLowLatencyMode(bool enable);
+    void setHistoryEnabled(bool enable);        // Keep up to kHistoryLongDuration (and kHistoryDefaultMaxBytes) of compressed history
+    
+    /* Automatic buffer length tuning. serviceLatencyTuner() should be called periodically from the main thread; it may reopen the stream. */
+    void setLatencyTuningEnabled(bool enable);
+    void serviceLatencyTuner();
+    bool pinAudioBufferLength(int length);
+    void unpinAudioBufferLength();
+    
+    /* Aggregate inputs. Secondary devices (or file-backed stand-ins at a clock offset in ppm) add channels after the primary input device's, drift-compensated onto its clock. Add/remove them while the stream is closed. Return the source index, or -1 on failure. */
+    int addAggregateInputDevice(PaDeviceIndex deviceIndex, int nChannels);
+    int addAggregateInputFile(std::string path, double rateOffsetPPM);
+    void removeAggregateInputs();
+    int getNumAggregateInputs() { return aggregator->getNumSources(); }
+    AggregateSourceStatus getAggregateInputStatus(int sourceIndex) { return aggregator->getStatus(sourceIndex); }
     
     /* Methods for opening/closing the audio stream */
     bool streamIsOpen() { return _streamIsOpen; }
@@ -0,0 +1,93 @@
+//
+//  CaptureTimeline.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "CaptureTimeline.hpp"
+
+#define kCaptureTimelineMargin (16)     // Slots near the write position we don't search, so a search isn't lapped
+
+#pragma mark - CaptureTimeline
+CaptureTimeline::CaptureTimeline() : head(0), sampleRate(0.0f) {
+
+    slots = new Slot[kCaptureTimelineLength];
+    for (int i = 0; i < kCaptureTimelineLength; i++)
+        slots[i].sequence = 0;
+}
+
+CaptureTimeline::~CaptureTimeline() {
+    delete [] slots;
+}
+
+void CaptureTimeline::push(const CaptureBlockTime &block) {
+
+    unsigned long long n = head.load(std::memory_order_relaxed);
+    Slot &slot = slots[n % kCaptureTimelineLength];
+
+    slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.block = block;
+    slot.sequence.store(2 * n + 2, std::memory_order_release);
+
+    head.store(n + 1, std::memory_order_release);
+}
+
+void CaptureTimeline::reset(float fs) {
+
+    sampleRate = fs;
+    head = 0;
+    for (int i = 0; i < kCaptureTimelineLength; i++)
+        slots[i].sequence = 0;
+}
+
+bool CaptureTimeline::getBlock(unsigned long long frame, CaptureBlockTime *block) {
+
+    unsigned long long h = head.load(std::memory_order_acquire);
+    if (h == 0)
+        return false;
+
+    unsigned long long lo = h > kCaptureTimelineLength - kCaptureTimelineMargin ? h - (kCaptureTimelineLength - kCaptureTimelineMargin) : 0;
+    unsigned long long hi = h;
+
+    /* Last block starting at or before frame */
+    CaptureBlockTime probe;
+    while (hi - lo > 1) {
+        unsigned long long mid = lo + (hi - lo) / 2;
+        if (!readSlot(mid, &probe))
+            return false;
+        if (probe.frame <= frame)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    if (!readSlot(lo, block))
+        return false;
+    return frame >= block->frame && frame < block->frame + block->length;
+}
+
+bool CaptureTimeline::getInputTime(unsigned long long frame, double *inputTime) {
+
+    CaptureBlockTime block;
+    if (!getBlock(frame, &block) || sampleRate <= 0.0f)
+        return false;
+
+    *inputTime = block.inputTime + (frame - block.frame) / (double)sampleRate;
+    return true;
+}
+
+#pragma mark - Private Methods
+bool CaptureTimeline::readSlot(unsigned long long n, CaptureBlockTime *block) {
+
+    Slot &slot = slots[n % kCaptureTimelineLength];
+
+    unsigned long long before = slot.sequence.load(std::memory_order_acquire);
+    *block = slot.block;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    unsigned long long after = slot.sequence.load(std::memory_order_relaxed);
+
+    return before == 2 * n + 2 && after == before;
+}
@@ -0,0 +1,66 @@
+//
+//  CaptureTimeline.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef CaptureTimeline_hpp
+#define CaptureTimeline_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <atomic>
+
+#define kCaptureTimelineLength (4096)       // Blocks; about 47 seconds of 512-frame blocks at 44.1 kHz
+
+/* When one callback's block was captured and will be played */
+struct CaptureBlockTime {
+    unsigned long long frame;       // Absolute recorded frame of the block's first sample
+    int length;
+    double inputTime;               // Stream time the first input sample hit the ADC (PaStreamCallbackTimeInfo::inputBufferAdcTime)
+    double outputTime;              // Stream time the first output sample will hit the DAC
+    double hostTime;                // steady_clock seconds when the callback started, comparable across streams
+};
+
+/* Timestamps for the most recent kCaptureTimelineLength callback blocks, written by the audio thread and read from anywhere without locks.
+
+    Slots carry sequence numbers as in FeatureEventLog: odd while being written. A read that overlaps a write fails rather than returning a mix of two blocks. Frames between block starts are timed by counting samples from the start of their block. */
+class CaptureTimeline {
+
+    struct Slot {
+        std::atomic<unsigned long long> sequence;
+        CaptureBlockTime block;
+    };
+
+    Slot *slots;
+    std::atomic<unsigned long long> head;       // Blocks pushed
+    float sampleRate;
+
+#pragma mark - Private Methods
+    bool readSlot(unsigned long long n, CaptureBlockTime *block);
+
+public:
+
+    /* Constructor/Destructor */
+    CaptureTimeline();
+    ~CaptureTimeline();
+
+    /* Writer only */
+    void push(const CaptureBlockTime &block);
+
+    /* Forget every block (frame numbering is starting over). Call while the writer is stopped. */
+    void reset(float fs);
+
+    /* The block containing a frame. Returns false if it's older than the timeline or not recorded yet. */
+    bool getBlock(unsigned long long frame, CaptureBlockTime *block);
+
+    /* ADC time of a frame, in stream time */
+    bool getInputTime(unsigned long long frame, double *inputTime);
+
+    /* Getters */
+    unsigned long long getNumBlocks() { return head.load(std::memory_order_acquire); }
+};
+
+#endif /* CaptureTimeline_hpp */
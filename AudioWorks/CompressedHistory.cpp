@@ -0,0 +1,652 @@
+//
+//  CompressedHistory.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "CompressedHistory.hpp"
+#include "AudioController.hpp"
+
+#define kHistoryModeConstant (0)
+#define kHistoryModeVerbatim (1)
+#define kHistoryModePredicted (2)
+#define kHistoryMaxFixedOrder (4)
+#define kHistoryZeroPartition (31)      // Rice parameter marking a partition of zero residuals
+#define kHistoryMaxMagnitude (1 << 26)  // Integer samples must be smaller than this, so residuals fit in 32 bits
+
+#pragma mark - Bit I/O
+class HistoryBitWriter {
+
+    std::vector<unsigned char> &bytes;
+    uint64_t accumulator;
+    int numBits;
+
+public:
+
+    HistoryBitWriter(std::vector<unsigned char> &out) : bytes(out), accumulator(0), numBits(0) {}
+
+    void write(uint32_t value, int bits) {
+        if (bits == 0)
+            return;
+        accumulator = (accumulator << bits) | (bits == 32 ? value : value & ((1u << bits) - 1));
+        numBits += bits;
+        while (numBits >= 8) {
+            numBits -= 8;
+            bytes.push_back((unsigned char)(accumulator >> numBits));
+        }
+    }
+
+    void writeRice(uint32_t u, int k) {
+        uint32_t q = u >> k;
+        if (q >= kHistoryRiceEscape) {
+            for (int i = 0; i < kHistoryRiceEscape; i++)
+                write(1, 1);
+            write(u, 32);
+            return;
+        }
+        while (q >= 16) {
+            write(0xFFFF, 16);
+            q -= 16;
+        }
+        write((1u << (q + 1)) - 2, q + 1);      // q ones and a zero
+        write(u, k);
+    }
+
+    void flush() {
+        if (numBits > 0)
+            write(0, 8 - numBits);
+    }
+};
+
+class HistoryBitReader {
+
+    const unsigned char *bytes;
+    size_t size;
+    size_t position;
+    uint64_t cache;
+    int numBits;
+
+    bool refill(int bits) {
+        while (numBits < bits) {
+            if (position >= size)
+                return false;
+            cache = (cache << 8) | bytes[position++];
+            numBits += 8;
+        }
+        return true;
+    }
+
+public:
+
+    bool overrun;
+
+    HistoryBitReader(const unsigned char *data, size_t length) : bytes(data), size(length), position(0), cache(0), numBits(0), overrun(false) {}
+
+    uint32_t read(int bits) {
+        if (bits == 0)
+            return 0;
+        if (!refill(bits)) {
+            overrun = true;
+            return 0;
+        }
+        numBits -= bits;
+        return (uint32_t)((cache >> numBits) & (bits == 32 ? 0xFFFFFFFFull : ((1ull << bits) - 1)));
+    }
+
+    uint32_t readRice(int k) {
+        uint32_t q = 0;
+        while (q < kHistoryRiceEscape && read(1))
+            q++;
+        if (overrun)
+            return 0;
+        if (q == kHistoryRiceEscape)
+            return read(32);
+        return (q << k) | read(k);
+    }
+};
+
+#pragma mark - Codec Utility
+static inline uint32_t zigzag(int32_t r) { return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31); }
+static inline int32_t unzigzag(uint32_t u) { return (int32_t)(u >> 1) ^ -(int32_t)(u & 1); }
+
+/* Smallest q such that every sample times 2^q is an integer of magnitude below kHistoryMaxMagnitude, or -1 if there isn't one */
+static int integerShift(const float *x, int length) {
+
+    int q = 0;
+    float peak = 0.0f;
+
+    for (int i = 0; i < length; i++) {
+
+        if (!isfinite(x[i]))
+            return -1;
+        if (x[i] == 0.0f) {
+            if (signbit(x[i]))
+                return -1;      // -0.0 wouldn't survive the round trip
+            continue;
+        }
+
+        int e;
+        float m = frexpf(x[i], &e);
+        uint32_t mantissa = (uint32_t)fabsf(ldexpf(m, 24));     // x = mantissa * 2^(e - 24)
+        int needed = 24 - e - __builtin_ctz(mantissa);
+        q = needed > q ? needed : q;
+        peak = fabsf(x[i]) > peak ? fabsf(x[i]) : peak;
+    }
+
+    if (q > 30 || ldexpf(peak, q) >= kHistoryMaxMagnitude)
+        return -1;
+    return q;
+}
+
+/* Bits to Rice-code residuals [order, length) with one parameter per partition. Picks the parameters when k isn't NULL. */
+static long long riceBits(const int32_t *residual, int order, int length, int *k) {
+
+    long long bits = 0;
+    int numPartitions = (length + kHistoryPartitionLength - 1) / kHistoryPartitionLength;
+
+    for (int p = 0; p < numPartitions; p++) {
+
+        int begin = p == 0 ? order : p * kHistoryPartitionLength;
+        int end = (p + 1) * kHistoryPartitionLength < length ? (p + 1) * kHistoryPartitionLength : length;
+        int n = end - begin;
+
+        uint64_t sum = 0;
+        for (int i = begin; i < end; i++)
+            sum += zigzag(residual[i]);
+
+        int param;
+        if (sum == 0)
+            param = kHistoryZeroPartition;
+        else {
+            param = 0;
+            while (param < 30 && ((uint64_t)n << (param + 1)) <= sum)
+                param++;
+        }
+        if (k)
+            k[p] = param;
+
+        bits += 5;
+        if (param != kHistoryZeroPartition)
+            bits += n * (long long)(param + 1) + (long long)(sum >> param);
+    }
+
+    return bits;
+}
+
+/* Fixed polynomial predictor residual. Returns false if it doesn't fit in 32 bits. */
+static bool fixedResidual(const int32_t *v, int length, int order, int32_t *residual) {
+
+    static const int coefficients[kHistoryMaxFixedOrder + 1][kHistoryMaxFixedOrder] = {
+        {0, 0, 0, 0}, {1, 0, 0, 0}, {2, -1, 0, 0}, {3, -3, 1, 0}, {4, -6, 4, -1}
+    };
+
+    for (int i = order; i < length; i++) {
+        int64_t prediction = 0;
+        for (int j = 0; j < order; j++)
+            prediction += (int64_t)coefficients[order][j] * v[i - 1 - j];
+        int64_t r = (int64_t)v[i] - prediction;
+        if (r > INT32_MAX || r < INT32_MIN)
+            return false;
+        residual[i] = (int32_t)r;
+    }
+    return true;
+}
+
+/* Quantized LPC predictor from the autocorrelation of the (Welch-windowed) signal. Returns false if the signal can't be predicted or the residual doesn't fit in 32 bits. */
+static bool lpcResidual(const int32_t *v, int length, int order, int32_t *qc, int *shift, int32_t *residual) {
+
+    if (length <= order * 2)
+        return false;
+
+    /* Autocorrelation */
+    std::vector<double> w(length);
+    for (int i = 0; i < length; i++) {
+        double t = (2.0 * i - (length - 1)) / (length + 1);
+        w[i] = v[i] * (1.0 - t * t);
+    }
+    double r[kHistoryMaxLPCOrder + 1];
+    for (int lag = 0; lag <= order; lag++) {
+        r[lag] = 0.0;
+        for (int i = lag; i < length; i++)
+            r[lag] += w[i] * w[i - lag];
+    }
+    if (r[0] <= 0.0)
+        return false;
+
+    /* Levinson-Durbin */
+    double a[kHistoryMaxLPCOrder + 1] = {0.0}, previous[kHistoryMaxLPCOrder + 1];
+    double error = r[0];
+    for (int m = 1; m <= order; m++) {
+        double acc = r[m];
+        for (int j = 1; j < m; j++)
+            acc -= a[j] * r[m - j];
+        double reflection = acc / error;
+        memcpy(previous, a, sizeof(a));
+        a[m] = reflection;
+        for (int j = 1; j < m; j++)
+            a[j] = previous[j] - reflection * previous[m - j];
+        error *= 1.0 - reflection * reflection;
+        if (error <= 0.0)
+            return false;
+    }
+
+    /* Quantize so the largest coefficient uses all kHistoryLPCPrecision - 1 magnitude bits */
+    double largest = 0.0;
+    for (int j = 1; j <= order; j++)
+        largest = fabs(a[j]) > largest ? fabs(a[j]) : largest;
+    if (largest == 0.0)
+        return false;
+
+    int exponent;
+    frexp(largest, &exponent);
+    *shift = kHistoryLPCPrecision - 1 - exponent;
+    *shift = *shift < 0 ? 0 : (*shift > 15 ? 15 : *shift);
+
+    int32_t limit = (1 << (kHistoryLPCPrecision - 1)) - 1;
+    for (int j = 0; j < order; j++) {
+        double c = round(ldexp(a[j + 1], *shift));
+        qc[j] = (int32_t)(c > limit ? limit : (c < -limit ? -limit : c));
+    }
+
+    for (int i = order; i < length; i++) {
+        int64_t prediction = 0;
+        for (int j = 0; j < order; j++)
+            prediction += (int64_t)qc[j] * v[i - 1 - j];
+        int64_t res = (int64_t)v[i] - (prediction >> *shift);
+        if (res > INT32_MAX || res < INT32_MIN)
+            return false;
+        residual[i] = (int32_t)res;
+    }
+    return true;
+}
+
+#pragma mark - CompressedHistory
+CompressedHistory::CompressedHistory(AudioController *ac, float duration, size_t byteBudget) : audioController(ac), maxDuration(duration), maxBytes(byteBudget), numChannels(0), sampleRate(0.0f), encodedFrame(0), totalBytes(0), totalFrames(0), running(false) {
+    reset();
+}
+
+CompressedHistory::~CompressedHistory() {
+    stop();
+}
+
+bool CompressedHistory::start() {
+
+    if (running)
+        return false;
+
+    running = true;
+    encoderThread = std::thread(&CompressedHistory::encoderLoop, this);
+    return true;
+}
+
+void CompressedHistory::stop() {
+
+    running = false;
+    if (encoderThread.joinable())
+        encoderThread.join();
+}
+
+void CompressedHistory::reset() {
+
+    std::lock_guard<std::mutex> lock(chunksMutex);
+    chunks.clear();
+    totalBytes = 0;
+    totalFrames = 0;
+    numChannels = audioController->getNumInputChannels();
+    sampleRate = audioController->getSampleRate();
+    
+    blocks.resize(numChannels);
+    blockRows.resize(numChannels);
+    for (int i = 0; i < numChannels; i++) {
+        blocks[i].resize(kHistoryChunkLength);
+        blockRows[i] = &blocks[i][0];
+    }
+    encodedFrame = audioController->getNumRecordedFrames();
+}
+
+void CompressedHistory::setLimits(float duration, size_t byteBudget) {
+
+    std::lock_guard<std::mutex> lock(chunksMutex);
+    maxDuration = duration;
+    maxBytes = byteBudget;
+    trim();
+}
+
+int CompressedHistory::read(float *outBuffer, int channel, long long startFrame, int length) {
+
+    memset(outBuffer, 0, length * sizeof(float));
+    if (channel < 0 || channel >= numChannels || length <= 0)
+        return 0;
+
+    /* Take references to the overlapping chunks; decode them after letting go of the lock */
+    std::vector<std::shared_ptr<const HistoryChunk> > needed;
+    {
+        std::lock_guard<std::mutex> lock(chunksMutex);
+
+        /* Chunks are in frame order but may have gaps, so search for the first one ending after startFrame */
+        size_t lo = 0, hi = chunks.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (chunks[mid]->startFrame + chunks[mid]->length <= startFrame)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (size_t i = lo; i < chunks.size() && chunks[i]->startFrame < startFrame + length; i++)
+            needed.push_back(chunks[i]);
+    }
+
+    int numRead = 0;
+    std::vector<float> decoded;
+
+    for (int i = 0; i < needed.size(); i++) {
+
+        const HistoryChunk *chunk = needed[i].get();
+        if (channel >= chunk->channels.size())
+            continue;
+
+        long long begin = startFrame > chunk->startFrame ? startFrame : chunk->startFrame;
+        long long end = startFrame + length < chunk->startFrame + chunk->length ? startFrame + length : chunk->startFrame + chunk->length;
+        const std::vector<unsigned char> &data = chunk->channels[channel];
+
+        /* Whole chunk requested: decode straight into the output */
+        if (begin == chunk->startFrame && end == chunk->startFrame + chunk->length) {
+            if (decodeChannel(data.data(), data.size(), outBuffer + (begin - startFrame), chunk->length))
+                numRead += chunk->length;
+            continue;
+        }
+
+        decoded.resize(chunk->length);
+        if (!decodeChannel(data.data(), data.size(), &decoded[0], chunk->length))
+            continue;
+        memcpy(outBuffer + (begin - startFrame), &decoded[begin - chunk->startFrame], (end - begin) * sizeof(float));
+        numRead += (int)(end - begin);
+    }
+
+    return numRead;
+}
+
+long long CompressedHistory::getOldestFrame() {
+
+    std::lock_guard<std::mutex> lock(chunksMutex);
+    return chunks.empty() ? encodedFrame : chunks.front()->startFrame;
+}
+
+long long CompressedHistory::getEndFrame() {
+
+    std::lock_guard<std::mutex> lock(chunksMutex);
+    return chunks.empty() ? encodedFrame : chunks.back()->startFrame + chunks.back()->length;
+}
+
+float CompressedHistory::getCompressionRatio() {
+
+    size_t bytes = totalBytes;
+    return bytes > 0 ? (float)totalFrames * numChannels * sizeof(float) / bytes : 0.0f;
+}
+
+#pragma mark - Codec
+/* Channel bitstream:
+    2 bits mode
+    constant:   32 bits (float bits)
+    verbatim:   32 bits per sample
+    predicted:  5 bits q (samples are integers / 2^q), 1 bit LPC, 4 bits order,
+                [LPC: 5 bits shift, order coefficients of kHistoryLPCPrecision bits],
+                order warm-up samples of 32 bits,
+                then for each kHistoryPartitionLength partition (the first starting after the warm-up): 5 bits Rice parameter and the zigzagged residuals */
+void CompressedHistory::encodeChannel(const float *x, int length, std::vector<unsigned char> &out) {
+
+    out.clear();
+    HistoryBitWriter writer(out);
+    uint32_t bits;
+
+    /* Constant */
+    bool constant = true;
+    for (int i = 1; i < length && constant; i++)
+        constant = !memcmp(&x[i], &x[0], sizeof(float));
+    if (constant) {
+        memcpy(&bits, &x[0], sizeof(float));
+        writer.write(kHistoryModeConstant, 2);
+        writer.write(bits, 32);
+        writer.flush();
+        return;
+    }
+
+    /* Verbatim, if the samples aren't integers at any usable scale */
+    int q = integerShift(x, length);
+    if (q < 0) {
+        writer.write(kHistoryModeVerbatim, 2);
+        for (int i = 0; i < length; i++) {
+            memcpy(&bits, &x[i], sizeof(float));
+            writer.write(bits, 32);
+        }
+        writer.flush();
+        return;
+    }
+
+    std::vector<int32_t> v(length), residual(length), best(length);
+    for (int i = 0; i < length; i++)
+        v[i] = (int32_t)ldexpf(x[i], q);
+
+    /* Try the fixed predictors and a couple of LPC orders; keep whichever codes smallest */
+    long long bestBits = -1;
+    int bestOrder = 0, bestShift = 0;
+    bool bestLPC = false;
+    int32_t bestCoefficients[kHistoryMaxLPCOrder], coefficients[kHistoryMaxLPCOrder];
+
+    for (int order = 0; order <= kHistoryMaxFixedOrder && order < length; order++) {
+        if (!fixedResidual(&v[0], length, order, &residual[0]))
+            continue;
+        long long total = riceBits(&residual[0], order, length, NULL) + 32 * order;
+        if (bestBits < 0 || total < bestBits) {
+            bestBits = total;
+            bestOrder = order;
+            bestLPC = false;
+            best.swap(residual);
+        }
+    }
+
+    for (int order = kHistoryMaxLPCOrder / 2; order <= kHistoryMaxLPCOrder; order *= 2) {
+        int shift;
+        if (!lpcResidual(&v[0], length, order, coefficients, &shift, &residual[0]))
+            continue;
+        long long total = riceBits(&residual[0], order, length, NULL) + 32 * order + 5 + kHistoryLPCPrecision * order;
+        if (bestBits < 0 || total < bestBits) {
+            bestBits = total;
+            bestOrder = order;
+            bestLPC = true;
+            bestShift = shift;
+            memcpy(bestCoefficients, coefficients, order * sizeof(int32_t));
+            best.swap(residual);
+        }
+    }
+
+    /* Nothing fit (can't happen for order 0, but be safe) */
+    if (bestBits < 0 || bestBits > 32LL * length) {
+        writer.write(kHistoryModeVerbatim, 2);
+        for (int i = 0; i < length; i++) {
+            memcpy(&bits, &x[i], sizeof(float));
+            writer.write(bits, 32);
+        }
+        writer.flush();
+        return;
+    }
+
+    writer.write(kHistoryModePredicted, 2);
+    writer.write(q, 5);
+    writer.write(bestLPC ? 1 : 0, 1);
+    writer.write(bestOrder, 4);
+    if (bestLPC) {
+        writer.write(bestShift, 5);
+        for (int j = 0; j < bestOrder; j++)
+            writer.write((uint32_t)bestCoefficients[j], kHistoryLPCPrecision);
+    }
+    for (int i = 0; i < bestOrder; i++)
+        writer.write((uint32_t)v[i], 32);
+
+    int numPartitions = (length + kHistoryPartitionLength - 1) / kHistoryPartitionLength;
+    std::vector<int> k(numPartitions);
+    riceBits(&best[0], bestOrder, length, &k[0]);
+
+    for (int p = 0; p < numPartitions; p++) {
+        int begin = p == 0 ? bestOrder : p * kHistoryPartitionLength;
+        int end = (p + 1) * kHistoryPartitionLength < length ? (p + 1) * kHistoryPartitionLength : length;
+        writer.write(k[p], 5);
+        if (k[p] == kHistoryZeroPartition)
+            continue;
+        for (int i = begin; i < end; i++)
+            writer.writeRice(zigzag(best[i]), k[p]);
+    }
+
+    writer.flush();
+}
+
+bool CompressedHistory::decodeChannel(const unsigned char *data, size_t size, float *x, int length) {
+
+    HistoryBitReader reader(data, size);
+    uint32_t bits;
+
+    int mode = reader.read(2);
+
+    if (mode == kHistoryModeConstant) {
+        bits = reader.read(32);
+        float value;
+        memcpy(&value, &bits, sizeof(float));
+        for (int i = 0; i < length; i++)
+            x[i] = value;
+        return !reader.overrun;
+    }
+
+    if (mode == kHistoryModeVerbatim) {
+        for (int i = 0; i < length; i++) {
+            bits = reader.read(32);
+            memcpy(&x[i], &bits, sizeof(float));
+        }
+        return !reader.overrun;
+    }
+
+    if (mode != kHistoryModePredicted)
+        return false;
+
+    int q = reader.read(5);
+    bool lpc = reader.read(1);
+    int order = reader.read(4);
+    if (order > (lpc ? kHistoryMaxLPCOrder : kHistoryMaxFixedOrder) || order > length)
+        return false;
+
+    int shift = 0;
+    int32_t coefficients[kHistoryMaxLPCOrder];
+    if (lpc) {
+        shift = reader.read(5);
+        for (int j = 0; j < order; j++) {
+            int32_t c = (int32_t)reader.read(kHistoryLPCPrecision);
+            coefficients[j] = (c << (32 - kHistoryLPCPrecision)) >> (32 - kHistoryLPCPrecision);     // Sign-extend
+        }
+    }
+    else {
+        static const int fixed[kHistoryMaxFixedOrder + 1][kHistoryMaxFixedOrder] = {
+            {0, 0, 0, 0}, {1, 0, 0, 0}, {2, -1, 0, 0}, {3, -3, 1, 0}, {4, -6, 4, -1}
+        };
+        for (int j = 0; j < order; j++)
+            coefficients[j] = fixed[order][j];
+    }
+
+    /* Reconstruct integers in place in x's storage, then scale back to float */
+    int32_t *v = (int32_t *)x;
+    for (int i = 0; i < order; i++)
+        v[i] = (int32_t)reader.read(32);
+
+    int numPartitions = (length + kHistoryPartitionLength - 1) / kHistoryPartitionLength;
+    for (int p = 0; p < numPartitions; p++) {
+
+        int begin = p == 0 ? order : p * kHistoryPartitionLength;
+        int end = (p + 1) * kHistoryPartitionLength < length ? (p + 1) * kHistoryPartitionLength : length;
+        int k = reader.read(5);
+
+        for (int i = begin; i < end; i++) {
+            int64_t prediction = 0;
+            for (int j = 0; j < order; j++)
+                prediction += (int64_t)coefficients[j] * v[i - 1 - j];
+            int32_t r = k == kHistoryZeroPartition ? 0 : unzigzag(reader.readRice(k));
+            v[i] = (int32_t)(r + (prediction >> shift));
+        }
+
+        if (reader.overrun)
+            return false;
+    }
+
+    for (int i = 0; i < length; i++)
+        x[i] = ldexpf((float)v[i], -q);
+
+    return true;
+}
+
+#pragma mark - Private Methods
+void CompressedHistory::encoderLoop() {
+
+    while (running) {
+
+        bool encoded = false;
+        while (running && encodeNextChunk())
+            encoded = true;
+
+        if (!encoded)
+            std::this_thread::sleep_for(std::chrono::duration<float>(kHistoryPollInterval));
+    }
+}
+
+/* Encode the next complete chunk from the recording buffers, if there is one */
+bool CompressedHistory::encodeNextChunk() {
+
+    if (numChannels <= 0)
+        return false;
+
+    long long recorded = audioController->getNumRecordedFrames();
+    long long oldest = recorded - audioController->getRecordingBufferLength();
+
+    /* If we fell behind far enough that frames aged out, skip them (reads of the gap give zeros) */
+    if (encodedFrame < oldest)
+        encodedFrame = oldest;
+
+    if (recorded - encodedFrame < kHistoryChunkLength)
+        return false;
+
+    std::shared_ptr<HistoryChunk> chunk = std::make_shared<HistoryChunk>();
+    chunk->startFrame = encodedFrame;
+    chunk->length = kHistoryChunkLength;
+    chunk->channels.resize(numChannels);
+    chunk->bytes = 0;
+
+    audioController->getRecordingBuffersFrom(&blockRows[0], numChannels, encodedFrame, kHistoryChunkLength);
+    for (int channel = 0; channel < numChannels; channel++) {
+        encodeChannel(&blocks[channel][0], kHistoryChunkLength, chunk->channels[channel]);
+        chunk->channels[channel].shrink_to_fit();
+        chunk->bytes += chunk->channels[channel].size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(chunksMutex);
+        chunks.push_back(chunk);
+        totalBytes += chunk->bytes;
+        totalFrames += chunk->length;
+        trim();
+    }
+
+    encodedFrame += kHistoryChunkLength;
+    return true;
+}
+
+/* Drop chunks older than maxDuration, and the oldest of the rest while we're over maxBytes. Called with chunksMutex held. */
+void CompressedHistory::trim() {
+
+    if (chunks.empty())
+        return;
+
+    long long end = chunks.back()->startFrame + chunks.back()->length;
+    while (!chunks.empty() && (end - chunks.front()->startFrame > (long long)(maxDuration * sampleRate) || totalBytes > maxBytes)) {
+        totalBytes -= chunks.front()->bytes;
+        totalFrames -= chunks.front()->length;
+        chunks.pop_front();
+    }
+}
@@ -0,0 +1,108 @@
+//
+//  CompressedHistory.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef CompressedHistory_hpp
+#define CompressedHistory_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#define kHistoryChunkLength (4096)          // Frames per independently decodable chunk
+#define kHistoryPartitionLength (256)       // Samples sharing one Rice parameter
+#define kHistoryMaxLPCOrder (8)
+#define kHistoryLPCPrecision (14)           // Bits per quantized LPC coefficient
+#define kHistoryRiceEscape (24)             // Unary quotients this long are followed by the raw value instead
+#define kHistoryLongDuration (3600.0f)      // Seconds kept before the oldest chunks are dropped
+#define kHistoryDefaultMaxBytes ((size_t)256 << 20)     // Compressed bytes kept before the oldest chunks are dropped, whatever their age
+#define kHistoryPollInterval (0.05f)        // Seconds between checks for newly recorded chunks
+
+class AudioController;
+
+/* One chunk of compressed history: every channel for kHistoryChunkLength frames, each channel decodable by itself */
+struct HistoryChunk {
+    long long startFrame;
+    int length;
+    std::vector<std::vector<unsigned char> > channels;
+    size_t bytes;
+};
+
+/* Lossless compressed tier behind the recording buffers, for long lookback.
+
+    A background thread reads each complete chunk from the recording buffers (well before it ages out) and encodes it, so the audio thread does no extra work. Each channel of a chunk is coded separately:
+        - Constant channels store a single value.
+        - Samples that are exactly integers over some power of two (16- or 24-bit converter data) are mapped to those integers, predicted with a fixed polynomial or quantized LPC predictor (whichever leaves the smaller residual), and the residual is Rice-coded in partitions with their own parameters. All-zero partitions cost five bits.
+        - Anything else (processed or synthetic floats) is stored verbatim.
+    Decoding is bit exact. Readers lock only long enough to take references to the chunks they need, then decode just the requested channel of those chunks. */
+class CompressedHistory {
+
+    AudioController *audioController;
+    float maxDuration;
+    size_t maxBytes;
+
+    int numChannels;
+    float sampleRate;
+    long long encodedFrame;         // Next recorded frame to encode
+
+    std::deque<std::shared_ptr<const HistoryChunk> > chunks;
+    std::mutex chunksMutex;
+    std::atomic<size_t> totalBytes;
+    std::atomic<unsigned long long> totalFrames;    // Frames currently held, for the compression ratio
+
+    std::thread encoderThread;
+    std::atomic<bool> running;
+    std::vector<std::vector<float> > blocks;    // One chunk of every channel, read from the recording buffers at once
+    std::vector<float *> blockRows;
+
+#pragma mark - Private Methods
+    void encoderLoop();
+    bool encodeNextChunk();
+    void trim();
+
+public:
+
+    /* Constructor/Destructor */
+    CompressedHistory(AudioController *ac, float duration = kHistoryLongDuration, size_t byteBudget = kHistoryDefaultMaxBytes);
+    ~CompressedHistory();
+
+    /* Starting/stopping the encoder thread */
+    bool start();
+    void stop();
+    bool isRunning() { return running; }
+
+    /* Forget everything and pick up the controller's current channel count and sample rate. Call while stopped. */
+    void reset();
+
+    /* Keep at most duration seconds and byteBudget compressed bytes, dropping the oldest chunks now if we're over */
+    void setLimits(float duration, size_t byteBudget);
+
+    /* Decode frames [startFrame, startFrame + length) of a channel. Frames we don't have read as zeros. Returns the number of frames we had. */
+    int read(float *outBuffer, int channel, long long startFrame, int length);
+
+    /* Getters */
+    long long getOldestFrame();
+    long long getEndFrame();        // One past the newest encoded frame
+    size_t getMemoryUsage() { return totalBytes; }
+    float getCompressionRatio();    // Relative to 32-bit float
+    float getMaxDuration() { return maxDuration; }
+    size_t getMaxBytes() { return maxBytes; }
+
+    /* Codec for one channel of one chunk */
+    static void encodeChannel(const float *x, int length, std::vector<unsigned char> &out);
+    static bool decodeChannel(const unsigned char *data, size_t size, float *x, int length);
+};
+
+#endif /* CompressedHistory_hpp */
@@ -0,0 +1,312 @@
+//
+//  CrossChannelAnalyzer.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "CrossChannelAnalyzer.hpp"
+
+CrossChannelAnalyzer::CrossChannelAnalyzer(float fs, int nChannels, int nFFT, float overlap) : sampleRate(fs), numChannels(nChannels), fftSize(4096), segmentFill(0), numSegments(0), stale(false), smoothingTime(1.0f), fftSetup(NULL) {
+
+    if (nFFT < 16 || (nFFT & (nFFT - 1))) {
+        printf("%s: Invalid FFT size %d. Must be a power of two >= 16. Using %d.\n", __PRETTY_FUNCTION__, nFFT, fftSize);
+        nFFT = fftSize;
+    }
+    fftSize = nFFT;
+    log2FFTSize = (int)log2f(fftSize);
+    numBins = fftSize / 2;
+    segmentLength = fftSize / 2;
+    maxLag = segmentLength / 2;
+
+    if (overlap < 0.0f || overlap >= 1.0f) {
+        printf("%s: Invalid overlap %f. Using 0.5.\n", __PRETTY_FUNCTION__, overlap);
+        overlap = 0.5f;
+    }
+    hopSize = (int)floorf(segmentLength * (1.0f - overlap) + 0.5f);
+    hopSize = hopSize < 1 ? 1 : hopSize;
+
+    numPairs = numChannels * (numChannels - 1) / 2;
+
+    segments.resize(numChannels);
+    spectraReal.resize(numChannels);
+    spectraImag.resize(numChannels);
+    autoSpectra.resize(numChannels);
+    for (int i = 0; i < numChannels; i++) {
+        segments[i].assign(segmentLength, 0.0f);
+        spectraReal[i].assign(numBins, 0.0f);
+        spectraImag[i].assign(numBins, 0.0f);
+        autoSpectra[i].assign(numBins, 0.0f);
+    }
+
+    crossReal.resize(numPairs);
+    crossImag.resize(numPairs);
+    for (int i = 0; i < numPairs; i++) {
+        crossReal[i].assign(numBins, 0.0f);
+        crossImag[i].assign(numBins, 0.0f);
+    }
+
+    delays.assign(numPairs, 0.0f);
+    peaks.assign(numPairs, 0.0f);
+    coherence.assign(numPairs, 0.0f);
+
+    /* FFT buffers; the window covers the segment and the rest of the FFT is zero padding */
+    window.resize(segmentLength);
+    padded.assign(fftSize, 0.0f);
+    correlation.resize(fftSize);
+    scratchReal.resize(numBins);
+    scratchImag.resize(numBins);
+    scratchMagnitude.resize(numBins);
+    vDSP_hann_window(&window[0], segmentLength, vDSP_HANN_NORM);
+    fftSetup = vDSP_create_fftsetup(log2FFTSize, FFT_RADIX2);
+
+    setSmoothingTime(smoothingTime);
+}
+
+CrossChannelAnalyzer::~CrossChannelAnalyzer() {
+    if (fftSetup)
+        vDSP_destroy_fftsetup(fftSetup);
+}
+
+#pragma mark - Interface Methods
+void CrossChannelAnalyzer::process(const float * const *input, int length) {
+
+    int offset = 0;
+    while (offset < length) {
+
+        int n = segmentLength - segmentFill;
+        n = n > length - offset ? length - offset : n;
+
+        for (int channel = 0; channel < numChannels; channel++)
+            memcpy(&segments[channel][segmentFill], input[channel] + offset, n * sizeof(float));
+
+        segmentFill += n;
+        offset += n;
+
+        if (segmentFill < segmentLength)
+            break;
+
+        analyzeSegment();
+
+        for (int channel = 0; channel < numChannels; channel++)
+            memmove(&segments[channel][0], &segments[channel][hopSize], (segmentLength - hopSize) * sizeof(float));
+        segmentFill = segmentLength - hopSize;
+    }
+}
+
+void CrossChannelAnalyzer::computeCorrelations() {
+
+    if (!stale)
+        return;
+
+    for (int a = 0, pair = 0; a < numChannels; a++)
+        for (int b = a + 1; b < numChannels; b++, pair++)
+            correlatePair(pair, a, b);
+
+    stale = false;
+}
+
+void CrossChannelAnalyzer::reset() {
+
+    segmentFill = 0;
+    numSegments = 0;
+    stale = false;
+
+    for (int i = 0; i < numChannels; i++)
+        vDSP_vclr(&autoSpectra[i][0], 1, numBins);
+
+    for (int i = 0; i < numPairs; i++) {
+        vDSP_vclr(&crossReal[i][0], 1, numBins);
+        vDSP_vclr(&crossImag[i][0], 1, numBins);
+        delays[i] = peaks[i] = coherence[i] = 0.0f;
+    }
+}
+
+void CrossChannelAnalyzer::setSmoothingTime(float seconds) {
+
+    smoothingTime = seconds < 0.0f ? 0.0f : seconds;
+    smoothingCoefficient = smoothingTime > 0.0f ? expf(-(hopSize / sampleRate) / smoothingTime) : 0.0f;
+}
+
+bool CrossChannelAnalyzer::setMaxLag(float seconds) {
+
+    int lag = (int)ceilf(seconds * sampleRate);
+
+    if (lag < 1 || lag >= segmentLength) {
+        printf("%s: Invalid max lag %f s. Must be less than %f s at this FFT size.\n", __PRETTY_FUNCTION__, seconds, segmentLength / sampleRate);
+        return false;
+    }
+
+    maxLag = lag;
+    stale = numSegments > 0;
+    return true;
+}
+
+float CrossChannelAnalyzer::getDelay(int a, int b) {
+    return getDelaySamples(a, b) / sampleRate;
+}
+
+float CrossChannelAnalyzer::getDelaySamples(int a, int b) {
+
+    int pair = pairIndex(a, b);
+    if (pair < 0)
+        return 0.0f;
+
+    return a < b ? delays[pair] : -delays[pair];
+}
+
+float CrossChannelAnalyzer::getCorrelationPeak(int a, int b) {
+
+    int pair = pairIndex(a, b);
+    return pair < 0 ? 0.0f : peaks[pair];
+}
+
+float CrossChannelAnalyzer::getCoherence(int a, int b) {
+
+    int pair = pairIndex(a, b);
+    return pair < 0 ? 0.0f : coherence[pair];
+}
+
+#pragma mark - Private Methods
+/* Transform every channel's segment once, then fold the spectra into the auto- and cross-spectrum accumulators */
+void CrossChannelAnalyzer::analyzeSegment() {
+
+    DSPSplitComplex split;
+    float c = numSegments == 0 ? 0.0f : smoothingCoefficient;      // First segment initializes the accumulators
+    float oneMinus = 1.0f - c;
+
+    for (int channel = 0; channel < numChannels; channel++) {
+
+        vDSP_vmul(&segments[channel][0], 1, &window[0], 1, &padded[0], 1, segmentLength);
+
+        split.realp = &spectraReal[channel][0];
+        split.imagp = &spectraImag[channel][0];
+        vDSP_ctoz((DSPComplex *)&padded[0], 2, &split, 1, numBins);
+        vDSP_fft_zrip(fftSetup, &split, 1, log2FFTSize, FFT_FORWARD);
+
+        /* |X|^2. Bin 0 packs DC and Nyquist; keep just DC there. */
+        vDSP_zvmags(&split, 1, &scratchMagnitude[0], 1, numBins);
+        scratchMagnitude[0] = split.realp[0] * split.realp[0];
+
+        float *autoSpectrum = &autoSpectra[channel][0];
+        vDSP_vsmsma(autoSpectrum, 1, &c, &scratchMagnitude[0], 1, &oneMinus, autoSpectrum, 1, numBins);
+    }
+
+    /* X_a * conj(X_b) for every pair */
+    DSPSplitComplex xa, xb, cross;
+    cross.realp = &scratchReal[0];
+    cross.imagp = &scratchImag[0];
+
+    for (int a = 0, pair = 0; a < numChannels; a++) {
+
+        xa.realp = &spectraReal[a][0];
+        xa.imagp = &spectraImag[a][0];
+
+        for (int b = a + 1; b < numChannels; b++, pair++) {
+
+            xb.realp = &spectraReal[b][0];
+            xb.imagp = &spectraImag[b][0];
+
+            /* zvmul with conjugate = -1 conjugates its first operand */
+            vDSP_zvmul(&xb, 1, &xa, 1, &cross, 1, numBins, -1);
+
+            /* Bin 0 packs two real values (DC, Nyquist), which multiply separately */
+            cross.realp[0] = xa.realp[0] * xb.realp[0];
+            cross.imagp[0] = xa.imagp[0] * xb.imagp[0];
+
+            vDSP_vsmsma(&crossReal[pair][0], 1, &c, cross.realp, 1, &oneMinus, &crossReal[pair][0], 1, numBins);
+            vDSP_vsmsma(&crossImag[pair][0], 1, &c, cross.imagp, 1, &oneMinus, &crossImag[pair][0], 1, numBins);
+        }
+    }
+
+    numSegments++;
+    stale = true;
+}
+
+/* Whiten a pair's cross-spectrum (PHAT), inverse transform it and find the correlation peak */
+void CrossChannelAnalyzer::correlatePair(int pair, int a, int b) {
+
+    const float *gr = &crossReal[pair][0];
+    const float *gi = &crossImag[pair][0];
+    const float *saa = &autoSpectra[a][0];
+    const float *sbb = &autoSpectra[b][0];
+
+    DSPSplitComplex g;
+    g.realp = (float *)gr;
+    g.imagp = (float *)gi;
+    vDSP_zvabs(&g, 1, &scratchMagnitude[0], 1, numBins);
+    scratchMagnitude[0] = fabsf(gr[0]);
+
+    float maxMagnitude;
+    vDSP_maxv(&scratchMagnitude[1], 1, &maxMagnitude, numBins - 1);
+    float floor = maxMagnitude * kCrossChannelPHATFloor + 1e-30f;
+
+    /* Coherence: mean of |Gab|^2 / (Saa Sbb) over bins with energy in both channels */
+    float cohSum = 0.0f;
+    int cohBins = 0;
+    for (int k = 1; k < numBins; k++) {
+        float denominator = saa[k] * sbb[k];
+        if (scratchMagnitude[k] > floor && denominator > 0.0f) {
+            cohSum += scratchMagnitude[k] * scratchMagnitude[k] / denominator;
+            cohBins++;
+        }
+    }
+    coherence[pair] = cohBins > 0 ? cohSum / cohBins : 0.0f;
+
+    /* PHAT weighting: keep only the phase of each bin. Drop DC and Nyquist, which carry no delay information. */
+    scratchReal[0] = scratchImag[0] = 0.0f;
+    for (int k = 1; k < numBins; k++) {
+        float m = scratchMagnitude[k];
+        if (m > floor) {
+            scratchReal[k] = gr[k] / m;
+            scratchImag[k] = gi[k] / m;
+        }
+        else
+            scratchReal[k] = scratchImag[k] = 0.0f;
+    }
+
+    /* Inverse transform. A pure delay gives a peak of 2 * (numBins - 1) (one per nonzero bin, counting the mirrored half) */
+    DSPSplitComplex w;
+    w.realp = &scratchReal[0];
+    w.imagp = &scratchImag[0];
+    vDSP_fft_zrip(fftSetup, &w, 1, log2FFTSize, FFT_INVERSE);
+    vDSP_ztoc(&w, 1, (DSPComplex *)&correlation[0], 2, numBins);
+
+    /* Search lags in [-maxLag, maxLag]; negative lags wrap to the end of the circular correlation */
+    int bestLag = 0;
+    float best = correlation[0];
+    for (int lag = -maxLag; lag <= maxLag; lag++) {
+        float v = correlation[(lag + fftSize) % fftSize];
+        if (v > best) {
+            best = v;
+            bestLag = lag;
+        }
+    }
+
+    /* Parabolic interpolation around the peak for a sub-sample estimate */
+    float left = correlation[(bestLag - 1 + fftSize) % fftSize];
+    float right = correlation[(bestLag + 1 + fftSize) % fftSize];
+    float curvature = left - 2.0f * best + right;
+    float offset = curvature < 0.0f ? 0.5f * (left - right) / curvature : 0.0f;
+
+    delays[pair] = bestLag + offset;
+    peaks[pair] = best / (2.0f * (numBins - 1));
+}
+
+int CrossChannelAnalyzer::pairIndex(int a, int b) {
+
+    if (a < 0 || b < 0 || a >= numChannels || b >= numChannels || a == b) {
+        printf("%s: Invalid channel pair (%d, %d). %d channels.\n", __PRETTY_FUNCTION__, a, b, numChannels);
+        return -1;
+    }
+
+    if (a > b) {
+        int t = a;
+        a = b;
+        b = t;
+    }
+
+    /* Row-major index of (a, b) among pairs with a < b */
+    return a * numChannels - a * (a + 1) / 2 + (b - a - 1);
+}
@@ -0,0 +1,107 @@
+//
+//  CrossChannelAnalyzer.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef CrossChannelAnalyzer_hpp
+#define CrossChannelAnalyzer_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <Accelerate/Accelerate.h>
+#include <vector>
+
+#define kCrossChannelPHATFloor (1e-9f)      // PHAT weights ignore bins below this fraction of the strongest one
+
+/* Streaming inter-channel delay and coherence estimator (GCC-PHAT) for all pairs of input channels.
+
+    Input is cut into Hann-windowed segments of fftSize/2 samples, zero-padded to fftSize so lags up to +/- fftSize/2 don't wrap. Each channel's spectrum is computed once per segment and every pair's cross-spectrum and each channel's auto-spectrum are folded into exponentially-smoothed accumulators. computeCorrelations() then whitens each pair's cross-spectrum, inverse transforms it and picks the peak, so the per-frame cost is one inverse FFT per pair regardless of how much history the estimate covers.
+
+    Pairs are indexed (a, b) with a < b in row-major order. A positive delay between a and b means channel a lags channel b. */
+class CrossChannelAnalyzer {
+
+    float sampleRate;
+    int numChannels;
+    int numPairs;
+    int fftSize;
+    int log2FFTSize;
+    int numBins;
+    int segmentLength;
+    int hopSize;
+    int maxLag;                     // Peak search range in samples
+
+    /* Input segment, shared fill count across channels */
+    std::vector<std::vector<float> > segments;
+    int segmentFill;
+    unsigned long numSegments;
+    bool stale;                     // New segments since the last computeCorrelations()
+
+    /* Per-channel spectra of the current segment, zrip-packed */
+    std::vector<std::vector<float> > spectraReal;
+    std::vector<std::vector<float> > spectraImag;
+
+    /* Smoothed spectra: auto per channel, cross per pair (zrip-packed) */
+    std::vector<std::vector<float> > autoSpectra;
+    std::vector<std::vector<float> > crossReal;
+    std::vector<std::vector<float> > crossImag;
+    float smoothingTime;
+    float smoothingCoefficient;
+
+    /* Results per pair */
+    std::vector<float> delays;      // Samples
+    std::vector<float> peaks;       // GCC-PHAT peak height, 1.0 for a pure delay
+    std::vector<float> coherence;   // Mean magnitude-squared coherence across bins
+
+    /* FFT */
+    FFTSetup fftSetup;
+    std::vector<float> window;
+    std::vector<float> padded;
+    std::vector<float> correlation;
+    std::vector<float> scratchReal;
+    std::vector<float> scratchImag;
+    std::vector<float> scratchMagnitude;
+
+#pragma mark - Private Methods
+    void analyzeSegment();
+    void correlatePair(int pair, int a, int b);
+    int pairIndex(int a, int b);
+
+public:
+
+    /* Constructor/Destructor */
+    CrossChannelAnalyzer(float fs, int nChannels, int nFFT = 4096, float overlap = 0.5f);
+    ~CrossChannelAnalyzer();
+
+    /* Push a block of non-interleaved input, one row per channel */
+    void process(const float * const *input, int length);
+
+    /* Update delays, peaks and coherence for every pair from the smoothed spectra. Does nothing if no segments have arrived since the last call. */
+    void computeCorrelations();
+
+    /* Clear all accumulators and any partial segment */
+    void reset();
+
+    /* Setters */
+    void setSmoothingTime(float seconds);
+    bool setMaxLag(float seconds);
+
+    /* Per-pair results, valid after computeCorrelations(). Swapping a and b negates the delay. */
+    float getDelay(int a, int b);               // Seconds
+    float getDelaySamples(int a, int b);
+    float getCorrelationPeak(int a, int b);
+    float getCoherence(int a, int b);
+
+    /* Getters */
+    int getNumChannels() { return numChannels; }
+    int getNumPairs() { return numPairs; }
+    int getFFTSize() { return fftSize; }
+    float getSampleRate() { return sampleRate; }
+    unsigned long getNumSegments() { return numSegments; }
+    int getPrimingLength() { return segmentLength + (int)(smoothingTime * sampleRate); }   // Input samples behind a settled estimate (one smoothing time constant)
+};
+
+#endif /* CrossChannelAnalyzer_hpp */
@@ -0,0 +1,485 @@
+//
+//  DeviceAggregator.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "DeviceAggregator.hpp"
+
+#pragma mark - SampleFifo
+SampleFifo::SampleFifo(int nChannels, int capacityFrames) : numChannels(nChannels), capacity(capacityFrames), writeCount(0), readCount(0) {
+    data.assign((size_t)capacity * numChannels, 0.0f);
+}
+
+int SampleFifo::write(const float *interleaved, int numFrames) {
+
+    unsigned long long w = writeCount.load(std::memory_order_relaxed);
+    unsigned long long r = readCount.load(std::memory_order_acquire);
+    int space = capacity - (int)(w - r);
+    int n = numFrames < space ? numFrames : space;
+
+    /* Copy in up to two pieces around the end of the ring */
+    int start = (int)(w % capacity);
+    int first = n < capacity - start ? n : capacity - start;
+    memcpy(&data[(size_t)start * numChannels], interleaved, (size_t)first * numChannels * sizeof(float));
+    memcpy(&data[0], interleaved + (size_t)first * numChannels, (size_t)(n - first) * numChannels * sizeof(float));
+
+    writeCount.store(w + n, std::memory_order_release);
+    return n;
+}
+
+int SampleFifo::read(float *interleaved, int numFrames) {
+
+    unsigned long long r = readCount.load(std::memory_order_relaxed);
+    unsigned long long w = writeCount.load(std::memory_order_acquire);
+    int available = (int)(w - r);
+    int n = numFrames < available ? numFrames : available;
+
+    int start = (int)(r % capacity);
+    int first = n < capacity - start ? n : capacity - start;
+    memcpy(interleaved, &data[(size_t)start * numChannels], (size_t)first * numChannels * sizeof(float));
+    memcpy(interleaved + (size_t)first * numChannels, &data[0], (size_t)(n - first) * numChannels * sizeof(float));
+
+    readCount.store(r + n, std::memory_order_release);
+    return n;
+}
+
+#pragma mark - ClockDriftEstimator
+ClockDriftEstimator::ClockDriftEstimator(double nominal) : nominalRate(nominal) {
+    reset();
+}
+
+void ClockDriftEstimator::reset() {
+    numPoints = 0;
+    next = 0;
+    lastTime = 0.0;
+    rate = nominalRate;
+    valid = false;
+}
+
+bool ClockDriftEstimator::update(double time, double frame) {
+
+    /* Some host APIs don't report buffer times */
+    if (time <= 0.0)
+        return false;
+
+    if (numPoints > 0 && time - lastTime < kDriftPointInterval)
+        return false;
+
+    times[next] = time;
+    frames[next] = frame;
+    next = (next + 1) % kDriftNumPoints;
+    numPoints = numPoints < kDriftNumPoints ? numPoints + 1 : kDriftNumPoints;
+    lastTime = time;
+
+    if (numPoints < kDriftMinPoints)
+        return false;
+
+    /* Least-squares slope, relative to the oldest point to keep the sums small */
+    int oldest = (next - numPoints + kDriftNumPoints) % kDriftNumPoints;
+    double t0 = times[oldest], f0 = frames[oldest];
+    double st = 0.0, sf = 0.0, stt = 0.0, stf = 0.0;
+    for (int i = 0; i < numPoints; i++) {
+        double t = times[i] - t0;
+        double f = frames[i] - f0;
+        st += t;
+        sf += f;
+        stt += t * t;
+        stf += t * f;
+    }
+
+    double denominator = numPoints * stt - st * st;
+    if (denominator <= 0.0)
+        return false;
+
+    double slope = (numPoints * stf - st * sf) / denominator;
+
+    /* Anything this far off is a timestamp glitch (or a device that restarted), not drift */
+    if (fabs(slope / nominalRate - 1.0) > kResamplerMaxRatioDeviation) {
+        reset();
+        return false;
+    }
+
+    rate = slope;
+    valid = true;
+    return true;
+}
+
+#pragma mark - DeviceAggregator
+DeviceAggregator::DeviceAggregator() : numChannels(0), isOpen(false), primaryRate(0.0), primaryClock(NULL), primaryFrames(0) {}
+
+DeviceAggregator::~DeviceAggregator() {
+    removeAll();
+}
+
+int DeviceAggregator::addDevice(PaDeviceIndex deviceIndex, int nChannels) {
+
+    if (isOpen) {
+        printf("%s: Close the aggregate before adding devices\n", __PRETTY_FUNCTION__);
+        return -1;
+    }
+
+    const PaDeviceInfo *info = Pa_GetDeviceInfo(deviceIndex);
+    if (!info) {
+        printf("%s: Invalid device index %d\n", __PRETTY_FUNCTION__, deviceIndex);
+        return -1;
+    }
+    if (nChannels <= 0 || nChannels > info->maxInputChannels) {
+        printf("%s: Invalid number of input channels %d for %s. Maximum = %d\n", __PRETTY_FUNCTION__, nChannels, info->name, info->maxInputChannels);
+        return -1;
+    }
+    for (int i = 0; i < (int)sources.size(); i++) {
+        if (sources[i]->device == deviceIndex) {
+            printf("%s: %s is already in the aggregate\n", __PRETTY_FUNCTION__, info->name);
+            return -1;
+        }
+    }
+
+    AggregateSource *source = new AggregateSource();
+    source->name = info->name;
+    source->device = deviceIndex;
+    source->file = NULL;
+    source->stream = NULL;
+    source->numChannels = nChannels;
+    source->channelOffset = numChannels;
+    source->nominalRate = info->defaultSampleRate;
+    source->fifo = NULL;
+    source->resampler = NULL;
+    source->clock = NULL;
+
+    sources.push_back(source);
+    numChannels += nChannels;
+
+    return (int)sources.size() - 1;
+}
+
+int DeviceAggregator::addFile(std::string path, double rateOffsetPPM, int blockLength, int maxChannels) {
+
+    if (isOpen) {
+        printf("%s: Close the aggregate before adding devices\n", __PRETTY_FUNCTION__);
+        return -1;
+    }
+
+    FileInputDevice *file = new FileInputDevice(path, rateOffsetPPM, blockLength);
+    if (!file->load()) {
+        delete file;
+        return -1;
+    }
+    if (file->getNumChannels() > maxChannels) {
+        printf("%s: %s has %d channels. Maximum = %d\n", __PRETTY_FUNCTION__, path.c_str(), file->getNumChannels(), maxChannels);
+        delete file;
+        return -1;
+    }
+
+    AggregateSource *source = new AggregateSource();
+    source->name = path;
+    source->device = paNoDevice;
+    source->file = file;
+    source->stream = NULL;
+    source->numChannels = file->getNumChannels();
+    source->channelOffset = numChannels;
+    source->nominalRate = file->getSampleRate();
+    source->fifo = NULL;
+    source->resampler = NULL;
+    source->clock = NULL;
+
+    sources.push_back(source);
+    numChannels += source->numChannels;
+
+    return (int)sources.size() - 1;
+}
+
+void DeviceAggregator::removeAll() {
+
+    if (isOpen)
+        close();
+
+    for (int i = 0; i < (int)sources.size(); i++)
+        deleteSource(sources[i]);
+    sources.clear();
+    numChannels = 0;
+}
+
+/* Open each secondary at the primary's sample rate if it supports it (so the resampler only corrects drift), otherwise at its default rate */
+bool DeviceAggregator::open(double sampleRate, int blockLength) {
+
+    if (isOpen)
+        return true;
+
+    primaryRate = sampleRate;
+    primaryClock = new ClockDriftEstimator(primaryRate);
+    primaryFrames = 0;
+
+    size_t scratchLength = 0;
+
+    for (int i = 0; i < (int)sources.size(); i++) {
+
+        AggregateSource *source = sources[i];
+
+        if (source->file == NULL) {
+
+            const PaDeviceInfo *info = Pa_GetDeviceInfo(source->device);
+
+            PaStreamParameters params;
+            params.device = source->device;
+            params.channelCount = source->numChannels;
+            params.sampleFormat = paFloat32;
+            params.suggestedLatency = info->defaultLowInputLatency;
+            params.hostApiSpecificStreamInfo = NULL;
+
+            source->nominalRate = Pa_IsFormatSupported(&params, NULL, sampleRate) == paFormatIsSupported ? sampleRate : info->defaultSampleRate;
+
+            PaError error = Pa_OpenStream(&source->stream, &params, NULL, source->nominalRate, blockLength, paNoFlag, DeviceAggregator::sourceCallback, source);
+            if (error != paNoError) {
+                printf("%s: Couldn't open %s: PaError = %s\n", __PRETTY_FUNCTION__, source->name.c_str(), Pa_GetErrorText(error));
+                source->stream = NULL;
+                close();
+                return false;
+            }
+        }
+
+        source->fifo = new SampleFifo(source->numChannels, (int)(kAggregatorFifoDuration * source->nominalRate));
+        source->resampler = new AdaptiveResampler(source->numChannels, source->nominalRate / primaryRate, kAggregatorMaxBlockLength);
+        source->clock = new ClockDriftEstimator(source->nominalRate);
+
+        size_t length = (size_t)(kAggregatorMaxBlockLength * source->nominalRate / primaryRate * (1.0 + kResamplerMaxRatioDeviation) + 2 * kResamplerTaps) * source->numChannels;
+        scratchLength = length > scratchLength ? length : scratchLength;
+
+        printf("%s: %s: %d channels at %.0f Hz (ratio %.4f)\n", __PRETTY_FUNCTION__, source->name.c_str(), source->numChannels, source->nominalRate, source->nominalRate / primaryRate);
+    }
+
+    scratch.assign(scratchLength, 0.0f);
+    isOpen = true;
+
+    return true;
+}
+
+bool DeviceAggregator::close() {
+
+    stop();
+
+    bool success = true;
+    for (int i = 0; i < (int)sources.size(); i++) {
+
+        AggregateSource *source = sources[i];
+
+        if (source->stream) {
+            PaError error = Pa_CloseStream(source->stream);
+            if (error != paNoError) {
+                printf("%s: Couldn't close %s: PaError = %s\n", __PRETTY_FUNCTION__, source->name.c_str(), Pa_GetErrorText(error));
+                success = false;
+            }
+            source->stream = NULL;
+        }
+
+        delete source->fifo;
+        delete source->resampler;
+        delete source->clock;
+        source->fifo = NULL;
+        source->resampler = NULL;
+        source->clock = NULL;
+    }
+
+    delete primaryClock;
+    primaryClock = NULL;
+    isOpen = false;
+
+    return success;
+}
+
+bool DeviceAggregator::start() {
+
+    if (!isOpen)
+        return false;
+
+    primaryClock->reset();
+    primaryFrames = 0;
+
+    bool success = true;
+    for (int i = 0; i < (int)sources.size(); i++) {
+
+        AggregateSource *source = sources[i];
+
+        source->fifo->reset();
+        source->resampler->reset();
+        source->clock->reset();
+        source->framesReceived = 0;
+        source->maxBlockLength = 0;
+        source->fillAverage = 0.0f;
+        source->primed = false;
+        source->ratio = source->resampler->getNominalRatio();
+        source->underflows = 0;
+        source->overflows = 0;
+
+        if (source->file)
+            success &= source->file->start(DeviceAggregator::sourceCallback, source);
+        else {
+            PaError error = Pa_StartStream(source->stream);
+            if (error != paNoError) {
+                printf("%s: Couldn't start %s: PaError = %s\n", __PRETTY_FUNCTION__, source->name.c_str(), Pa_GetErrorText(error));
+                success = false;
+            }
+        }
+    }
+
+    return success;
+}
+
+bool DeviceAggregator::stop() {
+
+    if (!isOpen)
+        return false;
+
+    for (int i = 0; i < (int)sources.size(); i++) {
+        if (sources[i]->file)
+            sources[i]->file->stop();
+        else if (sources[i]->stream && Pa_IsStreamActive(sources[i]->stream) == 1)
+            Pa_StopStream(sources[i]->stream);
+    }
+
+    return true;
+}
+
+void DeviceAggregator::pull(const PaStreamCallbackTimeInfo *timeInfo, unsigned long frameCount, float * const *output) {
+
+    if (!isOpen || frameCount > kAggregatorMaxBlockLength) {
+        for (int ch = 0; ch < numChannels; ch++)
+            memset(output[ch], 0, frameCount * sizeof(float));
+        return;
+    }
+
+    if (timeInfo)
+        primaryClock->update(timeInfo->inputBufferAdcTime, (double)primaryFrames);
+    primaryFrames += frameCount;
+
+    for (int i = 0; i < (int)sources.size(); i++)
+        pullSource(sources[i], frameCount, output + sources[i]->channelOffset);
+}
+
+std::vector<PaDeviceIndex> DeviceAggregator::getDevices() {
+
+    std::vector<PaDeviceIndex> devices;
+    for (int i = 0; i < (int)sources.size(); i++) {
+        if (sources[i]->device != paNoDevice)
+            devices.push_back(sources[i]->device);
+    }
+    return devices;
+}
+
+AggregateSourceStatus DeviceAggregator::getStatus(int sourceIndex) {
+
+    AggregateSourceStatus status;
+    status.numChannels = 0;
+    status.nominalRate = status.measuredRate = status.driftPPM = status.ratio = 0.0;
+    status.fifoFill = 0.0f;
+    status.underflows = status.overflows = 0;
+
+    if (sourceIndex < 0 || sourceIndex >= (int)sources.size()) {
+        printf("%s: Invalid source index %d. %d sources\n", __PRETTY_FUNCTION__, sourceIndex, (int)sources.size());
+        return status;
+    }
+
+    AggregateSource *source = sources[sourceIndex];
+    status.name = source->name;
+    status.numChannels = source->numChannels;
+    status.nominalRate = source->nominalRate;
+
+    if (!isOpen)
+        return status;
+
+    status.measuredRate = source->clock->getRate();
+    status.ratio = source->ratio;
+    status.fifoFill = source->fifo->fill();
+    status.underflows = source->underflows;
+    status.overflows = source->overflows;
+
+    /* Each device's rate error relative to nominal, compared with the primary's */
+    double relative = (status.measuredRate / source->nominalRate) / (primaryClock->getRate() / primaryRate);
+    status.driftPPM = 1e6 * (relative - 1.0);
+
+    return status;
+}
+
+#pragma mark - Private Methods
+void DeviceAggregator::deleteSource(AggregateSource *source) {
+
+    delete source->file;
+    delete source->fifo;
+    delete source->resampler;
+    delete source->clock;
+    delete source;
+}
+
+/* Resample one secondary's FIFO into frameCount frames of the primary timeline */
+void DeviceAggregator::pullSource(AggregateSource *source, unsigned long frameCount, float * const *output) {
+
+    /* Hold enough to ride out either side's callback timing: two blocks of each, plus the resampler's reach */
+    int target = 2 * (source->maxBlockLength + (int)frameCount) + kResamplerTaps;
+    int fill = source->fifo->fill();
+
+    float alpha = frameCount / (primaryRate * kAggregatorFillSmoothing);
+    alpha = alpha > 1.0f ? 1.0f : alpha;
+    source->fillAverage += alpha * (fill - source->fillAverage);
+
+    /* Wait for the FIFO to reach its target before (re)starting */
+    if (!source->primed) {
+        if (source->maxBlockLength == 0 || fill < target) {
+            for (int ch = 0; ch < source->numChannels; ch++)
+                memset(output[ch], 0, frameCount * sizeof(float));
+            return;
+        }
+        source->primed = true;
+        source->resampler->reset();
+        source->fillAverage = fill;
+    }
+
+    /* Drift-compensated ratio once both clocks are measured, trimmed so a fill error decays over kAggregatorServoTime */
+    double ratio = source->resampler->getNominalRatio();
+    if (source->clock->isValid() && primaryClock->isValid())
+        ratio = source->clock->getRate() / primaryClock->getRate();
+    ratio += (source->fillAverage - target) / (kAggregatorServoTime * primaryRate);
+
+    source->resampler->setRatio(ratio);
+    source->ratio = source->resampler->getRatio();
+
+    int needed = source->resampler->inputNeeded((int)frameCount);
+    int got = source->fifo->read(scratch.data(), needed);
+
+    /* Ran dry: fill the gap with silence and re-prime */
+    if (got < needed) {
+        memset(&scratch[(size_t)got * source->numChannels], 0, (size_t)(needed - got) * source->numChannels * sizeof(float));
+        source->underflows++;
+        source->primed = false;
+    }
+
+    source->resampler->write(scratch.data(), needed);
+    source->resampler->read(output, (int)frameCount);
+}
+
+#pragma mark - Secondary Callback
+int DeviceAggregator::sourceCallback(const void* input, void* output,
+                                     unsigned long frameCount,
+                                     const PaStreamCallbackTimeInfo* timeInfo,
+                                     PaStreamCallbackFlags statusFlags,
+                                     void *userData) {
+
+    AggregateSource *source = (AggregateSource *)userData;
+
+    if (!input)
+        return paContinue;
+
+    if (timeInfo)
+        source->clock->update(timeInfo->inputBufferAdcTime, (double)source->framesReceived);
+    source->framesReceived += frameCount;
+
+    int length = (int)frameCount;
+    if (source->fifo->write((const float *)input, length) < length)
+        source->overflows++;
+
+    if (length > source->maxBlockLength)
+        source->maxBlockLength = length;
+
+    return paContinue;
+}
@@ -0,0 +1,163 @@
+//
+//  DeviceAggregator.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef DeviceAggregator_hpp
+#define DeviceAggregator_hpp
+
+#include <stdio.h>
+#include <string.h>
+#include <portaudio.h>
+#include <vector>
+#include <string>
+#include <atomic>
+
+#include "AdaptiveResampler.hpp"
+#include "FileInputDevice.hpp"
+
+#define kAggregatorFifoDuration (0.5)           // Seconds of secondary input we can hold
+#define kAggregatorMaxBlockLength (4096)        // Longest primary callback we can fill
+#define kAggregatorServoTime (10.0)             // Seconds for the FIFO servo to correct a fill error
+#define kAggregatorFillSmoothing (1.0)          // Seconds of FIFO fill averaging
+#define kDriftPointInterval (0.25)              // Seconds between clock drift regression points
+#define kDriftNumPoints (64)                    // Regression window (16 seconds)
+#define kDriftMinPoints (8)
+
+/* Single-producer/single-consumer ring of interleaved frames, safe between one audio callback writing and another reading */
+class SampleFifo {
+
+    std::vector<float> data;
+    int numChannels;
+    int capacity;                   // Frames
+    std::atomic<unsigned long long> writeCount;
+    std::atomic<unsigned long long> readCount;
+
+public:
+
+    SampleFifo(int nChannels, int capacityFrames);
+
+    /* Return the number of frames actually written/read */
+    int write(const float *interleaved, int numFrames);
+    int read(float *interleaved, int numFrames);
+
+    int fill() { return (int)(writeCount.load(std::memory_order_acquire) - readCount.load(std::memory_order_acquire)); }
+    void reset() { readCount.store(writeCount.load()); }
+};
+
+/* Estimates a device's actual sample rate against the host clock by least-squares fitting frame count to buffer timestamps (timeInfo->inputBufferAdcTime) over a sliding window. Only the slope matters, so devices reporting time from different epochs are fine as long as their clocks tick at the same rate. */
+class ClockDriftEstimator {
+
+    double nominalRate;
+    double times[kDriftNumPoints];
+    double frames[kDriftNumPoints];
+    int numPoints;
+    int next;
+    double lastTime;
+    std::atomic<double> rate;      // Read from other threads
+    std::atomic<bool> valid;
+
+public:
+
+    ClockDriftEstimator(double nominal);
+    void reset();
+
+    /* Record that the buffer starting at frame was captured at time (seconds). Returns true when the rate estimate changed. */
+    bool update(double time, double frame);
+
+    /* Frames per second of host time; nominal until we have enough points */
+    double getRate() { return rate; }
+    bool isValid() { return valid; }
+};
+
+/* A secondary input, either a PortAudio device or a file-backed stand-in */
+struct AggregateSource {
+
+    std::string name;
+    PaDeviceIndex device;           // paNoDevice for a file
+    FileInputDevice *file;
+    PaStream *stream;
+    int numChannels;
+    int channelOffset;              // First channel on the merged timeline (relative to the secondary channels)
+    double nominalRate;
+
+    SampleFifo *fifo;
+    AdaptiveResampler *resampler;
+    ClockDriftEstimator *clock;
+    std::atomic<unsigned long long> framesReceived;
+    std::atomic<int> maxBlockLength;            // Longest callback seen, for sizing the FIFO target
+    float fillAverage;
+    bool primed;
+    std::atomic<double> ratio;
+    std::atomic<unsigned long> underflows;
+    std::atomic<unsigned long> overflows;
+};
+
+struct AggregateSourceStatus {
+    std::string name;
+    int numChannels;
+    double nominalRate;
+    double measuredRate;            // From the drift estimator
+    double driftPPM;                // Relative to the primary device
+    double ratio;                   // Current resampling ratio, including the FIFO servo
+    float fifoFill;                 // Frames
+    unsigned long underflows;
+    unsigned long overflows;
+};
+
+/* Merges secondary input devices onto the primary stream's timeline.
+
+    Each secondary runs its own stream whose callback writes into a FIFO and feeds that device's drift estimator. The primary callback calls pull(), which estimates the primary's own rate from its timeInfo and reads each FIFO through an adaptive resampler at (secondary rate / primary rate), trimmed by a slow servo that holds the FIFO near its target fill. The primary device is the master clock; secondaries never stall it, and an empty FIFO produces silence until it refills. */
+class DeviceAggregator {
+
+    std::vector<AggregateSource *> sources;
+    int numChannels;                // Total secondary channels
+    bool isOpen;
+
+    double primaryRate;
+    ClockDriftEstimator *primaryClock;
+    unsigned long long primaryFrames;
+    std::vector<float> scratch;     // Interleaved frames on their way from a FIFO to a resampler
+
+#pragma mark - Private Methods
+    void deleteSource(AggregateSource *source);
+    void pullSource(AggregateSource *source, unsigned long frameCount, float * const *output);
+
+#pragma mark - Secondary Callback
+    static int sourceCallback(const void* input, void* output,
+                              unsigned long frameCount,
+                              const PaStreamCallbackTimeInfo* timeInfo,
+                              PaStreamCallbackFlags statusFlags,
+                              void *userData);
+
+public:
+
+    /* Constructor/Destructor */
+    DeviceAggregator();
+    ~DeviceAggregator();
+
+    /* Add secondaries while closed. Return the source index, or -1 on failure. */
+    int addDevice(PaDeviceIndex deviceIndex, int nChannels);
+    int addFile(std::string path, double rateOffsetPPM, int blockLength, int maxChannels);
+    void removeAll();
+
+    /* Open/start the secondary streams. The caller serializes these with its other PortAudio calls. */
+    bool open(double sampleRate, int blockLength);
+    bool close();
+    bool start();
+    bool stop();
+
+    /* Called from the primary callback with its timeInfo: fill one row per secondary channel */
+    void pull(const PaStreamCallbackTimeInfo *timeInfo, unsigned long frameCount, float * const *output);
+
+    /* Getters */
+    int getNumChannels() { return numChannels; }
+    int getNumSources() { return (int)sources.size(); }
+    std::vector<PaDeviceIndex> getDevices();
+    AggregateSourceStatus getStatus(int sourceIndex);
+};
+
+#endif /* DeviceAggregator_hpp */
@@ -0,0 +1,416 @@
+//
+//  DeviceCapabilityCache.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "DeviceCapabilityCache.hpp"
+
+const double DeviceCapabilityCache::rates[kDeviceCapabilityNumRates] = {8000.0, 9600.0, 11025.0, 12000.0, 16000.0, 22050.0, 24000.0, 32000.0, 44100.0, 48000.0, 88200.0, 96000.0, 192000.0};
+const PaSampleFormat DeviceCapabilityCache::formats[kDeviceCapabilityNumFormats] = {paFloat32, paInt32, paInt24, paInt16};
+
+DeviceCapabilityCache::DeviceCapabilityCache(std::string cachePath, std::mutex *paMutex) : path(cachePath), portAudioMutex(paMutex), generation(0), probing(false), stopProbing(false) {}
+
+DeviceCapabilityCache::~DeviceCapabilityCache() {
+
+    stopProbing = true;
+    if (prober.joinable())
+        prober.join();
+}
+
+#pragma mark - Cache File
+/* File format:
+    AudioWorksDeviceCapabilities <version>
+    device  <host API>  <name>  <max inputs>  <max outputs>
+    input   <channel counts, comma separated>  <rates x formats hex masks, space separated>
+    output  ...
+   Fields are tab separated. */
+bool DeviceCapabilityCache::load() {
+
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file)
+        return false;
+
+    char line[4096];
+    int version = 0;
+    if (!fgets(line, sizeof(line), file) || sscanf(line, "AudioWorksDeviceCapabilities %d", &version) != 1 || version != kDeviceCapabilityFileVersion) {
+        printf("%s: Ignoring cache file %s with unknown format\n", __PRETTY_FUNCTION__, path.c_str());
+        fclose(file);
+        return false;
+    }
+
+    std::map<std::string, DeviceCapabilities> loaded;
+    DeviceCapabilities *current = NULL;
+
+    while (fgets(line, sizeof(line), file)) {
+
+        line[strcspn(line, "\r\n")] = '\0';
+
+        std::vector<std::string> fields;
+        char *save = NULL;
+        for (char *tok = strtok_r(line, "\t", &save); tok; tok = strtok_r(NULL, "\t", &save))
+            fields.push_back(tok);
+
+        if (fields.size() == 5 && fields[0] == "device") {
+            DeviceCapabilities caps;
+            caps.hostApi = fields[1];
+            caps.name = fields[2];
+            caps.maxInputChannels = atoi(fields[3].c_str());
+            caps.maxOutputChannels = atoi(fields[4].c_str());
+            caps.validated = false;
+            makeChannelCounts(caps.maxInputChannels, caps.input.channelCounts);
+            makeChannelCounts(caps.maxOutputChannels, caps.output.channelCounts);
+            memset(caps.input.supported, 0, sizeof(caps.input.supported));
+            memset(caps.output.supported, 0, sizeof(caps.output.supported));
+            current = &(loaded[caps.hostApi + ":" + caps.name] = caps);
+        }
+        else if (fields.size() == 3 && current && (fields[0] == "input" || fields[0] == "output")) {
+            DeviceDirectionCapabilities &dir = fields[0] == "input" ? current->input : current->output;
+            const char *p = fields[2].c_str();
+            char *end;
+            for (int r = 0; r < kDeviceCapabilityNumRates; r++) {
+                for (int f = 0; f < kDeviceCapabilityNumFormats; f++) {
+                    dir.supported[r][f] = (unsigned int)strtoul(p, &end, 16);
+                    p = end;
+                }
+            }
+        }
+    }
+    fclose(file);
+
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    for (auto it = loaded.begin(); it != loaded.end(); ++it)
+        if (entries.find(it->first) == entries.end())   // Don't clobber anything already probed
+            entries[it->first] = it->second;
+
+    return true;
+}
+
+bool DeviceCapabilityCache::save() {
+
+    /* Write to a temporary file and rename it so a crash can't leave a half-written cache */
+    std::string tmpPath = path + ".tmp";
+    FILE *file = fopen(tmpPath.c_str(), "w");
+    if (!file) {
+        printf("%s: Unable to write cache file %s\n", __PRETTY_FUNCTION__, tmpPath.c_str());
+        return false;
+    }
+
+    fprintf(file, "AudioWorksDeviceCapabilities %d\n", kDeviceCapabilityFileVersion);
+
+    {
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+
+            const DeviceCapabilities &caps = it->second;
+            fprintf(file, "device\t%s\t%s\t%d\t%d\n", caps.hostApi.c_str(), caps.name.c_str(), caps.maxInputChannels, caps.maxOutputChannels);
+
+            for (int d = 0; d < 2; d++) {
+                const DeviceDirectionCapabilities &dir = d == 0 ? caps.input : caps.output;
+                fprintf(file, "%s\t", d == 0 ? "input" : "output");
+                for (int c = 0; c < dir.channelCounts.size(); c++)
+                    fprintf(file, "%s%d", c ? "," : "", dir.channelCounts[c]);
+                fprintf(file, "\t");
+                for (int r = 0; r < kDeviceCapabilityNumRates; r++)
+                    for (int f = 0; f < kDeviceCapabilityNumFormats; f++)
+                        fprintf(file, "%s%x", r || f ? " " : "", dir.supported[r][f]);
+                fprintf(file, "\n");
+            }
+        }
+    }
+
+    fclose(file);
+
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        printf("%s: Unable to replace cache file %s\n", __PRETTY_FUNCTION__, path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+#pragma mark - Interface Methods
+void DeviceCapabilityCache::revalidate() {
+
+    if (probing)
+        return;
+
+    if (prober.joinable())
+        prober.join();
+
+    stopProbing = false;
+    probing = true;
+    prober = std::thread(&DeviceCapabilityCache::probeAll, this);
+}
+
+void DeviceCapabilityCache::setBusyDevices(PaDeviceIndex inputDevice, PaDeviceIndex outputDevice) {
+
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    busyDevices.clear();
+    if (inputDevice != paNoDevice)
+        busyDevices.push_back(inputDevice);
+    if (outputDevice != paNoDevice)
+        busyDevices.push_back(outputDevice);
+}
+
+void DeviceCapabilityCache::addBusyDevice(PaDeviceIndex idx) {
+
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    if (idx != paNoDevice)
+        busyDevices.push_back(idx);
+}
+
+std::vector<float> DeviceCapabilityCache::getSupportedSampleRates(PaDeviceIndex inputDevice, int numInputChannels, PaDeviceIndex outputDevice, int numOutputChannels, PaSampleFormat format) {
+
+    std::vector<float> supported;
+
+    unsigned int mask = (1u << kDeviceCapabilityNumRates) - 1;
+    if (inputDevice != paNoDevice)
+        mask &= supportedRates(inputDevice, true, numInputChannels, format);
+    if (outputDevice != paNoDevice)
+        mask &= supportedRates(outputDevice, false, numOutputChannels, format);
+
+    for (int r = 0; r < kDeviceCapabilityNumRates; r++)
+        if (mask & (1u << r))
+            supported.push_back(rates[r]);
+
+    return supported;
+}
+
+/* A channel count that wasn't probed itself is looked up at the next probed count up */
+bool DeviceCapabilityCache::isSupported(PaDeviceIndex idx, bool isInput, double rate, int numChannels, PaSampleFormat format) {
+
+    DeviceCapabilities caps;
+    if (!lookup(idx, caps))
+        return false;
+
+    int r = 0;
+    while (r < kDeviceCapabilityNumRates && rates[r] != rate)
+        r++;
+    int f = formatIndex(format);
+    if (r == kDeviceCapabilityNumRates || f < 0)
+        return false;
+
+    const DeviceDirectionCapabilities &dir = isInput ? caps.input : caps.output;
+    for (int c = 0; c < dir.channelCounts.size(); c++)
+        if (dir.channelCounts[c] >= numChannels)
+            return dir.supported[r][f] & (1u << c);
+
+    return false;
+}
+
+std::string DeviceCapabilityCache::key(PaDeviceIndex idx) {
+
+    const PaDeviceInfo *info = Pa_GetDeviceInfo(idx);
+    if (!info)
+        return "";
+
+    const PaHostApiInfo *api = Pa_GetHostApiInfo(info->hostApi);
+    return std::string(api ? api->name : "") + ":" + info->name;
+}
+
+#pragma mark - Private Methods
+void DeviceCapabilityCache::probeAll() {
+
+    int numDevices = Pa_GetDeviceCount();
+
+    for (PaDeviceIndex idx = 0; idx < numDevices && !stopProbing; idx++) {
+
+        {
+            std::lock_guard<std::mutex> lock(entriesMutex);
+            bool busy = false;
+            for (int i = 0; i < busyDevices.size(); i++)
+                busy |= busyDevices[i] == idx;
+            if (busy)
+                continue;
+        }
+
+        DeviceCapabilities caps;
+        if (!probe(idx, caps))
+            break;
+
+        std::string k = key(idx);
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        auto it = entries.find(k);
+        if (it == entries.end() || !sameCapabilities(it->second, caps))
+            generation++;
+        entries[k] = caps;
+    }
+
+    if (!stopProbing) {
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        quickProbes.clear();        // Superseded by the full entries
+    }
+
+    if (!stopProbing)
+        save();
+
+    probing = false;
+}
+
+/* Probe one device in both directions. Returns false if we were asked to stop partway. */
+bool DeviceCapabilityCache::probe(PaDeviceIndex idx, DeviceCapabilities &caps) {
+
+    const PaDeviceInfo *info = Pa_GetDeviceInfo(idx);
+    if (!info) {
+        printf("%s: Invalid device index %d\n", __PRETTY_FUNCTION__, idx);
+        return false;
+    }
+
+    const PaHostApiInfo *api = Pa_GetHostApiInfo(info->hostApi);
+    caps.name = info->name;
+    caps.hostApi = api ? api->name : "";
+    caps.maxInputChannels = info->maxInputChannels;
+    caps.maxOutputChannels = info->maxOutputChannels;
+    caps.validated = true;
+
+    probeDirection(idx, true, caps.input);
+    probeDirection(idx, false, caps.output);
+
+    return !stopProbing;
+}
+
+void DeviceCapabilityCache::probeDirection(PaDeviceIndex idx, bool isInput, DeviceDirectionCapabilities &dir) {
+
+    const PaDeviceInfo *info = Pa_GetDeviceInfo(idx);
+    makeChannelCounts(isInput ? info->maxInputChannels : info->maxOutputChannels, dir.channelCounts);
+    memset(dir.supported, 0, sizeof(dir.supported));
+
+    PaStreamParameters params;
+    params.device = idx;
+    params.suggestedLatency = 0;    // Ignored by Pa_IsFormatSupported
+    params.hostApiSpecificStreamInfo = NULL;
+
+    for (int r = 0; r < kDeviceCapabilityNumRates; r++) {
+        for (int f = 0; f < kDeviceCapabilityNumFormats; f++) {
+            for (int c = 0; c < dir.channelCounts.size(); c++) {
+
+                if (stopProbing)
+                    return;
+
+                params.channelCount = dir.channelCounts[c];
+                params.sampleFormat = formats[f];
+
+                PaError error;
+                {
+                    std::lock_guard<std::mutex> lock(*portAudioMutex);
+                    error = Pa_IsFormatSupported(isInput ? &params : NULL, isInput ? NULL : &params, rates[r]);
+                }
+                if (error == paFormatIsSupported)
+                    dir.supported[r][f] |= 1u << c;
+            }
+        }
+    }
+}
+
+/* Bit r is set if rates[r] works at exactly this channel count and format. Used for cache misses, so it's kept to one Pa_IsFormatSupported call per rate. */
+unsigned int DeviceCapabilityCache::probeRates(PaDeviceIndex idx, bool isInput, int numChannels, PaSampleFormat format) {
+
+    PaStreamParameters params;
+    params.device = idx;
+    params.channelCount = numChannels;
+    params.sampleFormat = format;
+    params.suggestedLatency = 0;    // Ignored by Pa_IsFormatSupported
+    params.hostApiSpecificStreamInfo = NULL;
+
+    unsigned int mask = 0;
+    for (int r = 0; r < kDeviceCapabilityNumRates; r++) {
+
+        PaError error;
+        {
+            std::lock_guard<std::mutex> lock(*portAudioMutex);
+            error = Pa_IsFormatSupported(isInput ? &params : NULL, isInput ? NULL : &params, rates[r]);
+        }
+        if (error == paFormatIsSupported)
+            mask |= 1u << r;
+    }
+
+    return mask;
+}
+
+/* Rate mask for one device from the cache, or from a quick probe of just this channel count and format if the device isn't cached yet. A miss also starts a background pass so the full matrix gets filled in. */
+unsigned int DeviceCapabilityCache::supportedRates(PaDeviceIndex idx, bool isInput, int numChannels, PaSampleFormat format) {
+
+    unsigned int mask = 0;
+
+    DeviceCapabilities caps;
+    if (lookup(idx, caps)) {
+        for (int r = 0; r < kDeviceCapabilityNumRates; r++)
+            if (isSupported(idx, isInput, rates[r], numChannels, format))
+                mask |= 1u << r;
+        return mask;
+    }
+
+    if (!Pa_GetDeviceInfo(idx))
+        return 0;
+
+    char quickKey[64];
+    snprintf(quickKey, sizeof(quickKey), "\t%s\t%d\t%lu", isInput ? "input" : "output", numChannels, (unsigned long)format);
+    std::string k = key(idx) + quickKey;
+
+    {
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        auto it = quickProbes.find(k);
+        if (it != quickProbes.end())
+            return it->second;
+    }
+
+    mask = probeRates(idx, isInput, numChannels, format);
+
+    {
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        quickProbes[k] = mask;
+    }
+
+    revalidate();
+
+    return mask;
+}
+
+/* 1, 2, 4, ... up to and including maxChannels */
+void DeviceCapabilityCache::makeChannelCounts(int maxChannels, std::vector<int> &counts) {
+
+    counts.clear();
+    for (int c = 1; c < maxChannels; c *= 2)
+        counts.push_back(c);
+    if (maxChannels > 0)
+        counts.push_back(maxChannels);
+}
+
+int DeviceCapabilityCache::formatIndex(PaSampleFormat format) {
+
+    for (int f = 0; f < kDeviceCapabilityNumFormats; f++)
+        if (formats[f] == format)
+            return f;
+
+    printf("%s: Unsupported sample format %lu\n", __PRETTY_FUNCTION__, (unsigned long)format);
+    return -1;
+}
+
+bool DeviceCapabilityCache::sameCapabilities(const DeviceCapabilities &a, const DeviceCapabilities &b) {
+
+    return a.maxInputChannels == b.maxInputChannels && a.maxOutputChannels == b.maxOutputChannels &&
+           !memcmp(a.input.supported, b.input.supported, sizeof(a.input.supported)) &&
+           !memcmp(a.output.supported, b.output.supported, sizeof(a.output.supported));
+}
+
+/* Cached capabilities for a device, if we have them and the device still looks the same */
+bool DeviceCapabilityCache::lookup(PaDeviceIndex idx, DeviceCapabilities &caps) {
+
+    const PaDeviceInfo *info = Pa_GetDeviceInfo(idx);
+    if (!info)
+        return false;
+
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    auto it = entries.find(key(idx));
+    if (it == entries.end())
+        return false;
+
+    if (it->second.maxInputChannels != info->maxInputChannels || it->second.maxOutputChannels != info->maxOutputChannels)
+        return false;
+
+    caps = it->second;
+    return true;
+}
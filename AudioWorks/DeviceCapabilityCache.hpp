@@ -0,0 +1,102 @@
+//
+//  DeviceCapabilityCache.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef DeviceCapabilityCache_hpp
+#define DeviceCapabilityCache_hpp
+
+#include <stdio.h>
+#include <string.h>
+#include <portaudio.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#define kDeviceCapabilityNumRates (13)
+#define kDeviceCapabilityNumFormats (4)
+#define kDeviceCapabilityFileVersion (1)
+
+/* What one device supports in one direction. Channel counts are probed at 1, 2, 4, ... and the device maximum; bit c of supported[rate][format] is set if channelCounts[c] works. */
+struct DeviceDirectionCapabilities {
+    std::vector<int> channelCounts;
+    unsigned int supported[kDeviceCapabilityNumRates][kDeviceCapabilityNumFormats];
+};
+
+struct DeviceCapabilities {
+    std::string name;
+    std::string hostApi;
+    int maxInputChannels;
+    int maxOutputChannels;
+    DeviceDirectionCapabilities input;
+    DeviceDirectionCapabilities output;
+    bool validated;             // Probed this session (as opposed to loaded from disk)
+};
+
+/* Sample rate, channel count and sample format support for every audio device, cached on disk.
+
+    Probing a device with Pa_IsFormatSupported can take seconds on some host APIs, so capabilities are loaded from the cache file at startup and re-probed on a background thread. Devices are keyed by host API and name rather than PortAudio index, which changes when devices come and go. All PortAudio calls made here hold portAudioMutex so they don't overlap the owner's stream calls, and devices the owner has marked busy (in use by an open stream) are left alone. */
+class DeviceCapabilityCache {
+
+    std::string path;
+    std::mutex *portAudioMutex;
+
+    std::map<std::string, DeviceCapabilities> entries;
+    std::mutex entriesMutex;
+    std::vector<PaDeviceIndex> busyDevices;
+    std::map<std::string, unsigned int> quickProbes;    // Rate masks for single channel count/format queries on devices not in entries yet
+    std::atomic<unsigned long> generation;      // Bumped whenever probed capabilities differ from the cached ones
+
+    std::thread prober;
+    std::atomic<bool> probing;
+    std::atomic<bool> stopProbing;
+
+#pragma mark - Private Methods
+    void probeAll();
+    bool probe(PaDeviceIndex idx, DeviceCapabilities &caps);
+    void probeDirection(PaDeviceIndex idx, bool isInput, DeviceDirectionCapabilities &dir);
+    unsigned int probeRates(PaDeviceIndex idx, bool isInput, int numChannels, PaSampleFormat format);
+    unsigned int supportedRates(PaDeviceIndex idx, bool isInput, int numChannels, PaSampleFormat format);
+    static void makeChannelCounts(int maxChannels, std::vector<int> &counts);
+    static int formatIndex(PaSampleFormat format);
+    static bool sameCapabilities(const DeviceCapabilities &a, const DeviceCapabilities &b);
+    bool lookup(PaDeviceIndex idx, DeviceCapabilities &caps);
+
+public:
+
+    static const double rates[kDeviceCapabilityNumRates];
+    static const PaSampleFormat formats[kDeviceCapabilityNumFormats];
+
+    /* Constructor/Destructor */
+    DeviceCapabilityCache(std::string cachePath, std::mutex *paMutex);
+    ~DeviceCapabilityCache();
+
+    /* Cache file */
+    bool load();
+    bool save();
+
+    /* Re-probe every device on a background thread, saving the cache when done */
+    void revalidate();
+    bool isProbing() { return probing; }
+    unsigned long getGeneration() { return generation; }
+
+    /* Devices in use by an open stream, which we shouldn't probe */
+    void setBusyDevices(PaDeviceIndex inputDevice, PaDeviceIndex outputDevice);
+    void addBusyDevice(PaDeviceIndex idx);
+
+    /* Sample rates supported by an input/output device pair at the given channel counts and format. For devices missing from the cache, only this channel count and format are probed synchronously (one call per rate); the full matrix is left to the background pass, which bumps the generation when it lands. */
+    std::vector<float> getSupportedSampleRates(PaDeviceIndex inputDevice, int numInputChannels, PaDeviceIndex outputDevice, int numOutputChannels, PaSampleFormat format);
+
+    /* Whether one device supports a rate/channel count/format, from the cache */
+    bool isSupported(PaDeviceIndex idx, bool isInput, double rate, int numChannels, PaSampleFormat format);
+
+    static std::string key(PaDeviceIndex idx);
+};
+
+#endif /* DeviceCapabilityCache_hpp */
@@ -0,0 +1,226 @@
+//
+//  FFTPlanCache.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "FFTPlanCache.hpp"
+
+#pragma mark - FFTPlan
+FFTPlan::FFTPlan(int n, FFTWindowType type, vDSP_DFT_Setup dftSetup) : size(n), numBins(n / 2), windowType(type), setup(dftSetup), inverseSetup(NULL), shortWindowLength(0) {
+
+    window.resize(size);
+    FFTPlanCache::makeWindow(windowType, &window[0], size);
+    shortWindow.resize(size);
+
+    windowed.resize(size);
+    inRealp.resize(numBins);
+    inImagp.resize(numBins);
+    outRealp.resize(numBins);
+    outImagp.resize(numBins);
+
+    scale = 2.0f / size;
+}
+
+void FFTPlan::computeMagnitude(const float *input, int length, float *magnitude) {
+
+    transform(input, length, &outRealp[0], &outImagp[0]);
+    outImagp[0] = 0.0f;     // Nyquist is packed here; drop it so bin 0 is just DC
+
+    DSPSplitComplex split;
+    split.realp = &outRealp[0];
+    split.imagp = &outImagp[0];
+    vDSP_zvabs(&split, 1, magnitude, 1, numBins);
+    vDSP_vsmul(magnitude, 1, &scale, magnitude, 1, numBins);
+}
+
+void FFTPlan::computePower(const float *input, int length, float *power) {
+
+    transform(input, length, &outRealp[0], &outImagp[0]);
+    outImagp[0] = 0.0f;
+
+    DSPSplitComplex split;
+    split.realp = &outRealp[0];
+    split.imagp = &outImagp[0];
+    vDSP_zvmags(&split, 1, power, 1, numBins);
+}
+
+void FFTPlan::forward(const float *input, int length, DSPSplitComplex *output) {
+    transform(input, length, output->realp, output->imagp);
+}
+
+bool FFTPlan::inverse(const DSPSplitComplex *input, float *output) {
+
+    if (!inverseSetup) {
+        printf("%s: Plan of size %d has no inverse\n", __PRETTY_FUNCTION__, size);
+        return false;
+    }
+
+    vDSP_DFT_Execute(inverseSetup, input->realp, input->imagp, &outRealp[0], &outImagp[0]);
+
+    DSPSplitComplex split;
+    split.realp = &outRealp[0];
+    split.imagp = &outImagp[0];
+    vDSP_ztoc(&split, 1, (DSPComplex *)output, 2, numBins);
+    return true;
+}
+
+#pragma mark - Private Methods
+/* Window and zero-pad up to size samples, then run the forward DFT into numBins packed complex values */
+void FFTPlan::transform(const float *input, int length, float *outReal, float *outImag) {
+
+    length = length > size ? size : length;
+
+    /* Window, zero-padding short inputs */
+    if (length < size) {
+
+        if (windowType == kFFTWindowRectangular)
+            memcpy(&windowed[0], input, length * sizeof(float));
+        else {
+            if (length != shortWindowLength) {
+                FFTPlanCache::makeWindow(windowType, &shortWindow[0], length);
+                shortWindowLength = length;
+            }
+            vDSP_vmul(input, 1, &shortWindow[0], 1, &windowed[0], 1, length);
+        }
+        vDSP_vclr(&windowed[length], 1, size - length);
+    }
+    else if (windowType == kFFTWindowRectangular)
+        memcpy(&windowed[0], input, size * sizeof(float));
+    else
+        vDSP_vmul(input, 1, &window[0], 1, &windowed[0], 1, size);
+
+    /* Even-odd split, as for vDSP_fft_zrip(); the packed output is the same too */
+    DSPSplitComplex split;
+    split.realp = &inRealp[0];
+    split.imagp = &inImagp[0];
+    vDSP_ctoz((DSPComplex *)&windowed[0], 2, &split, 1, numBins);
+
+    vDSP_DFT_Execute(setup, &inRealp[0], &inImagp[0], outReal, outImag);
+}
+
+#pragma mark - FFTPlanCache
+FFTPlanCache::~FFTPlanCache() {
+
+    for (std::map<std::pair<int, int>, FFTPlan *>::iterator it = plans.begin(); it != plans.end(); it++)
+        delete it->second;
+    for (std::map<int, vDSP_DFT_Setup>::iterator it = setups.begin(); it != setups.end(); it++)
+        vDSP_DFT_DestroySetup(it->second);
+    for (std::map<int, vDSP_DFT_Setup>::iterator it = inverseSetups.begin(); it != inverseSetups.end(); it++)
+        vDSP_DFT_DestroySetup(it->second);
+}
+
+FFTPlan *FFTPlanCache::getPlan(int size, FFTWindowType type, bool withInverse) {
+
+    if (!isSupportedSize(size)) {
+        printf("%s: Unsupported FFT size %d. Must be f * 2^n for f in {1, 3, 5, 15} and n >= %d (e.g. %d).\n", __PRETTY_FUNCTION__, size, kFFTMinLog2Size, nextSupportedSize(size));
+        return NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(plansMutex);
+
+    FFTPlan *plan = NULL;
+    std::map<std::pair<int, int>, FFTPlan *>::iterator it = plans.find(std::make_pair(size, (int)type));
+    if (it != plans.end())
+        plan = it->second;
+    else {
+        plan = buildPlan(size, type);
+        if (!plan)
+            return NULL;
+    }
+
+    if (withInverse && !plan->inverseSetup) {
+
+        std::map<int, vDSP_DFT_Setup>::iterator existing = inverseSetups.find(size);
+        if (existing != inverseSetups.end())
+            plan->inverseSetup = existing->second;
+        else {
+            vDSP_DFT_Setup inverseSetup = vDSP_DFT_zrop_CreateSetup(setups[size], size, vDSP_DFT_INVERSE);
+            if (!inverseSetup) {
+                printf("%s: Failed to create inverse DFT setup for size %d\n", __PRETTY_FUNCTION__, size);
+                return NULL;
+            }
+            inverseSetups[size] = inverseSetup;
+            plan->inverseSetup = inverseSetup;
+        }
+    }
+
+    return plan;
+}
+
+/* Build and cache a plan, with the caller holding plansMutex */
+FFTPlan *FFTPlanCache::buildPlan(int size, FFTWindowType type) {
+
+    /* Reuse the setup for this size if another window type has one; otherwise share tables with any existing setup */
+    vDSP_DFT_Setup setup;
+    std::map<int, vDSP_DFT_Setup>::iterator existing = setups.find(size);
+    if (existing != setups.end())
+        setup = existing->second;
+    else {
+        setup = vDSP_DFT_zrop_CreateSetup(setups.empty() ? NULL : setups.rbegin()->second, size, vDSP_DFT_FORWARD);
+        if (!setup) {
+            printf("%s: Failed to create DFT setup for size %d\n", __PRETTY_FUNCTION__, size);
+            return NULL;
+        }
+        setups[size] = setup;
+    }
+
+    FFTPlan *plan = new FFTPlan(size, type, setup);
+    plans[std::make_pair(size, (int)type)] = plan;
+    return plan;
+}
+
+int FFTPlanCache::getNumPlans() {
+
+    std::lock_guard<std::mutex> lock(plansMutex);
+    return (int)plans.size();
+}
+
+#pragma mark - Utility
+bool FFTPlanCache::isSupportedSize(int size) {
+
+    if (size < (1 << kFFTMinLog2Size))
+        return false;
+
+    int n = 0;
+    while (!(size & 1)) {
+        size >>= 1;
+        n++;
+    }
+    return n >= kFFTMinLog2Size && (size == 1 || size == 3 || size == 5 || size == 15);
+}
+
+int FFTPlanCache::nextSupportedSize(int size) {
+
+    int best = 0;
+    static const int factors[] = {1, 3, 5, 15};
+
+    for (int i = 0; i < 4; i++) {
+        int n = factors[i] << kFFTMinLog2Size;
+        while (n < size)
+            n <<= 1;
+        best = (best == 0 || n < best) ? n : best;
+    }
+    return best;
+}
+
+void FFTPlanCache::makeWindow(FFTWindowType type, float *window, int length) {
+
+    switch (type) {
+        case kFFTWindowHann:
+            vDSP_hann_window(window, length, vDSP_HANN_NORM);
+            break;
+        case kFFTWindowHamming:
+            vDSP_hamm_window(window, length, 0);
+            break;
+        case kFFTWindowBlackman:
+            vDSP_blkman_window(window, length, 0);
+            break;
+        default:
+            for (int i = 0; i < length; i++)
+                window[i] = 1.0f;
+            break;
+    }
+}
@@ -0,0 +1,111 @@
+//
+//  FFTPlanCache.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef FFTPlanCache_hpp
+#define FFTPlanCache_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <Accelerate/Accelerate.h>
+#include <vector>
+#include <map>
+#include <mutex>
+
+#define kFFTMinLog2Size (4)         // vDSP's real DFT needs f * 2^n with n >= 4
+
+typedef enum FFTWindowType {
+    kFFTWindowRectangular,
+    kFFTWindowHann,
+    kFFTWindowHamming,
+    kFFTWindowBlackman
+} FFTWindowType;
+
+/* A real forward DFT of one size with one window, and the buffers to run it without allocating. Plans asked for with an inverse can also go back to the time domain.
+
+    Plans come from an FFTPlanCache, which owns them. A plan isn't thread safe: use one from one thread at a time. */
+class FFTPlan {
+
+    friend class FFTPlanCache;
+
+    int size;
+    int numBins;
+    FFTWindowType windowType;
+    vDSP_DFT_Setup setup;           // Owned by the cache and shared with plans of the same size
+    vDSP_DFT_Setup inverseSetup;    // NULL unless the plan was asked for with an inverse
+
+    std::vector<float> window;
+    std::vector<float> shortWindow; // Window for inputs shorter than size, rebuilt only when the length changes
+    int shortWindowLength;
+
+    std::vector<float> windowed;
+    std::vector<float> inRealp;
+    std::vector<float> inImagp;
+    std::vector<float> outRealp;
+    std::vector<float> outImagp;
+    float scale;
+
+#pragma mark - Private Methods
+    void transform(const float *input, int length, float *outReal, float *outImag);
+
+public:
+
+    /* Constructor. Use FFTPlanCache::getPlan() rather than constructing plans directly. */
+    FFTPlan(int n, FFTWindowType type, vDSP_DFT_Setup dftSetup);
+
+    /* Single-sided magnitude spectrum (size / 2 bins, scaled as in METScopeView) of up to size samples. Shorter inputs are windowed at their own length and zero-padded. */
+    void computeMagnitude(const float *input, int length, float *magnitude);
+
+    /* Single-sided power spectrum (size / 2 bins of |X|^2, unscaled, as from vDSP_fft_zrip()) of up to size samples, windowed and zero-padded as above */
+    void computePower(const float *input, int length, float *power);
+
+    /* Packed forward transform of up to size samples into size / 2 complex values, in vDSP_fft_zrip()'s layout (DC and Nyquist are the real and imaginary parts of element 0) */
+    void forward(const float *input, int length, DSPSplitComplex *output);
+
+    /* Packed inverse transform back to size samples, unnormalized as vDSP's (a forward/inverse round trip scales by 2 * size). Returns false if the plan has no inverse. */
+    bool inverse(const DSPSplitComplex *input, float *output);
+
+    /* Getters */
+    int getSize() { return size; }
+    int getNumBins() { return numBins; }
+    FFTWindowType getWindowType() { return windowType; }
+    const float *getWindow() { return &window[0]; }
+};
+
+/* FFT plans keyed by size and window type, so display and analysis code can switch resolution without reallocating.
+
+    Sizes can be mixed radix: f * 2^n for f in {1, 3, 5, 15} and n >= kFFTMinLog2Size, so windows can match exact time spans (e.g. 480 samples for 10 ms at 48 kHz). Plans are built the first time they're asked for and kept until the cache is destroyed; plans of the same size share one vDSP setup. Lookups are thread safe. */
+class FFTPlanCache {
+
+    std::map<std::pair<int, int>, FFTPlan *> plans;
+    std::map<int, vDSP_DFT_Setup> setups;
+    std::map<int, vDSP_DFT_Setup> inverseSetups;
+    std::mutex plansMutex;
+
+#pragma mark - Private Methods
+    FFTPlan *buildPlan(int size, FFTWindowType type);
+
+public:
+
+    /* Constructor/Destructor */
+    FFTPlanCache() {}
+    ~FFTPlanCache();
+
+    /* The cached plan for a size and window type, built if it doesn't exist yet. withInverse adds an inverse setup to the plan if it doesn't have one. Returns NULL if the size isn't supported. */
+    FFTPlan *getPlan(int size, FFTWindowType type, bool withInverse = false);
+
+    /* Number of plans built so far */
+    int getNumPlans();
+
+    /* Utility */
+    static bool isSupportedSize(int size);
+    static int nextSupportedSize(int size);     // Smallest supported size >= size
+    static void makeWindow(FFTWindowType type, float *window, int length);
+};
+
+#endif /* FFTPlanCache_hpp */
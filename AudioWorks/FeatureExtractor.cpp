@@ -0,0 +1,336 @@
+//
+//  FeatureExtractor.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "FeatureExtractor.hpp"
+#include "AudioController.hpp"
+
+#pragma mark - FeatureEventLog
+FeatureEventLog::FeatureEventLog() : head(0) {
+
+    slots = new Slot[kFeatureLogLength];
+    for (int i = 0; i < kFeatureLogLength; i++)
+        slots[i].sequence = 0;
+}
+
+FeatureEventLog::~FeatureEventLog() {
+    delete [] slots;
+}
+
+void FeatureEventLog::push(const FeatureEvent &event) {
+
+    unsigned long long n = head.load(std::memory_order_relaxed);
+    Slot &slot = slots[n % kFeatureLogLength];
+
+    slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.sequence.store(2 * n + 2, std::memory_order_release);
+
+    head.store(n + 1, std::memory_order_release);
+}
+
+int FeatureEventLog::read(unsigned long long *cursor, FeatureEvent *events, int maxEvents, unsigned long *dropped) {
+
+    unsigned long long h = head.load(std::memory_order_acquire);
+
+    /* Too far behind: skip to the oldest event still in the ring */
+    if (h - *cursor > kFeatureLogLength) {
+        if (dropped)
+            *dropped += h - kFeatureLogLength - *cursor;
+        *cursor = h - kFeatureLogLength;
+    }
+
+    int numRead = 0;
+    while (*cursor < h && numRead < maxEvents) {
+
+        unsigned long long n = *cursor;
+        Slot &slot = slots[n % kFeatureLogLength];
+
+        unsigned long long before = slot.sequence.load(std::memory_order_acquire);
+        events[numRead] = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        unsigned long long after = slot.sequence.load(std::memory_order_relaxed);
+
+        /* The writer lapped us while we were copying */
+        if (before != 2 * n + 2 || after != before) {
+            if (dropped)
+                (*dropped)++;
+        }
+        else
+            numRead++;
+
+        (*cursor)++;
+    }
+
+    return numRead;
+}
+
+#pragma mark - FeatureExtractor
+FeatureExtractor::FeatureExtractor(float fs, int nChannels, int nFFT, int hop, FeatureEventLog *eventLog) : sampleRate(fs), numChannels(nChannels), fftSize(nFFT), numBins(nFFT / 2), hopSize(hop), frameEventsEnabled(true), reportFrame(0), log(eventLog) {
+
+    previousLogMagnitude.resize(numChannels);
+    fluxHistory.resize(numChannels);
+    for (int i = 0; i < numChannels; i++) {
+        previousLogMagnitude[i].assign(numBins, 0.0f);
+        fluxHistory[i].assign(kFeatureOnsetWindow, 0.0f);
+    }
+    fluxHistoryCount.resize(numChannels);
+    fluxHistoryHead.resize(numChannels);
+    candidate.resize(numChannels);
+    candidateThreshold.resize(numChannels);
+    beforeCandidateFlux.resize(numChannels);
+    lastOnsetFrame.resize(numChannels);
+    numHops.resize(numChannels);
+
+    magnitude.resize(numBins);
+    logMagnitude.resize(numBins);
+
+    binFrequencies.resize(numBins);
+    for (int i = 0; i < numBins; i++)
+        binFrequencies[i] = i * sampleRate / fftSize;
+
+    /* Magnitudes in units of sinusoid amplitude, as in SpectrumAverager */
+    scale = 2.0f / fftSize;
+
+    reset(0);
+}
+
+#pragma mark - Interface Methods
+void FeatureExtractor::reset(unsigned long long fromFrame) {
+
+    reportFrame = fromFrame;
+
+    for (int i = 0; i < numChannels; i++) {
+        vDSP_vclr(&previousLogMagnitude[i][0], 1, numBins);
+        vDSP_vclr(&fluxHistory[i][0], 1, kFeatureOnsetWindow);
+        fluxHistoryCount[i] = 0;
+        fluxHistoryHead[i] = 0;
+        candidateThreshold[i] = 0.0f;
+        beforeCandidateFlux[i] = 0.0f;
+        lastOnsetFrame[i] = 0;
+        numHops[i] = 0;
+        memset(&candidate[i], 0, sizeof(FeatureEvent));
+    }
+}
+
+/* Features of a channel's current hop, then onset picking on the hop before it */
+void FeatureExtractor::analyzeSpectrum(int channel, const float *segment, const float *power, unsigned long long centerFrame) {
+
+    FeatureEvent event;
+    event.type = kFeatureEventFrame;
+    event.channel = channel;
+    event.frame = centerFrame;
+    event.time = centerFrame / (double)sampleRate;
+    event.onsetStrength = 0.0f;
+
+    /* RMS of the newest hop */
+    vDSP_rmsqv(segment + fftSize - hopSize, 1, &event.rms, hopSize);
+
+    /* Magnitude spectrum */
+    int n = numBins;
+    vvsqrtf(&magnitude[0], power, &n);
+    vDSP_vsmul(&magnitude[0], 1, &scale, &magnitude[0], 1, numBins);
+
+    /* Centroid: magnitude-weighted mean frequency */
+    float weightedSum, magnitudeSum;
+    vDSP_dotpr(&binFrequencies[0], 1, &magnitude[0], 1, &weightedSum, numBins);
+    vDSP_sve(&magnitude[0], 1, &magnitudeSum, numBins);
+    event.centroid = magnitudeSum > 0.0f ? weightedSum / magnitudeSum : 0.0f;
+
+    /* Rolloff */
+    float totalPower;
+    vDSP_sve(power, 1, &totalPower, numBins);
+    float target = kFeatureRolloffFraction * totalPower, cumulative = 0.0f;
+    int rolloffBin = 0;
+    while (rolloffBin < numBins - 1 && (cumulative += power[rolloffBin]) < target)
+        rolloffBin++;
+    event.rolloff = totalPower > 0.0f ? binFrequencies[rolloffBin] : 0.0f;
+
+    /* Flux: half-wave rectified increase in log-compressed magnitude, averaged over bins */
+    float compression = kFeatureCompression, zero = 0.0f;
+    float *previous = &previousLogMagnitude[channel][0];
+    vDSP_vsmul(&magnitude[0], 1, &compression, &logMagnitude[0], 1, numBins);
+    vvlog1pf(&logMagnitude[0], &logMagnitude[0], &n);
+    vDSP_vsub(previous, 1, &logMagnitude[0], 1, previous, 1, numBins);     // previous = current - previous
+    vDSP_vthr(previous, 1, &zero, previous, 1, numBins);
+    vDSP_meanv(previous, 1, &event.flux, numBins);
+    memcpy(previous, &logMagnitude[0], numBins * sizeof(float));
+
+    if (numHops[channel] == 0)
+        event.flux = 0.0f;      // Nothing to compare the first hop to
+
+    if (frameEventsEnabled && centerFrame >= reportFrame)
+        log->push(event);
+
+    /* The previous hop is an onset if its flux peaked above its threshold */
+    FeatureEvent &peak = candidate[channel];
+    if (numHops[channel] >= 2 &&
+        peak.flux > beforeCandidateFlux[channel] && peak.flux >= event.flux &&
+        peak.flux > candidateThreshold[channel] && peak.rms > kFeatureSilenceLevel &&
+        (lastOnsetFrame[channel] == 0 || peak.frame - lastOnsetFrame[channel] >= kFeatureOnsetMinInterval * sampleRate)) {
+
+        peak.type = kFeatureEventOnset;
+        peak.onsetStrength = peak.flux - candidateThreshold[channel];
+        if (peak.frame >= reportFrame)
+            log->push(peak);
+        lastOnsetFrame[channel] = peak.frame;
+    }
+
+    /* This hop becomes the candidate, with a threshold from the flux before it */
+    float meanFlux = 0.0f;
+    if (fluxHistoryCount[channel] > 0)
+        vDSP_meanv(&fluxHistory[channel][0], 1, &meanFlux, fluxHistoryCount[channel]);
+
+    beforeCandidateFlux[channel] = peak.flux;
+    candidateThreshold[channel] = kFeatureOnsetMultiplier * meanFlux + kFeatureOnsetDelta;
+    peak = event;
+
+    fluxHistory[channel][fluxHistoryHead[channel]] = event.flux;
+    fluxHistoryHead[channel] = (fluxHistoryHead[channel] + 1) % kFeatureOnsetWindow;
+    fluxHistoryCount[channel] = fluxHistoryCount[channel] < kFeatureOnsetWindow ? fluxHistoryCount[channel] + 1 : kFeatureOnsetWindow;
+
+    numHops[channel]++;
+}
+
+#pragma mark - FeatureTracker
+FeatureTracker::FeatureTracker(AudioController *ac, FeatureEventLog *eventLog, int nFFT, float ovlp, int nAverages) : audioController(ac), log(eventLog), averager(NULL), extractor(NULL), readFrame(0), fftSize(nFFT), overlap(ovlp), numAverages(nAverages), smoothingTime(0.5f), peakDecayRate(0.0f), running(false) {}
+
+FeatureTracker::~FeatureTracker() {
+
+    stop();
+    if (averager)
+        delete averager;
+    if (extractor)
+        delete extractor;
+}
+
+bool FeatureTracker::start() {
+
+    if (running)
+        return false;
+
+    running = true;
+    analysisThread = std::thread(&FeatureTracker::analysisLoop, this);
+    return true;
+}
+
+void FeatureTracker::stop() {
+
+    running = false;
+    if (analysisThread.joinable())
+        analysisThread.join();
+}
+
+int FeatureTracker::getMagnitude(int channel, SpectrumAverageMode mode, float *magnitude, float *frequencies, int maxBins) {
+
+    std::lock_guard<std::mutex> lock(spectrumMutex);
+
+    if (!averager || channel < 0 || channel >= averager->getNumChannels() || averager->getNumSegments() == 0)
+        return 0;
+
+    int nBins = averager->getNumBins();
+    if (nBins > maxBins) {
+        printf("%s: %d bins don't fit in %d\n", __PRETTY_FUNCTION__, nBins, maxBins);
+        return 0;
+    }
+
+    averager->getMagnitude(channel, mode, magnitude);
+    memcpy(frequencies, averager->getBinFrequencies(), nBins * sizeof(float));
+    return nBins;
+}
+
+void FeatureTracker::setSmoothingTime(float seconds) {
+
+    std::lock_guard<std::mutex> lock(spectrumMutex);
+    smoothingTime = seconds;
+    if (averager)
+        averager->setSmoothingTime(smoothingTime);
+}
+
+void FeatureTracker::setPeakDecayRate(float dBPerSecond) {
+
+    std::lock_guard<std::mutex> lock(spectrumMutex);
+    peakDecayRate = dBPerSecond;
+    if (averager)
+        averager->setPeakDecayRate(peakDecayRate);
+}
+
+#pragma mark - Private Methods
+void FeatureTracker::analysisLoop() {
+
+    while (running) {
+
+        bool analyzed = false;
+        while (running && analyzeNewFrames())
+            analyzed = true;
+
+        if (!analyzed)
+            std::this_thread::sleep_for(std::chrono::duration<float>(kFeaturePollInterval));
+    }
+}
+
+/* Feed the averager (and through it the extractor) up to one block of newly recorded frames. Returns false if there weren't any. */
+bool FeatureTracker::analyzeNewFrames() {
+
+    int nChannels = audioController->getNumInputChannels();
+    float sampleRate = audioController->getSampleRate();
+    long long recorded = (long long)audioController->getNumRecordedFrames();
+    long long oldest = recorded - audioController->getRecordingBufferLength();
+    oldest = oldest < 0 ? 0 : oldest;
+
+    if (nChannels <= 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(spectrumMutex);
+
+    /* New stream layout, or the recording buffers were reallocated and frame numbering started over */
+    if (!averager || averager->getNumChannels() != nChannels || averager->getSampleRate() != sampleRate || recorded < readFrame) {
+
+        if (averager)
+            delete averager;
+        if (extractor)
+            delete extractor;
+        averager = new SpectrumAverager(sampleRate, nChannels, fftSize, overlap, numAverages);
+        averager->setSmoothingTime(smoothingTime);
+        averager->setPeakDecayRate(peakDecayRate);
+        extractor = new FeatureExtractor(sampleRate, nChannels, averager->getFFTSize(), averager->getHopSize(), log);
+        averager->setFeatureExtractor(extractor);
+
+        blocks.resize(nChannels);
+        blockRows.resize(nChannels);
+        for (int i = 0; i < nChannels; i++) {
+            blocks[i].resize(kFeatureReadBlockLength);
+            blockRows[i] = &blocks[i][0];
+        }
+
+        /* One full average of history for the spectrum; features are only reported from now on */
+        readFrame = recorded - averager->getPrimingLength();
+        readFrame = readFrame < oldest ? oldest : readFrame;
+        averager->setNextFrame(readFrame);
+        extractor->reset(recorded);
+    }
+
+    /* Frames that aged out before we got to them leave a gap; start over after it */
+    if (readFrame < oldest) {
+        readFrame = oldest;
+        averager->reset();
+        averager->setNextFrame(readFrame);
+        extractor->reset(readFrame);
+    }
+
+    long long available = recorded - readFrame;
+    if (available <= 0)
+        return false;
+
+    int length = available < kFeatureReadBlockLength ? (int)available : kFeatureReadBlockLength;
+    audioController->getRecordingBuffersFrom(&blockRows[0], nChannels, readFrame, length);
+    averager->process(&blockRows[0], length);
+    readFrame += length;
+
+    return true;
+}
@@ -0,0 +1,188 @@
+//
+//  FeatureExtractor.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef FeatureExtractor_hpp
+#define FeatureExtractor_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <Accelerate/Accelerate.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+#include "SpectrumAverager.hpp"
+
+#define kFeatureRolloffFraction (0.85f)     // Rolloff is the frequency below which this fraction of the power lies
+#define kFeatureCompression (1000.0f)       // Flux is taken on log(1 + kFeatureCompression * |X|)
+#define kFeatureOnsetWindow (16)            // Hops of flux history behind the adaptive onset threshold
+#define kFeatureOnsetMultiplier (1.5f)      // Threshold = multiplier * mean(recent flux) + delta
+#define kFeatureOnsetDelta (0.05f)
+#define kFeatureOnsetMinInterval (0.05f)    // Seconds between onsets on one channel
+#define kFeatureSilenceLevel (0.001f)       // Hop RMS (about -60 dBFS) below which onsets aren't reported
+#define kFeatureLogLength (4096)            // Events; about a third of a second of frame events for 8 channels at 48 kHz with a 512-sample hop
+#define kFeaturePollInterval (0.02f)        // Seconds between checks for newly recorded frames
+#define kFeatureReadBlockLength (4096)      // Frames read from the recording buffers at once
+
+class AudioController;
+
+typedef enum FeatureEventType {
+    kFeatureEventFrame,             // Features for one hop
+    kFeatureEventOnset              // Onset detected at this hop
+} FeatureEventType;
+
+struct FeatureEvent {
+    FeatureEventType type;
+    int channel;
+    unsigned long long frame;       // Absolute recorded frame at the center of the analysis window
+    double time;                    // frame / sample rate, in seconds
+    float rms;                      // Of the newest hop
+    float centroid;                 // Hz
+    float flux;                     // Mean rectified increase in log magnitude per bin
+    float rolloff;                  // Hz
+    float onsetStrength;            // Flux above the adaptive threshold (onsets only)
+};
+
+/* Fixed-size broadcast ring of feature events: one writer, any number of readers, no locks.
+
+    Each reader keeps its own cursor (a count of events pushed), so readers never affect the writer or each other. Every slot carries a sequence number that is odd while it's being written. Readers check it before and after copying an event, and skip events that were overwritten while they copied. A reader that falls more than kFeatureLogLength events behind loses the oldest ones. */
+class FeatureEventLog {
+
+    struct Slot {
+        std::atomic<unsigned long long> sequence;   // 2n+1 while event n is being written, 2n+2 once it's complete
+        FeatureEvent event;
+    };
+
+    Slot *slots;
+    std::atomic<unsigned long long> head;           // Events pushed
+
+public:
+
+    /* Constructor/Destructor */
+    FeatureEventLog();
+    ~FeatureEventLog();
+
+    /* Writer only */
+    void push(const FeatureEvent &event);
+
+    /* Copy up to maxEvents starting at *cursor into events and advance *cursor past them. Events lost to overwriting are skipped and added to *dropped. Returns the number copied. */
+    int read(unsigned long long *cursor, FeatureEvent *events, int maxEvents, unsigned long *dropped = NULL);
+
+    /* A cursor that only sees events pushed from now on */
+    unsigned long long getHead() { return head.load(std::memory_order_acquire); }
+};
+
+/* Streaming per-channel audio features: spectral centroid, flux and rolloff, RMS, and onsets.
+
+    The extractor doesn't take its own FFTs. It's attached to a SpectrumAverager (see SpectrumAverager::setFeatureExtractor()), which hands over each segment's power spectrum as it analyzes it, so features come from the same hop stream as the displayed spectrum. Each hop is reduced with vDSP once per channel, so the cost per channel is fixed by the FFT size and hop and doesn't depend on the block size. Onsets are peaks in the flux that rise above an adaptive threshold (a multiple of the recent mean flux plus a constant). Peaks are picked with one hop of lookahead, so an onset is reported one hop after the hop it's stamped with. Results go to a FeatureEventLog owned by the caller. Frame events can be turned off if only onsets are wanted. Nothing here allocates after construction. */
+class FeatureExtractor {
+
+    float sampleRate;
+    int numChannels;
+    int fftSize;
+    int numBins;
+    int hopSize;
+    bool frameEventsEnabled;
+    unsigned long long reportFrame;     // Hops stamped before this only prime the flux history
+
+    /* Per-channel history for flux and onset picking */
+    std::vector<std::vector<float> > previousLogMagnitude;
+    std::vector<std::vector<float> > fluxHistory;   // Ring of kFeatureOnsetWindow hops
+    std::vector<int> fluxHistoryCount;
+    std::vector<int> fluxHistoryHead;
+    std::vector<FeatureEvent> candidate;            // Previous hop, waiting to see if it's a peak
+    std::vector<float> candidateThreshold;
+    std::vector<float> beforeCandidateFlux;         // Flux of the hop before the candidate
+    std::vector<unsigned long long> lastOnsetFrame;
+    std::vector<int> numHops;
+
+    /* Spectrum scratch */
+    std::vector<float> magnitude;
+    std::vector<float> logMagnitude;
+    std::vector<float> binFrequencies;
+    float scale;
+
+    FeatureEventLog *log;
+
+public:
+
+    /* Constructor. The FFT size and hop must match the SpectrumAverager that feeds it. Events go to eventLog, which the caller owns so readers can keep it across extractor changes. */
+    FeatureExtractor(float fs, int nChannels, int nFFT, int hop, FeatureEventLog *eventLog);
+
+    /* Features of one channel's segment: fftSize input samples and their numBins power values (|X|^2 of the Hann-windowed segment, from FFTPlan::computePower()). centerFrame is the absolute frame at the middle of the segment. Called by SpectrumAverager for every channel of every hop. */
+    void analyzeSpectrum(int channel, const float *segment, const float *power, unsigned long long centerFrame);
+
+    /* Drop all history. Hops stamped before fromFrame still prime the flux history and onset threshold but aren't logged, so the extractor can be started from recorded history without reporting it. */
+    void reset(unsigned long long fromFrame);
+
+    /* Setters */
+    void setFrameEventsEnabled(bool enable) { frameEventsEnabled = enable; }
+
+    /* Getters */
+    FeatureEventLog *getLog() { return log; }
+    int getNumChannels() { return numChannels; }
+    int getFFTSize() { return fftSize; }
+    int getHopSize() { return hopSize; }
+    float getSampleRate() { return sampleRate; }
+};
+
+/* The streaming spectrum analysis, on its own thread: a SpectrumAverager fed from the controller's recorded stream, with a FeatureExtractor attached to its hops.
+
+    Every recorded frame is read once and every hop is transformed once, for both the averaged spectrum and the features. The thread picks up frames as they're recorded, recreating the analyzers when the channel count or sample rate changes and resetting them across frames that aged out of the recording buffers before it got to them. It starts one full average back in the recording history, so the spectrum is complete right away, but only reports feature events from the newest frame on. Readers touch the event log, or copy the spectrum out with getMagnitude(). */
+class FeatureTracker {
+
+    AudioController *audioController;
+    FeatureEventLog *log;
+    SpectrumAverager *averager;
+    FeatureExtractor *extractor;
+    long long readFrame;            // Next recorded frame to analyze
+
+    /* Averager settings, kept across recreating it */
+    int fftSize;
+    float overlap;
+    int numAverages;
+    float smoothingTime;
+    float peakDecayRate;
+
+    std::thread analysisThread;
+    std::atomic<bool> running;
+    std::mutex spectrumMutex;       // Held while the averager is processing, recreated or read
+    std::vector<std::vector<float> > blocks;
+    std::vector<float *> blockRows;
+
+#pragma mark - Private Methods
+    void analysisLoop();
+    bool analyzeNewFrames();
+
+public:
+
+    /* Constructor/Destructor. Events go to eventLog, which the caller owns. The spectrum settings are as for SpectrumAverager. */
+    FeatureTracker(AudioController *ac, FeatureEventLog *eventLog, int nFFT = 2048, float overlap = 0.75f, int nAverages = 16);
+    ~FeatureTracker();
+
+    /* Starting/stopping the analysis thread */
+    bool start();
+    void stop();
+    bool isRunning() { return running; }
+
+    /* Copy a channel's averaged spectrum (as SpectrumAverager::getMagnitude()) and its bin frequencies, up to maxBins of each. Returns the number of bins copied, or 0 if there's no spectrum for the channel yet. Any thread. */
+    int getMagnitude(int channel, SpectrumAverageMode mode, float *magnitude, float *frequencies, int maxBins);
+
+    /* Setters, as for SpectrumAverager. Any thread. */
+    void setSmoothingTime(float seconds);
+    void setPeakDecayRate(float dBPerSecond);
+
+    /* Getters */
+    FeatureEventLog *getLog() { return log; }
+    int getFFTSize() { return fftSize; }
+};
+
+#endif /* FeatureExtractor_hpp */
@@ -0,0 +1,105 @@
+//
+//  FileInputDevice.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "FileInputDevice.hpp"
+
+FileInputDevice::FileInputDevice(std::string filePath, double ppm, int framesPerBlock) : path(filePath), rateOffsetPPM(ppm), blockLength(framesPerBlock), numChannels(0), numFrames(0), sampleRate(0.0), readFrame(0), callback(NULL), userData(NULL), running(false), stopRequested(false) {
+
+    if (blockLength <= 0) {
+        printf("%s: Invalid block length %d. Using 512\n", __PRETTY_FUNCTION__, blockLength);
+        blockLength = 512;
+    }
+}
+
+FileInputDevice::~FileInputDevice() {
+    stop();
+}
+
+/* The whole file is read into memory up front */
+bool FileInputDevice::load() {
+
+    WAVFile file(path);
+    if (!file.load())
+        return false;
+
+    samples.swap(file.getSamples());
+    numChannels = file.getNumChannels();
+    numFrames = file.getNumFrames();
+    sampleRate = file.getSampleRate();
+
+    readFrame = 0;
+    printf("%s: %s: %d channels, %.0f Hz, %d frames, clock offset %+.1f ppm\n", __PRETTY_FUNCTION__, path.c_str(), numChannels, sampleRate, numFrames, rateOffsetPPM);
+
+    return true;
+}
+
+bool FileInputDevice::start(PaStreamCallback *streamCallback, void *callbackUserData) {
+
+    if (numFrames == 0) {
+        printf("%s: %s isn't loaded\n", __PRETTY_FUNCTION__, path.c_str());
+        return false;
+    }
+    if (running) {
+        printf("%s: %s is already running\n", __PRETTY_FUNCTION__, path.c_str());
+        return false;
+    }
+
+    callback = streamCallback;
+    userData = callbackUserData;
+    stopRequested = false;
+    running = true;
+    clock = std::thread(&FileInputDevice::run, this);
+
+    return true;
+}
+
+bool FileInputDevice::stop() {
+
+    stopRequested = true;
+    if (clock.joinable())
+        clock.join();
+    running = false;
+
+    return true;
+}
+
+#pragma mark - Private Methods
+/* Deliver one block per period of the (offset) device clock, each stamped with its scheduled time */
+void FileInputDevice::run() {
+
+    std::vector<float> block((size_t)blockLength * numChannels);
+    double period = blockLength / getActualSampleRate();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long long numBlocks = 0;
+
+    while (!stopRequested) {
+
+        std::chrono::steady_clock::time_point deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(numBlocks * period));
+        std::this_thread::sleep_until(deadline);
+
+        /* Next block of the file, looping */
+        for (int i = 0; i < blockLength; i++) {
+            const float *frame = &samples[(size_t)(readFrame % numFrames) * numChannels];
+            memcpy(&block[(size_t)i * numChannels], frame, numChannels * sizeof(float));
+            readFrame++;
+        }
+
+        PaStreamCallbackTimeInfo timeInfo;
+        timeInfo.inputBufferAdcTime = std::chrono::duration<double>(deadline.time_since_epoch()).count();
+        timeInfo.currentTime = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        timeInfo.outputBufferDacTime = 0.0;
+
+        if (callback(block.data(), NULL, blockLength, &timeInfo, 0, userData) != paContinue)
+            break;
+
+        numBlocks++;
+    }
+
+    running = false;
+}
@@ -0,0 +1,70 @@
+//
+//  FileInputDevice.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef FileInputDevice_hpp
+#define FileInputDevice_hpp
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <portaudio.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include "WAVFile.hpp"
+
+/* Stand-in for an audio input device that plays a WAV file (looped) through a PortAudio-style callback on its own thread.
+
+    The "device clock" runs at the file's sample rate offset by rateOffsetPPM, so a few of these at different offsets behave like interfaces with drifting crystals. Each block is delivered at its scheduled time and stamped with it in timeInfo->inputBufferAdcTime (seconds on the steady clock), the way a real device stamps buffers with its hardware clock. Reads 16/24/32-bit integer and 32-bit float PCM. */
+class FileInputDevice {
+
+    std::string path;
+    double rateOffsetPPM;
+    int blockLength;
+
+    std::vector<float> samples;     // Interleaved
+    int numChannels;
+    int numFrames;
+    double sampleRate;              // Nominal, from the file header
+    unsigned long long readFrame;
+
+    PaStreamCallback *callback;
+    void *userData;
+    std::thread clock;
+    std::atomic<bool> running;
+    std::atomic<bool> stopRequested;
+
+#pragma mark - Private Methods
+    void run();
+
+public:
+
+    /* Constructor/Destructor */
+    FileInputDevice(std::string filePath, double ppm, int framesPerBlock);
+    ~FileInputDevice();
+
+    /* Read the file. Must succeed before start(). */
+    bool load();
+
+    /* Deliver blocks to the callback until stopped. The callback's output pointer is always NULL. */
+    bool start(PaStreamCallback *streamCallback, void *callbackUserData);
+    bool stop();
+    bool isActive() { return running; }
+
+    /* Getters */
+    std::string getPath() { return path; }
+    int getNumChannels() { return numChannels; }
+    double getSampleRate() { return sampleRate; }
+    double getActualSampleRate() { return sampleRate * (1.0 + 1e-6 * rateOffsetPPM); }
+    int getBlockLength() { return blockLength; }
+};
+
+#endif /* FileInputDevice_hpp */
@@ -0,0 +1,139 @@
+//
+//  LatencyProbe.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "LatencyProbe.hpp"
+
+#pragma mark - LatencyProbe
+LatencyProbe::LatencyProbe() : sampleRate(0.0f), outputChannel(0), inputChannel(0), captureLength(0), state(kLatencyProbeIdle), startFrame(0), position(0), reportedLatency(0.0) {
+
+    /* Maximum length sequence from a Fibonacci LFSR with taps 14, 13, 12, 2 */
+    int length = (1 << kLatencyProbeMLSOrder) - 1;
+    sequence.resize(length);
+
+    unsigned int lfsr = 1;
+    for (int i = 0; i < length; i++) {
+        sequence[i] = (lfsr & 1) ? kLatencyProbeAmplitude : -kLatencyProbeAmplitude;
+        unsigned int bit = ((lfsr >> 13) ^ (lfsr >> 12) ^ (lfsr >> 11) ^ (lfsr >> 1)) & 1;
+        lfsr = ((lfsr << 1) | bit) & ((1u << kLatencyProbeMLSOrder) - 1);
+    }
+}
+
+bool LatencyProbe::arm(float fs, int outChannel, int inChannel) {
+
+    int s = state;
+    if (s == kLatencyProbeArmed || s == kLatencyProbePlaying) {
+        printf("%s: A latency measurement is already in progress\n", __PRETTY_FUNCTION__);
+        return false;
+    }
+
+    sampleRate = fs;
+    outputChannel = outChannel;
+    inputChannel = inChannel;
+    captureLength = (int)sequence.size() + (int)(kLatencyProbeMaxLatency * sampleRate);
+
+    state = kLatencyProbeArmed;
+    return true;
+}
+
+void LatencyProbe::render(float *output, int nOutputChannels, unsigned long long blockStart, int length, double reportedSeconds) {
+
+    int s = state.load(std::memory_order_acquire);
+    if (s != kLatencyProbeArmed && s != kLatencyProbePlaying)
+        return;
+
+    if (outputChannel >= nOutputChannels) {
+        state = kLatencyProbeIdle;
+        return;
+    }
+
+    if (s == kLatencyProbeArmed) {
+        position = 0;
+        startFrame = blockStart;
+        reportedLatency = reportedSeconds;
+        state = kLatencyProbePlaying;
+    }
+
+    int sequenceLength = (int)sequence.size();
+    float *out = output + outputChannel;
+    for (int i = 0; i < length; i++, position++)
+        out[i * nOutputChannels] = position < sequenceLength ? sequence[position] : 0.0f;
+
+    if (position >= captureLength)
+        state.store(kLatencyProbeCaptured, std::memory_order_release);
+}
+
+LatencyMeasurement LatencyProbe::analyze(const float *recorded) {
+
+    LatencyMeasurement result;
+    memset(&result, 0, sizeof(LatencyMeasurement));
+    result.outputChannel = outputChannel;
+    result.inputChannel = inputChannel;
+    result.reportedSeconds = reportedLatency;
+
+    if (state != kLatencyProbeCaptured) {
+        printf("%s: No capture to analyze\n", __PRETTY_FUNCTION__);
+        return result;
+    }
+    state = kLatencyProbeIdle;
+
+    /* FFT long enough that the circular correlation has no wraparound at the lags we search */
+    int sequenceLength = (int)sequence.size();
+    int numLags = captureLength - sequenceLength + 1;
+    int N = FFTPlanCache::nextSupportedSize(captureLength + sequenceLength);
+    int half = N / 2;
+
+    FFTPlan *plan = fftPlans.getPlan(N, kFFTWindowRectangular, true);
+    if (!plan) {
+        printf("%s: No FFT plan for size %d\n", __PRETTY_FUNCTION__, N);
+        return result;
+    }
+
+    std::vector<float> x(N), xRe(half), xIm(half), pRe(half), pIm(half);
+    DSPSplitComplex X = {&xRe[0], &xIm[0]};
+    DSPSplitComplex P = {&pRe[0], &pIm[0]};
+
+    /* Both are zero-padded to N by the plan */
+    plan->forward(recorded, captureLength, &X);
+    plan->forward(&sequence[0], sequenceLength, &P);
+
+    /* X * conj(P). DC and Nyquist are packed real values in element 0. */
+    float dc = xRe[0] * pRe[0], nyquist = xIm[0] * pIm[0];
+    vDSP_zvmul(&P, 1, &X, 1, &X, 1, half, -1);
+    xRe[0] = dc;
+    xIm[0] = nyquist;
+
+    plan->inverse(&X, &x[0]);
+
+    /* Peak over non-negative lags */
+    float peak;
+    vDSP_Length peakIdx;
+    vDSP_maxmgvi(&x[0], 1, &peak, &peakIdx, numLags);
+
+    float rms;
+    vDSP_rmsqv(&x[0], 1, &rms, numLags);
+    result.peakRatio = rms > 0.0f ? peak / rms : 0.0f;
+    result.inverted = x[peakIdx] < 0.0f;
+
+    /* Parabolic interpolation on the magnitude around the peak */
+    double offset = 0.0;
+    if (peakIdx > 0 && peakIdx < numLags - 1) {
+        double a = fabs(x[peakIdx - 1]), b = fabs(x[peakIdx]), c = fabs(x[peakIdx + 1]);
+        double denominator = a - 2.0 * b + c;
+        if (denominator != 0.0)
+            offset = 0.5 * (a - c) / denominator;
+    }
+
+    result.latencyFrames = peakIdx + offset;
+    result.latencySeconds = result.latencyFrames / sampleRate;
+    result.valid = result.peakRatio >= kLatencyProbeMinPeakRatio;
+
+    if (!result.valid)
+        printf("%s: No clear loopback from output %d to input %d (peak ratio %.1f)\n", __PRETTY_FUNCTION__, outputChannel, inputChannel, result.peakRatio);
+
+    return result;
+}
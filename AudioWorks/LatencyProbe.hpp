@@ -0,0 +1,85 @@
+//
+//  LatencyProbe.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef LatencyProbe_hpp
+#define LatencyProbe_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <Accelerate/Accelerate.h>
+#include <vector>
+#include <atomic>
+#include "FFTPlanCache.hpp"
+
+#define kLatencyProbeMLSOrder (14)          // 16383-sample maximum length sequence
+#define kLatencyProbeAmplitude (0.25f)      // About -12 dBFS
+#define kLatencyProbeMaxLatency (0.5f)      // Seconds of input captured after the sequence ends
+#define kLatencyProbeMinPeakRatio (10.0f)   // Correlation peak / correlation RMS below which we don't trust the result
+
+typedef enum LatencyProbeState {
+    kLatencyProbeIdle,
+    kLatencyProbeArmed,             // Waiting for the next callback to start playing
+    kLatencyProbePlaying,
+    kLatencyProbeCaptured           // Everything we need is in the recording buffers
+} LatencyProbeState;
+
+struct LatencyMeasurement {
+    bool valid;
+    int outputChannel;
+    int inputChannel;
+    double latencyFrames;           // Output frame to the input frame it comes back on, sub-sample
+    double latencySeconds;
+    double reportedSeconds;         // What the host's timestamps claim (DAC time - ADC time) for comparison
+    float peakRatio;                // Correlation peak / correlation RMS; higher is a cleaner measurement
+    bool inverted;                  // The loop inverts polarity
+};
+
+/* Round-trip (output to input) latency measurement with a maximum length sequence.
+
+    arm() prepares the sequence on the calling thread. The callback passes each output block to render(), which starts playing at the next block boundary on the chosen output channel (replacing whatever was there) and then holds the channel silent until kLatencyProbeMaxLatency seconds have passed, so nothing else on that channel gets into the loop. Its first sample goes out at the absolute frame getStartFrame(), in the same numbering as the recording buffers, so the lag of the sequence in the recorded input is the full round trip: converters, buffering and the driver's safety offsets. analyze() finds it by FFT cross-correlation at the smallest FFTPlanCache size that avoids wraparound, with parabolic interpolation of the peak. */
+class LatencyProbe {
+
+    float sampleRate;
+    int outputChannel;
+    int inputChannel;
+
+    std::vector<float> sequence;
+    int captureLength;              // Sequence plus kLatencyProbeMaxLatency
+
+    std::atomic<int> state;
+    std::atomic<long long> startFrame;
+    int position;                   // Audio thread only
+    std::atomic<double> reportedLatency;
+
+    FFTPlanCache fftPlans;          // Correlation plans, kept between measurements at the same sample rate
+
+public:
+
+    /* Constructor */
+    LatencyProbe();
+
+    /* Main thread. Returns false if a measurement is in progress. */
+    bool arm(float fs, int outChannel, int inChannel);
+    void cancel() { state = kLatencyProbeIdle; }
+
+    /* Audio thread. Plays the sequence (or silence after it) on the probe's output channel of an interleaved block. reportedSeconds is the host's DAC - ADC time for the block. */
+    void render(float *output, int nOutputChannels, unsigned long long blockStart, int length, double reportedSeconds);
+
+    /* Main thread, once the state is kLatencyProbeCaptured: correlate captureLength recorded input frames starting at getStartFrame(). Returns the probe to idle. */
+    LatencyMeasurement analyze(const float *recorded);
+
+    /* Getters */
+    LatencyProbeState getState() { return (LatencyProbeState)state.load(); }
+    long long getStartFrame() { return startFrame; }
+    int getCaptureLength() { return captureLength; }
+    int getOutputChannel() { return outputChannel; }
+    int getInputChannel() { return inputChannel; }
+};
+
+#endif /* LatencyProbe_hpp */
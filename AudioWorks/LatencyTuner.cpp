@@ -0,0 +1,101 @@
+//
+//  LatencyTuner.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "LatencyTuner.hpp"
+
+LatencyTuner::LatencyTuner(int initialBufferLength) : enabled(false), pinned(false), bufferLength(initialBufferLength), unstableLength(0), cleanWindows(0) {}
+
+bool LatencyTuner::evaluate(const LatencyTunerStats &stats, unsigned long long frame, int &nextBufferLength) {
+
+    if (!enabled || pinned || stats.callbacks == 0)
+        return false;
+
+    char reason[128];
+
+    /* Glitched or close to it: step up right away */
+    if (stats.xruns > 0 || stats.maxLoad > kLatencyTunerMaxLoad) {
+
+        cleanWindows = 0;
+        unstableLength = bufferLength > unstableLength ? bufferLength : unstableLength;
+
+        if (bufferLength * 2 > kLatencyTunerMaxBufferLength)
+            return false;
+
+        if (stats.xruns > 0)
+            snprintf(reason, sizeof(reason), "%lu xruns in %lu callbacks", stats.xruns, stats.callbacks);
+        else
+            snprintf(reason, sizeof(reason), "max callback load %.2f > %.2f", stats.maxLoad, kLatencyTunerMaxLoad);
+
+        nextBufferLength = bufferLength * 2;
+        record(frame, stats, nextBufferLength, reason);
+        return true;
+    }
+
+    /* Clean window. Step down once we've had enough of them and the shorter length hasn't already failed. */
+    if (stats.maxLoad > kLatencyTunerStepDownLoad) {
+        cleanWindows = 0;
+        return false;
+    }
+
+    if (++cleanWindows < kLatencyTunerStableWindows)
+        return false;
+
+    int shorter = bufferLength / 2;
+    if (shorter < kLatencyTunerMinBufferLength || shorter <= unstableLength)
+        return false;
+
+    snprintf(reason, sizeof(reason), "%d clean windows, max callback load %.2f", cleanWindows, stats.maxLoad);
+    nextBufferLength = shorter;
+    record(frame, stats, nextBufferLength, reason);
+    cleanWindows = 0;
+    return true;
+}
+
+void LatencyTuner::pin(int length, unsigned long long frame) {
+
+    LatencyTunerStats none = {0, 0, 0.0f, 0.0f};
+    record(frame, none, length, "pinned");
+    pinned = true;
+}
+
+void LatencyTuner::unpin(unsigned long long frame) {
+
+    if (!pinned)
+        return;
+
+    LatencyTunerStats none = {0, 0, 0.0f, 0.0f};
+    record(frame, none, bufferLength, "unpinned");
+    pinned = false;
+    cleanWindows = 0;
+}
+
+void LatencyTuner::reset() {
+    unstableLength = 0;
+    cleanWindows = 0;
+}
+
+void LatencyTuner::printLog() {
+
+    for (int i = 0; i < (int)log.size(); i++)
+        printf("frame %10llu: %4d -> %4d (%s)\n", log[i].frame, log[i].fromBufferLength, log[i].toBufferLength, log[i].reason.c_str());
+}
+
+#pragma mark - Private Methods
+void LatencyTuner::record(unsigned long long frame, const LatencyTunerStats &stats, int toLength, std::string reason) {
+
+    LatencyTunerDecision decision;
+    decision.frame = frame;
+    decision.stats = stats;
+    decision.fromBufferLength = bufferLength;
+    decision.toBufferLength = toLength;
+    decision.reason = reason;
+
+    if (log.size() >= kLatencyTunerLogLength)
+        log.erase(log.begin());
+    log.push_back(decision);
+}
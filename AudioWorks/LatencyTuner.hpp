@@ -0,0 +1,80 @@
+//
+//  LatencyTuner.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef LatencyTuner_hpp
+#define LatencyTuner_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+
+#define kLatencyTunerMinBufferLength (32)
+#define kLatencyTunerMaxBufferLength (2048)
+#define kLatencyTunerLatencyBuffers (2.0)       // Suggested latency in low-latency mode, in buffer periods
+#define kLatencyTunerMaxLoad (0.7f)             // Worst callback duration / buffer period we'll accept
+#define kLatencyTunerStepDownLoad (0.3f)        // Worst load that lets us try a buffer half as long
+#define kLatencyTunerStableWindows (5)          // Clean windows in a row before stepping down
+#define kLatencyTunerLogLength (256)
+
+/* Callback statistics over one evaluation window */
+struct LatencyTunerStats {
+    unsigned long callbacks;
+    unsigned long xruns;        // Callbacks with any over/underflow status flag set
+    float meanLoad;             // Callback duration / buffer period
+    float maxLoad;
+};
+
+struct LatencyTunerDecision {
+    unsigned long long frame;   // Recorded frame count when the decision was made
+    LatencyTunerStats stats;
+    int fromBufferLength;
+    int toBufferLength;
+    std::string reason;
+};
+
+/* Picks the smallest stable audio buffer length from xrun and callback load statistics.
+
+    Each evaluation window either steps the buffer up (any xrun, or the slowest callback used too much of its period), steps it down (several clean, lightly-loaded windows in a row), or holds. A length that glitched is remembered, and we never step back down to it, so the tuner settles instead of oscillating. Every change is logged; pin() fixes a length and stops the tuner from moving it. */
+class LatencyTuner {
+
+    bool enabled;
+    bool pinned;
+    int bufferLength;
+    int unstableLength;         // Longest length that has glitched (0 if none)
+    int cleanWindows;
+
+    std::vector<LatencyTunerDecision> log;
+
+    void record(unsigned long long frame, const LatencyTunerStats &stats, int toLength, std::string reason);
+
+public:
+
+    LatencyTuner(int initialBufferLength);
+
+    /* Evaluate one window at the current buffer length. Returns true and sets nextBufferLength if the length should change. */
+    bool evaluate(const LatencyTunerStats &stats, unsigned long long frame, int &nextBufferLength);
+
+    /* The buffer length actually in use changed (by the tuner or otherwise) */
+    void setBufferLength(int length) { bufferLength = length; cleanWindows = 0; }
+
+    /* Pin a length for the show, or release it. Pinning logs a decision. */
+    void pin(int length, unsigned long long frame);
+    void unpin(unsigned long long frame);
+
+    /* Forget which lengths glitched, e.g. after a device change */
+    void reset();
+
+    void setEnabled(bool enable) { enabled = enable; cleanWindows = 0; }
+    bool isEnabled() { return enabled; }
+    bool isPinned() { return pinned; }
+    int getBufferLength() { return bufferLength; }
+    const std::vector<LatencyTunerDecision> &getLog() { return log; }
+    void printLog();
+};
+
+#endif /* LatencyTuner_hpp */
@@ -20,12 +20,15 @@
 @class METScopeLabelView;
 @class METScopePlotDataView;
 
+#define kMETScopeOctaveReferenceFrequency (1000.0)
+
 /* -------------------- */
 /* === Enumerations === */
 /* -------------------- */
 typedef enum METScopeDisplayMode {
     kMETScopeDisplayModeTimeDomain,
-    kMETScopeDisplayModeFrequencyDomain
+    kMETScopeDisplayModeFrequencyDomain,
+    kMETScopeDisplayModeOctaveBands         // x is in octaves relative to kMETScopeOctaveReferenceFrequency
 } METScopeDisplayMode;
 
 typedef enum METScopeAxisScale {
@@ -107,9 +110,11 @@ typedef enum METScopeYLabelPosition {
 #pragma mark Public Interface Methods
 /* Display parameters */
 - (void)setPlotResolution:(int)res;
+- (int)plotResolution;
 - (void)setUpFFTWithSize:(int)size;
 - (void)setDisplayMode:(METScopeDisplayMode)mode;
 - (void)setAxisScale:(METScopeAxisScale)pAxisScale;
+- (METScopeAxisScale)axisScale;
 - (void)setAxesOn:(bool)pAxesOn;
 - (void)setGridOn:(bool)pGridOn;
 - (void)setXLabelsOn:(bool)pXLabelsOn;
@@ -134,6 +139,8 @@ typedef enum METScopeYLabelPosition {
 - (int)addPlotWithColor:(NSColor *)color lineWidth:(float)width;
 - (int)addPlotWithResolution:(int)res color:(NSColor *)color lineWidth:(float)width;
 - (void)setPlotDataAtIndex:(int)idx withLength:(int)len xData:(float *)xx yData:(float *)yy;
+- (void)setDecimatedPlotDataAtIndex:(int)idx withLength:(int)len xData:(const float *)xx yData:(const float *)yy envelope:(bool)env;
+- (bool)scrollPlotDataAtIndex:(int)idx byColumns:(int)shift withLength:(int)len yData:(const float *)yy envelope:(bool)env;
 - (void)getPlotDataAtIndex:(int)idx withLength:(int)len xData:(float *)xx yData:(float *)yy;
 - (void)setCoordinatesInFDModeAtIndex:(int)idx withLength:(int)len xData:(float *)xx yData:(float *)yy;
 - (void)removeAllPlots;
@@ -7,6 +7,8 @@
 //
 
 #import "METScopeView.h"
+#import "PlotGeometry.hpp"
+#import "FFTPlanCache.hpp"
 
 static NSColor *const kDefaultBackgroundColor = [NSColor blackColor];
 static NSColor *const kDefaultGridColor = [NSColor whiteColor];
@@ -26,14 +28,11 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     
     /* Spectrum mode FFT parameters */
     int fftSize;                // Length of FFT, 2*nBins
-    int windowSize;             // Length of Hann window
-    float *freqs;               // Frequency bin centers
-    float *inRealBuffer;        // Input buffer
-    float *outRealBuffer;       // Output buffer
-    float *window;              // Hann window
-    CGFloat scale;              // Normalization constant
-    FFTSetup fftSetup;          // vDSP FFT struct
-    COMPLEX_SPLIT splitBuffer;  // Buffer holding real and complex parts
+    FFTPlanCache *fftPlans;     // Plans for every size/window we've used, so resolution changes don't reallocate
+    FFTPlan *fftPlan;           // Current size, Hann window
+    FFTPlan *fftPlanUnwindowed; // Current size, rectangular window
+    std::vector<float> freqs;   // Frequency bin centers
+    std::vector<float> fftMagnitude;
 }
 
 /* Private uitility methods */
@@ -65,14 +64,20 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     float *inputXBuffer;
     float *inputYBuffer;
     float *resamplingIndices;
-    CGPoint *plotPixels;
+    PlotGeometry *geometry;     // Pixel transform and polyline reduction
     pthread_mutex_t dataMutex;
 }
-@property (readonly) CGPoint *plotUnits;
+@property (readonly) float *unitsX;     // Plot units as separate x and y arrays, as the geometry stage reads them
+@property (readonly) float *unitsY;
 - (id)initWithParentView:(METScopeView *)pParent resolution:(int)pRes plotColor:(NSColor *)pColor lineWidth:(CGFloat)pWidth;
 - (void)setResolution:(int)pRes;
 - (void)setDataWithLength:(int)length xData:(float *)xx yData:(float *)yy;
+- (void)setDecimatedDataWithLength:(int)length xData:(const float *)xx yData:(const float *)yy envelope:(bool)env;
+- (bool)scrollDataByColumns:(int)shift withLength:(int)length yData:(const float *)yy envelope:(bool)env;
 - (void)rescalePlotData;
+- (bool)updateGeometryTransform;
+- (void)transformPlotUnits;
+- (void)reduceGeometry;
 @end
 
 #pragma mark - METScopeView
@@ -130,7 +135,7 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
 }
 
 - (void)dealloc {
-    
+    delete fftPlans;
 }
 
 - (void)setNeedsDisplay:(BOOL)needsDisplay {
@@ -283,29 +288,29 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     }
 }
 
-/* Initialize a vDSP fft struct, buffers, windows, etc. */
+- (int)plotResolution {
+    return plotResolution;
+}
+
+/* Select FFT plans for a size, building them the first time a size is used. Sizes can be f * 2^n for f in {1, 3, 5, 15} (see FFTPlanCache). */
 - (void)setUpFFTWithSize:(int)size {
     
-    fftSize = size;
-    
-    scale = 2.0f / (float)(fftSize);     // Normalization constant
-    
-    /* Buffers */
-    freqs = (float *)malloc(fftSize/2 * sizeof(float));
-    [self linspace:0.0 max:samplingRate/2 numElements:fftSize/2 array:freqs];
+    if (!FFTPlanCache::isSupportedSize(size)) {
+        printf("%s: Unsupported FFT size %d. Nearest larger supported size = %d\n", __PRETTY_FUNCTION__, size, FFTPlanCache::nextSupportedSize(size));
+        return;
+    }
     
-    inRealBuffer = (float *)malloc(fftSize * sizeof(float));
-    outRealBuffer = (float *)malloc(fftSize * sizeof(float));
-    splitBuffer.realp = (float *)malloc(fftSize/2 * sizeof(float));
-    splitBuffer.imagp = (float *)malloc(fftSize/2 * sizeof(float));
+    if (!fftPlans)
+        fftPlans = new FFTPlanCache();
     
-    /* Hann Window */
-    windowSize = size;
-    window = (float *)calloc(windowSize, sizeof(float));
-    vDSP_hann_window(window, windowSize, vDSP_HANN_NORM);
+    fftPlan = fftPlans->getPlan(size, kFFTWindowHann);
+    fftPlanUnwindowed = fftPlans->getPlan(size, kFFTWindowRectangular);
+    fftSize = size;
     
-    /* Allocate the FFT struct */
-    fftSetup = vDSP_create_fftsetup(log2f(fftSize), FFT_RADIX2);
+    /* Vectors keep their capacity when they shrink, so switching back and forth between sizes doesn't allocate */
+    freqs.resize(fftSize/2);
+    fftMagnitude.resize(fftSize/2);
+    [self linspace:0.0 max:samplingRate/2 numElements:fftSize/2 array:&freqs[0]];
 }
 
 /* Set the display mode to time/frequency domain and automatically rescale to default limits */
@@ -353,6 +358,28 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
         displayMode = mode;
     }
     
+    else if (mode == kMETScopeDisplayModeOctaveBands) {
+        
+        axisScale = kMETScopeAxisScaleSemilogY;
+        
+        /* Hard limits: 20 Hz to 20 kHz in octaves relative to the reference frequency */
+        [self setHardXLim:log2(20.0 / kMETScopeOctaveReferenceFrequency)
+                      max:log2(20000.0 / kMETScopeOctaveReferenceFrequency)];
+        [self setHardYLim:-80.0 max:0.0];
+        
+        /* Tick/grid/labels: one tick per octave, labeled in Hz */
+        [self setPlotUnitsPerXTick:1.0];
+        [self setPlotUnitsPerYTick:20.0];
+        xLabelFormatString = @"%5.0f";
+        yLabelFormatString = @"%3.2f";
+        
+        /* Visible limits */
+        [self setVisibleXLim:minPlotMin.x max:maxPlotMax.x];
+        [self setVisibleYLim:minPlotMin.y max:maxPlotMax.y];
+        
+        displayMode = mode;
+    }
+    
     /* Update the subviews */
     [self setNeedsDisplay:true];
 }
@@ -704,11 +731,33 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     /* Frequency-domain mode: perform FFT, pass magnitude */
     else if (displayMode == kMETScopeDisplayModeFrequencyDomain) {
         
-        Float32 *yBuffer = (Float32 *)calloc(fftSize/2, sizeof(Float32));
-        [self computeMagnitudeFFT:yy inBufferLength:len outMagnitude:yBuffer seWindow:true];
-        [subView setDataWithLength:fftSize/2 xData:freqs yData:yBuffer];
-        free(yBuffer);
+        [self computeMagnitudeFFT:yy inBufferLength:len outMagnitude:&fftMagnitude[0] seWindow:true];
+        [subView setDataWithLength:fftSize/2 xData:&freqs[0] yData:&fftMagnitude[0]];
+    }
+}
+
+/* Set time-domain plot data that has already been decimated to the plot resolution (e.g. by a ScopeFrameProducer) */
+- (void)setDecimatedPlotDataAtIndex:(int)idx withLength:(int)len xData:(const float *)xx yData:(const float *)yy envelope:(bool)env {
+    
+    /* Sanity check */
+    if (idx < 0 || idx >= plotDataSubviews.count) {
+        NSLog(@"Invalid plot data index %d\nplotDataSubviews.count = %lu", idx, (unsigned long)plotDataSubviews.count);
+        return;
     }
+    
+    [((METScopePlotDataView *)plotDataSubviews[idx]) setDecimatedDataWithLength:len xData:xx yData:yy envelope:env];
+}
+
+/* Shift decimated time-domain plot data left by a number of columns, taking only the new columns on the right from yy. Returns false if the data can't be shifted (e.g. the resolution changed), in which case the caller should set the whole frame with setDecimatedPlotDataAtIndex: */
+- (bool)scrollPlotDataAtIndex:(int)idx byColumns:(int)shift withLength:(int)len yData:(const float *)yy envelope:(bool)env {
+    
+    /* Sanity check */
+    if (idx < 0 || idx >= plotDataSubviews.count) {
+        NSLog(@"Invalid plot data index %d\nplotDataSubviews.count = %lu", idx, (unsigned long)plotDataSubviews.count);
+        return false;
+    }
+    
+    return [((METScopePlotDataView *)plotDataSubviews[idx]) scrollDataByColumns:shift withLength:len yData:yy envelope:env];
 }
 
 - (void)getPlotDataAtIndex:(int)idx withLength:(int)len xData:(float *)xx yData:(float *)yy {
@@ -716,10 +765,8 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     if (idx >= 0 && idx < plotDataSubviews.count) {
         
         METScopePlotDataView *dataView = ((METScopePlotDataView *)plotDataSubviews[idx]);
-        for (int i = 0; i < len; i++) {
-            xx[i] = dataView.plotUnits[i].x;
-            yy[i] = dataView.plotUnits[i].y;
-        }
+        memcpy(xx, dataView.unitsX, len * sizeof(float));
+        memcpy(yy, dataView.unitsY, len * sizeof(float));
     }
     else
         NSLog(@"Invalid plot data index %d\nplotDataSubviews.count = %lu", idx, (unsigned long)plotDataSubviews.count);
@@ -747,6 +794,10 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
                        [self plotScaleToPixelVertical:plotScale.y]);
 }
 
+- (METScopeAxisScale)axisScale {
+    return axisScale;
+}
+
 - (CGFloat)plotScaleToPixelHorizontal:(CGFloat)x {
     return self.frame.size.width * (x - visiblePlotMin.x) / (visiblePlotMax.x - visiblePlotMin.x);
 }
@@ -802,82 +853,16 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
 /* Compute the single-sided magnitude spectrum using Accelerate's vDSP methods */
 - (void)computeMagnitudeFFT:(Float32 *)inBuffer inBufferLength:(int)len outMagnitude:(float *)magnitude seWindow:(bool)doWindow {
     
-    if (fftSetup == NULL) {
+    if (fftPlan == NULL) {
         printf("%s: Warning: must call [METScopeView setUpFFTWithSize] before enabling frequency domain mode\n", __PRETTY_FUNCTION__);
         return;
     }
     
-    /* If the input signal is shorter than the fft size, zero-pad */
-    if (len < fftSize) {
-        
-        /* Window and zero-pad */
-        if (doWindow) {
-            
-            /* Compute the window with same length as the input signal */
-            float *shortWindow = (float *)malloc(len * sizeof(float));
-            vDSP_hann_window(shortWindow, len, vDSP_HANN_NORM);
-            
-            /* Window it */
-            float *windowed = (float *)malloc(len * sizeof(float));
-            vDSP_vmul(inBuffer, 1, shortWindow, 1, windowed, 1, len);
-            
-            /* Copy */
-            for (int i = 0; i < len; i++)
-                inRealBuffer[i] = windowed[i];
-            
-            /* Zero-pad */
-            for (int i = len; i < fftSize; i++)
-                inRealBuffer[i] = 0.0f;
-            
-            free(shortWindow);
-            free(windowed);
-        }
-        
-        /* Just copy and zero-pad */
-        else {
-            for (int i = 0; i < len; i++)
-                inRealBuffer[i] = inBuffer[i];
-            
-            for (int i = len; i < fftSize; i++)
-                inRealBuffer[i] = 0.0f;
-        }
-    }
-    
-    /* No zero-padding */
-    else {
-        
-        /* Multiply by Hann window */
-        if (doWindow)
-            vDSP_vmul(inBuffer, 1, window, 1, inRealBuffer, 1, len);
-        
-        /* Otherwise just copy into the real input buffer */
-        else
-            cblas_scopy(fftSize, inBuffer, 1, inRealBuffer, 1);
-    }
-    
-    /* Transform the real input data into the even-odd split required by vDSP_fft_zrip() explained in: https://developer.apple.com/library/ios/documentation/Performance/Conceptual/vDSP_Programming_Guide/UsingFourierTransforms/UsingFourierTransforms.html */
-    vDSP_ctoz((COMPLEX *)inRealBuffer, 2, &splitBuffer, 1, fftSize/2);
-    
-    /* Computer the FFT */
-    vDSP_fft_zrip(fftSetup, &splitBuffer, 1, log2f(fftSize), FFT_FORWARD);
-    
-    splitBuffer.imagp[0] = 0.0;     // ?? Shitty did this
-    
-    /* Convert the split complex data splitBuffer to an interleaved complex coordinate pairs */
-    vDSP_ztoc(&splitBuffer, 1, (COMPLEX *)inRealBuffer, 2, fftSize/2);
-    
-    /* Convert the interleaved complex vector to interleaved polar coordinate pairs (magnitude, phase) */
-    vDSP_polar(inRealBuffer, 2, outRealBuffer, 2, fftSize/2);
-    
-    /* Copy the even indices (magnitudes) */
-    cblas_scopy(fftSize/2, outRealBuffer, 2, magnitude, 1);
-    
-    /* Normalize the magnitude */
-    for (int i = 0; i < fftSize/2; i++)
-        magnitude[i] *= scale;
-    
-    //    /* Copy the odd indices (phases) */
-    //    cblas_scopy(fftSize/2, outRealBuffer+1, 2, phase, 1);
+    /* Shorter inputs are windowed at their own length and zero-padded */
+    if (doWindow)
+        fftPlan->computeMagnitude(inBuffer, len, magnitude);
+    else
+        fftPlanUnwindowed->computeMagnitude(inBuffer, len, magnitude);
 }
 
 
@@ -1224,6 +1209,15 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     if (parent.yLabelsOn)   [self drawYLabels];
 }
 
+/* Value shown for an x-axis label at a plot-scale location. Octave band mode plots in octaves, but we label in Hz. */
+- (CGFloat)xLabelValue:(CGFloat)x {
+    
+    if (parent.displayMode == kMETScopeDisplayModeOctaveBands)
+        return kMETScopeOctaveReferenceFrequency * pow(2.0, x);
+    
+    return x;
+}
+
 - (void)drawXLabels {
     
     CGPoint loc;            // Current point in pixels
@@ -1254,7 +1248,7 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     while(loc.x <= self.frame.size.width) {
         
         loc.x += self.frame.origin.x;
-        label = [NSString stringWithFormat:parent.xLabelFormatString, [parent pixelToPlotScale:loc].x];
+        label = [NSString stringWithFormat:parent.xLabelFormatString, [self xLabelValue:[parent pixelToPlotScale:loc].x]];
         loc.x -= self.frame.origin.x;
         loc.x += labelCenter;
         [label drawAtPoint:loc withAttributes:labelAttributes];
@@ -1279,7 +1273,7 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     while(loc.x >= 0) {
         
         loc.x += self.frame.origin.x;
-        label = [NSString stringWithFormat:parent.xLabelFormatString, [parent pixelToPlotScale:loc].x];
+        label = [NSString stringWithFormat:parent.xLabelFormatString, [self xLabelValue:[parent pixelToPlotScale:loc].x]];
         loc.x -= self.frame.origin.x;
         loc.x += labelCenter;
         [label drawAtPoint:loc withAttributes:labelAttributes];
@@ -1361,7 +1355,8 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
 @synthesize lineWidth;
 @synthesize lineColor;
 
-@synthesize plotUnits;
+@synthesize unitsX;
+@synthesize unitsY;
 
 /* Create a transparent subview using the parent's frame and specified color and linewidth */
 - (id)initWithParentView:(METScopeView *)pParent resolution:(int)pRes plotColor:(NSColor *)pColor lineWidth:(CGFloat)pWidth {
@@ -1377,6 +1372,7 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
         parent = pParent;
         lineColor = pColor;
         lineWidth = pWidth;
+        geometry = new PlotGeometry();
         [self setResolution:pRes];
         visible = true;
         pthread_mutex_init(&dataMutex, NULL);
@@ -1393,8 +1389,9 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     if (inputXBuffer) free(inputXBuffer);
     if (inputYBuffer) free(inputYBuffer);
     if (resamplingIndices) free(resamplingIndices);
-    if (plotUnits)  free(plotUnits);
-    if (plotPixels) free(plotPixels);
+    if (unitsX) free(unitsX);
+    if (unitsY) free(unitsY);
+    delete geometry;
     
     pthread_mutex_unlock(&dataMutex);
     pthread_mutex_destroy(&dataMutex);
@@ -1416,14 +1413,14 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     if (inputXBuffer) free(inputXBuffer);
     if (inputYBuffer) free(inputYBuffer);
     if (resamplingIndices) free(resamplingIndices);
-    if (plotUnits) free(plotUnits);
-    if (plotPixels) free(plotPixels);
+    if (unitsX) free(unitsX);
+    if (unitsY) free(unitsY);
     
     inputXBuffer = (float *)calloc(resolution, sizeof(float));
     inputYBuffer = (float *)calloc(resolution, sizeof(float));
     resamplingIndices = (float *)calloc(resolution, sizeof(float));
-    plotUnits  = (CGPoint *)calloc(resolution, sizeof(CGPoint));
-    plotPixels = (CGPoint *)calloc(resolution, sizeof(CGPoint));
+    unitsX = (float *)calloc(resolution, sizeof(float));
+    unitsY = (float *)calloc(resolution, sizeof(float));
     
     pthread_mutex_unlock(&dataMutex);
 }
@@ -1466,8 +1463,8 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
             
             /* Copy the data */
             pthread_mutex_lock(&dataMutex);
-            for (int i = 0; i < resolution; i++)
-                plotUnits[i] = CGPointMake(inputXBuffer[i], inputYBuffer[i]);
+            memcpy(unitsX, inputXBuffer, resolution * sizeof(float));
+            memcpy(unitsY, inputYBuffer, resolution * sizeof(float));
             pthread_mutex_unlock(&dataMutex);
         }
         
@@ -1483,7 +1480,8 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
             int idx;
             for (int i = 0; i < resolution; i++) {
                 idx = (int)resamplingIndices[i];
-                plotUnits[i] = CGPointMake(xBuffer[idx], yBuffer[idx]);
+                unitsX[i] = xBuffer[idx];
+                unitsY[i] = yBuffer[idx];
             }
             
             pthread_mutex_unlock(&dataMutex);
@@ -1514,7 +1512,8 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
             while (target.x < next.x) {
                 perc = (target.x - current.x) / (next.x - current.x);
                 target.y = current.y * (1-perc) + next.y * perc;
-                plotUnits[j] = target;
+                unitsX[j] = target.x;
+                unitsY[j] = target.y;
                 j++;
                 target.x = resamplingIndices[j];
             }
@@ -1530,7 +1529,8 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
             j++;
             perc = (target.x - current.x) / (next.x - current.x);
             target.y = current.y * (1-perc) + next.y * perc;
-            plotUnits[j] = target;
+            unitsX[j] = target.x;
+            unitsY[j] = target.y;
         }
         
         pthread_mutex_unlock(&dataMutex);
@@ -1539,47 +1539,119 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     /* If waveform has number of samples == plot resolution, just copy */
     else {
         pthread_mutex_lock(&dataMutex);
-        for (int i = 0; i < length; i++)
-            plotUnits[i] = CGPointMake(xBuffer[i], yBuffer[i]);
+        memcpy(unitsX, xBuffer, length * sizeof(float));
+        memcpy(unitsY, yBuffer, length * sizeof(float));
         pthread_mutex_unlock(&dataMutex);
     }
     
     [self rescalePlotData];     // Convert sampled plot units to pixels
 }
 
+/* Set plot data that's already been decimated, skipping the resampling in setDataWithLength: */
+- (void)setDecimatedDataWithLength:(int)length xData:(const float *)xx yData:(const float *)yy envelope:(bool)env {
+    
+    /* Data doesn't match our resolution, so fall back to resampling */
+    if (length != resolution) {
+        [self setDataWithLength:length xData:(float *)xx yData:(float *)yy];
+        return;
+    }
+    
+    plotMode = env ? kMETScopePlotModeFillSymmetrical : kMETScopePlotModeLine;
+    
+    pthread_mutex_lock(&dataMutex);
+    memcpy(unitsX, xx, length * sizeof(float));
+    memcpy(unitsY, yy, length * sizeof(float));
+    pthread_mutex_unlock(&dataMutex);
+    
+    [self rescalePlotData];     // Convert plot units to pixels
+}
+
+/* Shift the plot data left, keeping each column's x position, and convert only the new columns to pixels */
+- (bool)scrollDataByColumns:(int)shift withLength:(int)length yData:(const float *)yy envelope:(bool)env {
+    
+    if (length != resolution || shift <= 0 || shift >= resolution)
+        return false;
+    
+    plotMode = env ? kMETScopePlotModeFillSymmetrical : kMETScopePlotModeLine;
+    
+    pthread_mutex_lock(&dataMutex);
+    
+    memmove(unitsY, unitsY + shift, (resolution - shift) * sizeof(float));
+    memcpy(unitsY + resolution - shift, yy + resolution - shift, shift * sizeof(float));
+    
+    /* Old columns only move horizontally, so their pixel heights carry over unless the view limits changed */
+    if ([self updateGeometryTransform] || geometry->getNumPoints() != resolution)
+        [self transformPlotUnits];
+    else
+        geometry->scroll(shift, yy + resolution - shift);
+    
+    [self reduceGeometry];
+    
+    pthread_mutex_unlock(&dataMutex);
+    
+    [self setNeedsDisplay:true];     // Update
+    
+    return true;
+}
+
 /* Convert plot units to pixels */
 - (void)rescalePlotData {
     
     pthread_mutex_lock(&dataMutex);
     
-    for (int i = 0; i < resolution; i++) //{
-        plotPixels[i] = [parent plotScaleToPixel:plotUnits[i]];
+    [self updateGeometryTransform];
+    [self transformPlotUnits];
+    [self reduceGeometry];
     
     pthread_mutex_unlock(&dataMutex);
     
     [self setNeedsDisplay:true];     // Update
 }
 
+/* Match the geometry's plot unit -> pixel transform to the parent's visible limits. Returns true if it changed. Call with dataMutex held. */
+- (bool)updateGeometryTransform {
+    return geometry->setTransform(parent.visiblePlotMin.x, parent.visiblePlotMax.x,
+                                  parent.visiblePlotMin.y, parent.visiblePlotMax.y,
+                                  parent.frame.size.width, parent.frame.size.height,
+                                  [parent axisScale] == kMETScopeAxisScaleSemilogY);
+}
+
+/* Transform all plot units to pixels. Call with dataMutex held. */
+- (void)transformPlotUnits {
+    geometry->transform(unitsX, unitsY, resolution);
+}
+
+/* Reduce the transformed points to the vertices we'll actually draw. Call with dataMutex held. */
+- (void)reduceGeometry {
+    
+    if (plotMode == kMETScopePlotModeFillSymmetrical)
+        geometry->reduceColumns([parent plotScaleToPixelVertical:0.0]);
+    else
+        geometry->reduceLine();
+}
+
 /* Add a constant value to all x data in plot units */
 - (void)addToPlotXData:(CGFloat)value {
     
+    float offset = value;
+    
     pthread_mutex_lock(&dataMutex);
-    for (int i = 0; i < resolution; i++)
-        plotUnits[i].x += value;
+    vDSP_vsadd(unitsX, 1, &offset, unitsX, 1, resolution);
     pthread_mutex_unlock(&dataMutex);
     
-    [self setNeedsDisplay:true];     // Update
+    [self rescalePlotData];     // Update pixels
 }
 
 /* Add a constant value to all y data in plot units */
 - (void)addToPlotYData:(CGFloat)value {
     
+    float offset = value;
+    
     pthread_mutex_lock(&dataMutex);
-    for (int i = 0; i < resolution; i++)
-        plotUnits[i].y += value;
+    vDSP_vsadd(unitsY, 1, &offset, unitsY, 1, resolution);
     pthread_mutex_unlock(&dataMutex);
     
-    [self setNeedsDisplay:true];     // Update
+    [self rescalePlotData];     // Update pixels
 }
 
 /* UIView subclass override. Main drawing method */
@@ -1590,77 +1662,39 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     
     pthread_mutex_lock(&dataMutex);
     
+    /* Vertices are already culled, clipped and reduced to a few per pixel column */
+    const PlotVertex *vertices = geometry->getVertices();
+    int numVertices = geometry->getNumVertices();
+    if (numVertices < 2) {
+        pthread_mutex_unlock(&dataMutex);
+        return;
+    }
+    
     /* Set up Bezier path */
     NSBezierPath *path = [NSBezierPath bezierPath];
     [path setLineWidth:lineWidth];
     [lineColor setStroke];
     
-    CGPoint current, previous;
-    CGPoint originPixel = [parent plotScaleToPixel:CGPointMake(0.0, 0.0)];
-    
-    /* Find the first non-NaN pixel location */
-    int startIdx = 0;
-    while ((isnan((float)plotPixels[startIdx].x) || isnan((float)plotPixels[startIdx].y) ||
-            (isinf((float)plotPixels[startIdx].x) || isinf((float)plotPixels[startIdx].x)))
-           && startIdx < resolution-1)
-        startIdx++;
-    
-    /* */
+    /* One vertical line per column, mirrored about the origin */
     if (plotMode == kMETScopePlotModeFillSymmetrical) {
         
-        for (int i = startIdx+1; i < resolution-1; i++) {
-            
-            /* Skip any NaNs */
-            if (isnan((float)plotPixels[i].x) || isnan((float)plotPixels[i].y))
-                continue;
-            
-            
-            if (parent.displayMode == kMETScopeDisplayModeTimeDomain) {
-                
-                /* Skip anything beyond the plot's temporal bounds */
-                if (plotUnits[i].x < parent.visiblePlotMin.x ||
-                    plotUnits[i].x > parent.visiblePlotMax.x)
-                    continue;
-                
-                plotUnits[i].y = plotUnits[i].y > parent.visiblePlotMax.y ? parent.visiblePlotMax.y : plotUnits[i].y;
-                plotUnits[i].y = plotUnits[i].y < parent.visiblePlotMin.y ? parent.visiblePlotMin.y : plotUnits[i].y;
-            }
-            
-            current = plotPixels[i];
-            
-            [path moveToPoint:current];
-            current.y -= 2 * (current.y - originPixel.y);
-            [path lineToPoint:current];
+        CGFloat originY = [parent plotScaleToPixelVertical:0.0];
+        for (int i = 0; i < numVertices; i++) {
+            [path moveToPoint:CGPointMake(vertices[i].x, vertices[i].y)];
+            [path lineToPoint:CGPointMake(vertices[i].x, vertices[i].y - 2 * (vertices[i].y - originY))];
         }
-        
-        [path stroke];
     }
     
+    /* One connected polyline */
     else {
         
-        previous = plotPixels[startIdx];
-        
-        for (int i = startIdx+1; i < resolution-1; i++) {
-            
-            /* Skip any NaNs or Infs */
-            if (isnan((float)plotPixels[i].x) || isnan((float)plotPixels[i].y) ||
-                isinf((float)plotPixels[i].x) || isinf((float)plotPixels[i].y))
-                continue;
-        
-            /* Skip anything beyond the plot bounds */
-            if (parent.displayMode == kMETScopeDisplayModeTimeDomain &&
-                (plotUnits[i].x < parent.visiblePlotMin.x || plotUnits[i].x > parent.visiblePlotMax.x ||
-                 plotUnits[i].y < parent.visiblePlotMin.y || plotUnits[i].y > parent.visiblePlotMax.y))
-                continue;
-            
-            [path moveToPoint:previous];
-            [path lineToPoint:plotPixels[i]];
-            previous = plotPixels[i];
-        }
-        
-        [path stroke];
+        [path moveToPoint:CGPointMake(vertices[0].x, vertices[0].y)];
+        for (int i = 1; i < numVertices; i++)
+            [path lineToPoint:CGPointMake(vertices[i].x, vertices[i].y)];
     }
     
+    [path stroke];
+    
     pthread_mutex_unlock(&dataMutex);
 }
 
@@ -1670,15 +1704,15 @@ static NSColor *const kDefaultGridColor = [NSColor whiteColor];
     CGFloat inc = (parent.visiblePlotMax.x - parent.visiblePlotMin.x) / (CGFloat)resolution;
     int idx = (x - parent.visiblePlotMin.x) / inc;
     
-    amp = plotUnits[idx].y;
+    amp = unitsY[idx];
     
     int n = 1;
     if (idx > 0) {
-        amp += plotUnits[idx-1].y;
+        amp += unitsY[idx-1];
         n += 1;
     }
     if (idx < resolution-1) {
-        amp += plotUnits[idx+1].y;
+        amp += unitsY[idx+1];
         n += 1;
     }
     
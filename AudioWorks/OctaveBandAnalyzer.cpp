@@ -0,0 +1,241 @@
+//
+//  OctaveBandAnalyzer.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "OctaveBandAnalyzer.hpp"
+
+OctaveBandAnalyzer::OctaveBandAnalyzer(float fs, int nChannels, int nBandsPerOctave, float minFrequency, float maxFrequency) : sampleRate(fs), numChannels(nChannels), bandsPerOctave(nBandsPerOctave), numLevels(1), fftSize(128), log2FFTSize(7), fftSetup(NULL), normalization(1.0f) {
+
+    if (bandsPerOctave < 1) {
+        printf("%s: Invalid number of bands per octave %d. Using 1.\n", __PRETTY_FUNCTION__, bandsPerOctave);
+        bandsPerOctave = 1;
+    }
+
+    /* Small FFT, just long enough for a couple of bins across the narrowest band in each octave */
+    while (fftSize < 16 * bandsPerOctave) {
+        fftSize *= 2;
+        log2FFTSize++;
+    }
+
+    designBands(minFrequency, maxFrequency);
+    designDecimationFilter();
+
+    /* Per-channel, per-level state */
+    int nStates = numChannels * numLevels;
+    pending.resize(nStates);
+    history.resize(nStates);
+    historyHead.assign(nStates, 0);
+    for (int i = 0; i < nStates; i++) {
+        pending[i].reserve(kOctaveBandDecimationTaps + kOctaveBandMaxBlockLength);
+        pending[i].assign(kOctaveBandDecimationTaps - 1, 0.0f);
+        history[i].assign(fftSize, 0.0f);
+    }
+
+    decimated.resize(numLevels);
+    for (int i = 0; i < numLevels; i++)
+        decimated[i].resize(kOctaveBandMaxBlockLength / 2 + 1);
+
+    bandMagnitudes.resize(numChannels);
+    for (int i = 0; i < numChannels; i++)
+        bandMagnitudes[i].assign(bands.size(), 0.0f);
+
+    /* FFT buffers and Hann window */
+    window.resize(fftSize);
+    windowed.resize(fftSize);
+    power.resize(fftSize/2);
+    realp.resize(fftSize/2);
+    imagp.resize(fftSize/2);
+    vDSP_hann_window(&window[0], fftSize, vDSP_HANN_NORM);
+    fftSetup = vDSP_create_fftsetup(log2FFTSize, FFT_RADIX2);
+
+    /* vDSP_fft_zrip scales by 2, so a sinusoid of amplitude A with all of its energy E in one band gives A^2 = E / (N * sum(w^2)) */
+    float windowEnergy;
+    vDSP_svesq(&window[0], 1, &windowEnergy, fftSize);
+    normalization = 1.0f / (fftSize * windowEnergy);
+}
+
+OctaveBandAnalyzer::~OctaveBandAnalyzer() {
+    if (fftSetup)
+        vDSP_destroy_fftsetup(fftSetup);
+}
+
+#pragma mark - Interface Methods
+void OctaveBandAnalyzer::process(const float * const *input, int length) {
+
+    for (int offset = 0; offset < length; offset += kOctaveBandMaxBlockLength) {
+
+        int n = length - offset;
+        n = n > kOctaveBandMaxBlockLength ? kOctaveBandMaxBlockLength : n;
+
+        for (int channel = 0; channel < numChannels; channel++)
+            pushLevel(channel, 0, input[channel] + offset, n);
+    }
+}
+
+void OctaveBandAnalyzer::computeBands() {
+
+    DSPSplitComplex split;
+    split.realp = &realp[0];
+    split.imagp = &imagp[0];
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        for (int level = 0; level < numLevels; level++) {
+
+            int idx = channel * numLevels + level;
+
+            /* Unroll the ring oldest-first and window it */
+            const float *ring = &history[idx][0];
+            int head = historyHead[idx];
+            memcpy(&windowed[0], ring + head, (fftSize - head) * sizeof(float));
+            memcpy(&windowed[fftSize - head], ring, head * sizeof(float));
+            vDSP_vmul(&windowed[0], 1, &window[0], 1, &windowed[0], 1, fftSize);
+
+            /* Power spectrum */
+            vDSP_ctoz((DSPComplex *)&windowed[0], 2, &split, 1, fftSize/2);
+            vDSP_fft_zrip(fftSetup, &split, 1, log2FFTSize, FFT_FORWARD);
+            split.imagp[0] = 0.0f;      // Nyquist is packed here; we don't use it
+            vDSP_zvmags(&split, 1, &power[0], 1, fftSize/2);
+
+            /* Sparse kernel: each band is a short weighted sum of bins */
+            float energy;
+            for (int b = 0; b < bands.size(); b++) {
+                if (bands[b].level != level)
+                    continue;
+                vDSP_dotpr(&power[bands[b].firstBin], 1, &kernelWeights[bands[b].weightOffset], 1, &energy, bands[b].numBins);
+                bandMagnitudes[channel][b] = sqrtf(energy * normalization);
+            }
+        }
+    }
+}
+
+const float *OctaveBandAnalyzer::getBandMagnitudes(int channel) {
+
+    if (channel < 0 || channel >= numChannels) {
+        printf("%s: Invalid channel index %d. %d channels.\n", __PRETTY_FUNCTION__, channel, numChannels);
+        return NULL;
+    }
+
+    return &bandMagnitudes[channel][0];
+}
+
+#pragma mark - Private Methods
+/* Place bands at 1 kHz * 2^(k/bandsPerOctave) and assign each to the lowest-rate octave level that still passes its upper edge */
+void OctaveBandAnalyzer::designBands(float minFrequency, float maxFrequency) {
+
+    float nyquist = sampleRate / 2.0f;
+    float halfBand = powf(2.0f, 0.5f / bandsPerOctave);
+
+    int kMin = (int)ceilf(bandsPerOctave * log2f(minFrequency / kOctaveBandReferenceFrequency));
+    int kMax = (int)floorf(bandsPerOctave * log2f(maxFrequency / kOctaveBandReferenceFrequency));
+
+    bands.clear();
+    bandCenters.clear();
+    kernelWeights.clear();
+    numLevels = 1;
+
+    for (int k = kMin; k <= kMax; k++) {
+
+        float fc = kOctaveBandReferenceFrequency * powf(2.0f, (float)k / bandsPerOctave);
+        float fl = fc / halfBand;
+        float fu = fc * halfBand;
+        if (fu > nyquist)
+            break;
+
+        /* Level l > 0 is usable up to 3/4 of its Nyquist frequency, above which the decimation filter's transition band starts */
+        int level = 0;
+        while (fu <= 0.75f * sampleRate / powf(2.0f, level + 2))
+            level++;
+
+        float binWidth = sampleRate / powf(2.0f, level) / fftSize;
+        int firstBin = (int)floorf(fl / binWidth + 0.5f);
+        int lastBin = (int)floorf(fu / binWidth + 0.5f);
+        firstBin = firstBin < 0 ? 0 : firstBin;
+        lastBin = lastBin > fftSize/2 - 1 ? fftSize/2 - 1 : lastBin;
+        lastBin = lastBin < firstBin ? firstBin : lastBin;
+
+        Band band;
+        band.level = level;
+        band.firstBin = firstBin;
+        band.numBins = lastBin - firstBin + 1;
+        band.weightOffset = (int)kernelWeights.size();
+
+        /* Each bin is weighted by how much of it overlaps the band */
+        for (int bin = firstBin; bin <= lastBin; bin++) {
+            float lo = fmaxf((bin - 0.5f) * binWidth, fl);
+            float hi = fminf((bin + 0.5f) * binWidth, fu);
+            kernelWeights.push_back(fmaxf(hi - lo, 0.0f) / binWidth);
+        }
+
+        bands.push_back(band);
+        bandCenters.push_back(fc);
+        numLevels = level + 1 > numLevels ? level + 1 : numLevels;
+    }
+
+    if (bands.empty())
+        printf("%s: No bands between %.1f and %.1f Hz at sample rate %.0f\n", __PRETTY_FUNCTION__, minFrequency, maxFrequency, sampleRate);
+}
+
+/* Blackman-windowed sinc lowpass with cutoff at a quarter of the input rate */
+void OctaveBandAnalyzer::designDecimationFilter() {
+
+    int taps = kOctaveBandDecimationTaps;
+    int center = taps / 2;
+    decimationFilter.resize(taps);
+
+    float sum = 0.0f;
+    for (int i = 0; i < taps; i++) {
+        int n = i - center;
+        float sinc = n == 0 ? 0.5f : sinf(M_PI * 0.5f * n) / (M_PI * n);
+        float blackman = 0.42f - 0.5f * cosf(2.0f * M_PI * i / (taps-1)) + 0.08f * cosf(4.0f * M_PI * i / (taps-1));
+        decimationFilter[i] = sinc * blackman;
+        sum += decimationFilter[i];
+    }
+
+    /* Unity gain at DC */
+    for (int i = 0; i < taps; i++)
+        decimationFilter[i] /= sum;
+}
+
+/* Add samples to a level's history and decimate them into the next level */
+void OctaveBandAnalyzer::pushLevel(int channel, int level, const float *input, int length) {
+
+    if (length <= 0)
+        return;
+
+    int idx = channel * numLevels + level;
+
+    /* Only the last fftSize samples matter for the history ring */
+    const float *in = input;
+    int n = length;
+    if (n > fftSize) {
+        in += n - fftSize;
+        n = fftSize;
+    }
+    float *ring = &history[idx][0];
+    int head = historyHead[idx];
+    int first = fftSize - head < n ? fftSize - head : n;
+    memcpy(ring + head, in, first * sizeof(float));
+    memcpy(ring, in + first, (n - first) * sizeof(float));
+    historyHead[idx] = (head + n) % fftSize;
+
+    if (level + 1 >= numLevels)
+        return;
+
+    /* Lowpass and keep every other sample. pending holds the filter's history followed by input we haven't consumed yet. */
+    std::vector<float> &pend = pending[idx];
+    pend.insert(pend.end(), input, input + length);
+
+    int numOut = ((int)pend.size() - (kOctaveBandDecimationTaps - 1)) / 2;
+    if (numOut <= 0)
+        return;
+
+    float *out = &decimated[level+1][0];
+    vDSP_desamp(&pend[0], 2, &decimationFilter[0], out, numOut, kOctaveBandDecimationTaps);
+    pend.erase(pend.begin(), pend.begin() + 2 * numOut);
+
+    pushLevel(channel, level + 1, out, numOut);
+}
@@ -0,0 +1,94 @@
+//
+//  OctaveBandAnalyzer.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef OctaveBandAnalyzer_hpp
+#define OctaveBandAnalyzer_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <Accelerate/Accelerate.h>
+#include <vector>
+
+#define kOctaveBandReferenceFrequency (1000.0f)     // Band centers are 1 kHz * 2^(k/bandsPerOctave)
+#define kOctaveBandDecimationTaps (47)              // Half-band lowpass length for each 2x decimation stage
+#define kOctaveBandMaxBlockLength (4096)            // Longest block process() handles in one pass
+
+/* Fractional-octave (constant-Q) band analyzer for all input channels.
+
+    Input is decimated by two for each octave below the top one, so every octave is analyzed with the same small FFT at its own sample rate. Band energies are summed from the power spectrum of the octave level that holds them using a precomputed sparse kernel (a short run of weighted bins per band). Cost per frame is roughly numLevels small FFTs per channel instead of one FFT long enough to resolve the lowest band. */
+class OctaveBandAnalyzer {
+
+    float sampleRate;
+    int numChannels;
+    int bandsPerOctave;
+    int numLevels;              // Octave levels; level l runs at sampleRate / 2^l
+    int fftSize;
+    int log2FFTSize;
+
+    /* Bands */
+    struct Band {
+        int level;
+        int firstBin;
+        int numBins;
+        int weightOffset;       // Offset into kernelWeights
+    };
+    std::vector<Band> bands;
+    std::vector<float> bandCenters;
+    std::vector<float> kernelWeights;
+
+    /* Decimation filter */
+    std::vector<float> decimationFilter;
+
+    /* Per-channel, per-level state, indexed [channel * numLevels + level] */
+    std::vector<std::vector<float> > pending;       // Filter history plus input not yet decimated
+    std::vector<std::vector<float> > history;       // Ring of the last fftSize samples at this level
+    std::vector<int> historyHead;
+
+    /* Output, one row per channel */
+    std::vector<std::vector<float> > bandMagnitudes;
+
+    /* FFT */
+    FFTSetup fftSetup;
+    std::vector<float> window;
+    std::vector<float> windowed;
+    std::vector<float> power;
+    std::vector<float> realp;
+    std::vector<float> imagp;
+    std::vector<std::vector<float> > decimated;     // Per-level output of the decimator feeding that level
+    float normalization;
+
+#pragma mark - Private Methods
+    void designBands(float minFrequency, float maxFrequency);
+    void designDecimationFilter();
+    void pushLevel(int channel, int level, const float *input, int length);
+
+public:
+
+    /* Constructor/Destructor */
+    OctaveBandAnalyzer(float fs, int nChannels, int nBandsPerOctave = 3, float minFrequency = 20.0f, float maxFrequency = 20000.0f);
+    ~OctaveBandAnalyzer();
+
+    /* Push a block of non-interleaved input, one row per channel */
+    void process(const float * const *input, int length);
+
+    /* Compute band magnitudes for all channels from the most recent input */
+    void computeBands();
+
+    /* Getters */
+    int getNumChannels() { return numChannels; }
+    int getNumBands() { return (int)bands.size(); }
+    int getNumLevels() { return numLevels; }
+    int getFFTSize() { return fftSize; }
+    int getPrimingLength() { return (fftSize + kOctaveBandDecimationTaps) << (numLevels - 1); }    // Input samples behind the lowest octave's first full frame
+    float getSampleRate() { return sampleRate; }
+    const float *getBandCenters() { return &bandCenters[0]; }
+    const float *getBandMagnitudes(int channel);     // Amplitude of a sinusoid with the same energy, per band
+};
+
+#endif /* OctaveBandAnalyzer_hpp */
@@ -0,0 +1,185 @@
+//
+//  ParameterAutomation.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "ParameterAutomation.hpp"
+
+#pragma mark - ParameterAutomation
+ParameterAutomation::ParameterAutomation(int nParameters, float fs) : numParameters(nParameters), sampleRate(fs), head(0), tail(0), numPending(0) {
+
+    parameters = new Parameter[numParameters];
+    for (int i = 0; i < numParameters; i++) {
+        parameters[i].values.resize(kParameterMaxBlockLength);
+        setInitialValue(i, 0.0f);
+    }
+
+    queue = new ParameterChange[kParameterQueueLength];
+    pending = new ParameterChange[kParameterPendingLength];
+}
+
+ParameterAutomation::~ParameterAutomation() {
+    delete [] parameters;
+    delete [] queue;
+    delete [] pending;
+}
+
+#pragma mark - Producer
+bool ParameterAutomation::schedule(int parameter, float value, unsigned long long frame, float rampTime) {
+
+    if (parameter < 0 || parameter >= numParameters) {
+        printf("%s: Invalid parameter %d. %d parameters.\n", __PRETTY_FUNCTION__, parameter, numParameters);
+        return false;
+    }
+
+    unsigned int h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= kParameterQueueLength) {
+        printf("%s: Parameter queue full; dropping change to parameter %d\n", __PRETTY_FUNCTION__, parameter);
+        return false;
+    }
+
+    ParameterChange &change = queue[h & (kParameterQueueLength - 1)];
+    change.parameter = parameter;
+    change.value = value;
+    change.rampTime = rampTime < 0.0f ? 0.0f : rampTime;
+    change.frame = frame;
+    head.store(h + 1, std::memory_order_release);
+
+    parameters[parameter].uiValue = value;
+    return true;
+}
+
+float ParameterAutomation::getTargetValue(int parameter) {
+
+    if (parameter < 0 || parameter >= numParameters)
+        return 0.0f;
+    return parameters[parameter].uiValue;
+}
+
+void ParameterAutomation::setInitialValue(int parameter, float value) {
+
+    if (parameter < 0 || parameter >= numParameters)
+        return;
+
+    Parameter &p = parameters[parameter];
+    p.value = p.target = value;
+    p.increment = 0.0f;
+    p.rampRemaining = 0;
+    p.active = false;
+    p.uiValue = value;
+}
+
+#pragma mark - Consumer
+void ParameterAutomation::process(unsigned long long blockStart, int length) {
+
+    length = length > kParameterMaxBlockLength ? kParameterMaxBlockLength : length;
+
+    /* Only parameters still ramping from the last block need buffers up front */
+    for (int i = 0; i < numParameters; i++)
+        parameters[i].active = parameters[i].rampRemaining > 0;
+
+    drain(blockStart);
+
+    /* Split the block at each change that falls inside it */
+    int position = 0;
+    int applied = 0;
+    while (applied < numPending && pending[applied].frame < blockStart + length) {
+
+        int offset = (int)(pending[applied].frame - blockStart);
+        offset = offset < position ? position : offset;
+
+        render(position, offset);
+        position = offset;
+        apply(pending[applied], offset);
+
+        applied++;
+    }
+
+    if (applied > 0) {
+        numPending -= applied;
+        memmove(pending, pending + applied, numPending * sizeof(ParameterChange));
+    }
+
+    render(position, length);
+}
+
+#pragma mark - Private Methods
+/* Move everything the producer has pushed into the pending buffer. Changes that are already due are stamped with the block start, so they sort ahead of future ones but stay in push order among themselves. If the buffer is full, the rest wait in the ring. */
+void ParameterAutomation::drain(unsigned long long blockStart) {
+
+    unsigned int t = tail.load(std::memory_order_relaxed);
+    unsigned int h = head.load(std::memory_order_acquire);
+
+    while (t != h && numPending < kParameterPendingLength) {
+
+        ParameterChange change = queue[t & (kParameterQueueLength - 1)];
+        if (change.frame < blockStart)
+            change.frame = blockStart;
+
+        int i = numPending;
+        while (i > 0 && pending[i-1].frame > change.frame) {
+            pending[i] = pending[i-1];
+            i--;
+        }
+        pending[i] = change;
+        numPending++;
+
+        t++;
+    }
+    tail.store(t, std::memory_order_release);
+}
+
+/* Per-sample values for [start, end) of every active parameter */
+void ParameterAutomation::render(int start, int end) {
+
+    if (end <= start)
+        return;
+
+    for (int i = 0; i < numParameters; i++) {
+
+        Parameter &p = parameters[i];
+        if (!p.active)
+            continue;
+
+        int n = end - start;
+        float *values = &p.values[start];
+
+        if (p.rampRemaining > 0) {
+
+            int rampLength = n < p.rampRemaining ? n : p.rampRemaining;
+            vDSP_vramp(&p.value, &p.increment, values, 1, rampLength);
+            p.rampRemaining -= rampLength;
+            p.value = p.rampRemaining > 0 ? p.value + rampLength * p.increment : p.target;
+
+            values += rampLength;
+            n -= rampLength;
+        }
+
+        if (n > 0)
+            vDSP_vfill(&p.value, values, 1, n);
+    }
+}
+
+/* Start a change at a sample offset into the block. Everything before the offset has been rendered. */
+void ParameterAutomation::apply(const ParameterChange &change, int offset) {
+
+    Parameter &p = parameters[change.parameter];
+
+    /* Values before the change were constant if the parameter wasn't active yet */
+    if (!p.active && offset > 0)
+        vDSP_vfill(&p.value, &p.values[0], 1, offset);
+    p.active = true;
+
+    p.target = change.value;
+    p.rampRemaining = (int)roundf(change.rampTime * sampleRate);
+
+    if (p.rampRemaining > 0)
+        p.increment = (p.target - p.value) / p.rampRemaining;
+    else {
+        p.value = p.target;
+        p.increment = 0.0f;
+    }
+}
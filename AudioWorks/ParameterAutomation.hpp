@@ -0,0 +1,94 @@
+//
+//  ParameterAutomation.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef ParameterAutomation_hpp
+#define ParameterAutomation_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <Accelerate/Accelerate.h>
+#include <vector>
+#include <atomic>
+
+#define kParameterQueueLength (256)         // Changes in flight from the producer; must be a power of two
+#define kParameterPendingLength (256)       // Changes drained from the queue but not yet due
+#define kParameterMaxBlockLength (8192)     // Longest block process() renders ramps for
+#define kParameterDefaultRampTime (0.01f)   // Seconds
+#define kParameterImmediate (0ULL)          // Frame for changes that should start at the next block
+
+/* A timestamped parameter change */
+struct ParameterChange {
+    int parameter;
+    float value;
+    float rampTime;                 // Seconds to get from the current value to this one (0 jumps)
+    unsigned long long frame;       // Absolute stream frame where the ramp starts
+};
+
+/* Sample-accurate, lock-free automation for a fixed set of float parameters.
+
+    One thread (the UI) pushes timestamped changes into a single-producer/single-consumer ring. At the start of each block, process() empties the ring into a small buffer kept sorted by frame, so a change scheduled in the future waits there without holding back the ones pushed after it. kParameterImmediate changes (and any whose frame has already passed) take effect at the start of the next block, in the order they were pushed. A change takes effect at its frame, so a block is split into sub-blocks at every change that lands inside it, and each parameter moves to its new value along a linear ramp rendered with vDSP_vramp.
+
+    A parameter that isn't ramping costs one flag check per block: getBlockValues() returns NULL and the caller applies getValue() as a scalar. Only parameters that moved during the block get a per-sample buffer. */
+class ParameterAutomation {
+
+    struct Parameter {
+        float value;                // Current value (at the end of the last rendered sample)
+        float target;
+        float increment;            // Per sample while ramping
+        int rampRemaining;          // Samples left in the ramp
+        bool active;                // values holds this block's per-sample values
+        std::vector<float> values;
+        std::atomic<float> uiValue; // Last value pushed, for the producer's getters
+    };
+
+    int numParameters;
+    float sampleRate;
+    Parameter *parameters;
+
+    /* SPSC ring */
+    ParameterChange *queue;
+    std::atomic<unsigned int> head;     // Written by the producer
+    std::atomic<unsigned int> tail;     // Written by the consumer
+
+    /* Consumer only: drained changes not yet due, sorted by frame (ties in the order they were pushed) */
+    ParameterChange *pending;
+    int numPending;
+
+#pragma mark - Private Methods
+    void drain(unsigned long long blockStart);
+    void render(int start, int end);
+    void apply(const ParameterChange &change, int offset);
+
+public:
+
+    /* Constructor/Destructor */
+    ParameterAutomation(int nParameters, float fs);
+    ~ParameterAutomation();
+
+    /* Producer (one thread). Returns false if the queue is full or the parameter is invalid. */
+    bool schedule(int parameter, float value, unsigned long long frame = kParameterImmediate, float rampTime = kParameterDefaultRampTime);
+    float getTargetValue(int parameter);    // The last value scheduled
+
+    /* Setup, with the consumer stopped. Sets a parameter's value without a ramp. */
+    void setInitialValue(int parameter, float value);
+    void setSampleRate(float fs) { sampleRate = fs; }
+
+    /* Consumer (audio thread). Apply every change due in [blockStart, blockStart + length) and render ramps for the block. */
+    void process(unsigned long long blockStart, int length);
+
+    /* Consumer, after process(): per-sample values for the block, or NULL if the parameter held getValue() throughout */
+    const float *getBlockValues(int parameter) { return parameters[parameter].active ? &parameters[parameter].values[0] : NULL; }
+    float getValue(int parameter) { return parameters[parameter].value; }
+
+    /* Getters */
+    int getNumParameters() { return numParameters; }
+    float getSampleRate() { return sampleRate; }
+};
+
+#endif /* ParameterAutomation_hpp */
@@ -0,0 +1,201 @@
+//
+//  PlotGeometry.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "PlotGeometry.hpp"
+
+PlotGeometry::PlotGeometry() : xMin(0.0f), xMax(1.0f), yMin(0.0f), yMax(1.0f), width(1.0f), height(1.0f), logY(false), xScale(1.0f), xOffset(0.0f), yScale(1.0f), yOffset(0.0f), numPoints(0) {}
+
+bool PlotGeometry::setTransform(float pXMin, float pXMax, float pYMin, float pYMax, float pWidth, float pHeight, bool pLogY) {
+
+    if (pXMin == xMin && pXMax == xMax && pYMin == yMin && pYMax == yMax &&
+        pWidth == width && pHeight == height && pLogY == logY)
+        return false;
+
+    if (pXMin >= pXMax || pYMin >= pYMax) {
+        printf("%s: Invalid limits x = [%f, %f], y = [%f, %f]\n", __PRETTY_FUNCTION__, pXMin, pXMax, pYMin, pYMax);
+        return false;
+    }
+
+    xMin = pXMin;
+    xMax = pXMax;
+    yMin = pYMin;
+    yMax = pYMax;
+    width = pWidth;
+    height = pHeight;
+    logY = pLogY;
+
+    /* Same mapping as -[METScopeView plotScaleToPixel:], folded into a scale and offset */
+    xScale = width / (xMax - xMin);
+    xOffset = -xMin * xScale;
+    yScale = height / (yMax - yMin);
+    yOffset = -yMin * yScale;
+
+    return true;
+}
+
+void PlotGeometry::transform(const float *x, const float *y, int n) {
+
+    if ((int)pixelX.size() < n) {
+        pixelX.resize(n);
+        pixelY.resize(n);
+    }
+    numPoints = n;
+
+    if (n == 0)
+        return;
+
+    vDSP_vsmsa(x, 1, &xScale, &xOffset, &pixelX[0], 1, n);
+    transformY(y, &pixelY[0], n);
+}
+
+void PlotGeometry::scroll(int shift, const float *newY) {
+
+    if (shift <= 0)
+        return;
+
+    if (shift >= numPoints) {
+        printf("%s: Invalid shift %d for %d points\n", __PRETTY_FUNCTION__, shift, numPoints);
+        return;
+    }
+
+    int kept = numPoints - shift;
+    memmove(&pixelY[0], &pixelY[shift], kept * sizeof(float));
+    transformY(newY, &pixelY[kept], shift);
+}
+
+#pragma mark - Polyline Reduction
+int PlotGeometry::reduceLine() {
+
+    vertices.clear();
+
+    /* Vertices of the current pixel column, with their point indices so we can emit them in order */
+    PlotVertex first, last, lo, hi;
+    int firstIdx = 0, lastIdx = 0, loIdx = 0, hiIdx = 0;
+    int column = 0;
+    bool haveColumn = false;
+
+    for (int i = 0; i <= numPoints; i++) {
+
+        PlotVertex v;
+        int c = 0;
+        bool valid = false;
+
+        if (i < numPoints) {
+
+            v.x = pixelX[i];
+            v.y = pixelY[i];
+
+            /* Cull NaNs/Infs and anything more than a pixel outside the view horizontally */
+            valid = isfinite(v.x) && isfinite(v.y) && v.x >= -1.0f && v.x <= width + 1.0f;
+            if (!valid)
+                continue;
+
+            /* Clip vertical excursions to the view */
+            v.y = v.y < -1.0f ? -1.0f : v.y;
+            v.y = v.y > height + 1.0f ? height + 1.0f : v.y;
+            c = (int)floorf(v.x);
+
+            if (haveColumn && c == column) {
+                last = v;
+                lastIdx = i;
+                if (v.y < lo.y) { lo = v; loIdx = i; }
+                if (v.y > hi.y) { hi = v; hiIdx = i; }
+                continue;
+            }
+        }
+
+        /* New column (or end of data): flush the previous column's vertices in point order */
+        if (haveColumn) {
+
+            vertices.push_back(first);
+
+            int midIdx[2] = { loIdx < hiIdx ? loIdx : hiIdx, loIdx < hiIdx ? hiIdx : loIdx };
+            PlotVertex mid[2] = { loIdx < hiIdx ? lo : hi, loIdx < hiIdx ? hi : lo };
+            int prevIdx = firstIdx;
+            for (int k = 0; k < 2; k++) {
+                if (midIdx[k] != prevIdx && midIdx[k] != lastIdx) {
+                    vertices.push_back(mid[k]);
+                    prevIdx = midIdx[k];
+                }
+            }
+
+            if (lastIdx != firstIdx)
+                vertices.push_back(last);
+        }
+
+        if (i < numPoints) {
+            first = last = lo = hi = v;
+            firstIdx = lastIdx = loIdx = hiIdx = i;
+            column = c;
+            haveColumn = true;
+        }
+    }
+
+    return (int)vertices.size();
+}
+
+int PlotGeometry::reduceColumns(float originY) {
+
+    vertices.clear();
+
+    PlotVertex peak;
+    float peakDist = 0.0f;
+    int column = 0;
+    bool haveColumn = false;
+
+    for (int i = 0; i < numPoints; i++) {
+
+        PlotVertex v;
+        v.x = pixelX[i];
+        v.y = pixelY[i];
+
+        if (!isfinite(v.x) || !isfinite(v.y) || v.x < -1.0f || v.x > width + 1.0f)
+            continue;
+
+        v.y = v.y < -1.0f ? -1.0f : v.y;
+        v.y = v.y > height + 1.0f ? height + 1.0f : v.y;
+
+        int c = (int)floorf(v.x);
+        float dist = fabsf(v.y - originY);
+
+        if (haveColumn && c == column) {
+            if (dist > peakDist) {
+                peak = v;
+                peakDist = dist;
+            }
+            continue;
+        }
+
+        if (haveColumn)
+            vertices.push_back(peak);
+
+        peak = v;
+        peakDist = dist;
+        column = c;
+        haveColumn = true;
+    }
+
+    if (haveColumn)
+        vertices.push_back(peak);
+
+    return (int)vertices.size();
+}
+
+#pragma mark - Private Methods
+void PlotGeometry::transformY(const float *y, float *py, int n) {
+
+    /* Semilog: convert magnitudes to dB first, as in -[METScopeView plotScaleToPixelVertical:] */
+    if (logY) {
+        float epsilon = 10e-16f, reference = 1.0f;
+        vDSP_vsadd(y, 1, &epsilon, py, 1, n);
+        vDSP_vdbcon(py, 1, &reference, py, 1, n, 1);
+        vDSP_vsmsa(py, 1, &yScale, &yOffset, py, 1, n);
+    }
+    else
+        vDSP_vsmsa(y, 1, &yScale, &yOffset, py, 1, n);
+}
@@ -0,0 +1,99 @@
+//
+//  PlotGeometry.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef PlotGeometry_hpp
+#define PlotGeometry_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#ifdef __APPLE__
+#include <Accelerate/Accelerate.h>
+#else
+/* The few vDSP routines PlotGeometry uses, for building the offline renderer where Accelerate isn't available */
+typedef unsigned long vDSP_Length;
+typedef long vDSP_Stride;
+
+/* D = A * B + C */
+static inline void vDSP_vsmsa(const float *A, vDSP_Stride IA, const float *B, const float *C, float *D, vDSP_Stride ID, vDSP_Length N) {
+    for (vDSP_Length i = 0; i < N; i++)
+        D[i * ID] = A[i * IA] * *B + *C;
+}
+
+/* C = A + B */
+static inline void vDSP_vsadd(const float *A, vDSP_Stride IA, const float *B, float *C, vDSP_Stride IC, vDSP_Length N) {
+    for (vDSP_Length i = 0; i < N; i++)
+        C[i * IC] = A[i * IA] + *B;
+}
+
+/* C = alpha * log10(A / B), with alpha = 20 (amplitude) if F is 1, 10 (power) if 0 */
+static inline void vDSP_vdbcon(const float *A, vDSP_Stride IA, const float *B, float *C, vDSP_Stride IC, vDSP_Length N, unsigned int F) {
+    float alpha = F ? 20.0f : 10.0f;
+    for (vDSP_Length i = 0; i < N; i++)
+        C[i * IC] = alpha * log10f(A[i * IA] / *B);
+}
+#endif
+
+struct PlotVertex {
+    float x;
+    float y;
+};
+
+/* Converts plot data in plot units to pixels and reduces it to a polyline with at most a few vertices per pixel column, so drawing cost depends on the view width rather than the number of points.
+
+    Points are kept as separate x and y arrays so the plot unit -> pixel transform is a single vDSP pass per axis. */
+class PlotGeometry {
+
+    /* Plot unit -> pixel transform: px = x * xScale + xOffset */
+    float xMin, xMax, yMin, yMax;
+    float width, height;
+    bool logY;
+    float xScale, xOffset;
+    float yScale, yOffset;
+
+    /* Transformed points */
+    int numPoints;
+    std::vector<float> pixelX;
+    std::vector<float> pixelY;
+
+    /* Reduced polyline */
+    std::vector<PlotVertex> vertices;
+
+#pragma mark - Private Methods
+    void transformY(const float *y, float *py, int n);
+
+public:
+
+    PlotGeometry();
+
+    /* Set the visible plot limits and view size. Returns true if the transform changed. */
+    bool setTransform(float xMin, float xMax, float yMin, float yMax, float width, float height, bool logY);
+
+    /* Transform n points from plot units to pixels */
+    void transform(const float *x, const float *y, int n);
+
+    /* Drop the first `shift` points, keep the remaining points' x positions, and transform `shift` new y values in at the end */
+    void scroll(int shift, const float *newY);
+
+    /* Reduce the transformed points to a connected polyline. Non-finite points are culled, points outside the view horizontally are dropped and vertical excursions are clipped to the view. Each pixel column keeps its first, minimum, maximum and last points, so the drawn outline matches the full-resolution line. */
+    int reduceLine();
+
+    /* Reduce the transformed points to one vertex per pixel column, keeping the point farthest from originY (for symmetric envelope fills) */
+    int reduceColumns(float originY);
+
+    /* Getters */
+    int getNumPoints() { return numPoints; }
+    const float *getPixelX() { return numPoints ? &pixelX[0] : NULL; }
+    const float *getPixelY() { return numPoints ? &pixelY[0] : NULL; }
+    int getNumVertices() { return (int)vertices.size(); }
+    const PlotVertex *getVertices() { return vertices.empty() ? NULL : &vertices[0]; }
+};
+
+#endif /* PlotGeometry_hpp */
@@ -14,6 +14,7 @@
 #define kDefaultAudioInputNumChannels @"2"
 #define kDefaultAudioOutputDeviceName @"Built-in Output"
 #define kDefaultAudioOutputNumChannels @"2"
+#define kDeviceCapabilityPollInterval (0.5)     // Seconds between checks for new device capabilities
 
 @interface PreferencesViewController : NSViewController {
     
@@ -24,6 +25,10 @@
     NSMenuItem *previousAudioOutputDevice;
     IBOutlet NSPopUpButton *audioOutputNumChannelsSelector;
     IBOutlet NSPopUpButton *audioSampleRateSelector;
+    
+    /* Repopulate the sample rate list when background probing updates the device capabilities */
+    NSTimer *capabilityClock;
+    unsigned long capabilityGeneration;
 }
 
 @property AudioController *audioController;
@@ -34,6 +39,8 @@
 - (IBAction)audioOutputNumChannelsSelected:(id)sender;
 - (IBAction)audioSampleRateSelected:(id)sender;
 - (IBAction)applyButtonPressed:(id)sender;
+- (IBAction)latencyTuningToggled:(NSButton *)sender;
+- (IBAction)longHistoryToggled:(NSButton *)sender;
 
 
 @end
@@ -22,11 +22,35 @@
 }
 
 - (void)viewDidAppear {
+    
     [super viewDidAppear];
+    
+    /* Capabilities may have changed while we were hidden */
+    [self checkDeviceCapabilities];
+    capabilityClock = [NSTimer scheduledTimerWithTimeInterval:kDeviceCapabilityPollInterval
+                                                       target:self
+                                                     selector:@selector(checkDeviceCapabilities)
+                                                     userInfo:nil
+                                                      repeats:YES];
 }
 
 - (void)viewDidDisappear {
+    
     [super viewDidDisappear];
+    
+    [capabilityClock invalidate];
+    capabilityClock = nil;
+}
+
+/* The capability cache re-probes devices in the background; refresh the sample rates it reports when it finds something new */
+- (void)checkDeviceCapabilities {
+    
+    unsigned long generation = audioController->getDeviceCapabilityGeneration();
+    if (generation == capabilityGeneration)
+        return;
+    
+    capabilityGeneration = generation;
+    [self populateAudioSampleRateSelector:true];
 }
 
 - (void)audioSetup {
@@ -40,6 +64,7 @@
     previousAudioOutputDevice = [audioOutputDeviceSelector selectedItem];
     
     /* Generate list for number of i/o channels and supported sample rates */
+    capabilityGeneration = audioController->getDeviceCapabilityGeneration();
     [self populateAudioInputNumChannelsSelector:false];
     [audioInputNumChannelsSelector selectItemWithTitle:kDefaultAudioInputNumChannels];
     [self populateAudioOutputNumChannelsSelector:false];
@@ -214,7 +239,12 @@
     
     /* Audio input device */
     idx = (PaDeviceIndex)[audioInputDeviceSelector selectedTag];
-    audioController->setInputDevice(idx);
+    if (!audioController->setInputDevice(idx)) {
+        NSAlert *alert = [[NSAlert alloc] init];
+        [alert setMessageText:[NSString stringWithFormat:@"Couldn't use %@ for input", [audioInputDeviceSelector titleOfSelectedItem]]];
+        [alert setInformativeText:@"If it's an aggregate input, remove the aggregate inputs from the Audio menu first."];
+        [alert runModal];
+    }
     
     num = [[audioInputNumChannelsSelector titleOfSelectedItem] intValue];
     audioController->setNumInputChannels(num);
@@ -234,6 +264,31 @@
     if (streamWasActive) audioController->startStream();
 }
 
+/* Low-latency mode with automatic buffer length tuning, or the defaults */
+- (IBAction)latencyTuningToggled:(NSButton *)sender {
+    
+    bool enable = [sender state] == NSOnState;
+    
+    /* The devices wouldn't take the new latency; the controller has gone back to the old one, so the checkbox should too */
+    if (!audioController->setLowLatencyMode(enable)) {
+        [sender setState:enable ? NSOffState : NSOnState];
+        NSAlert *alert = [[NSAlert alloc] init];
+        [alert setMessageText:[NSString stringWithFormat:@"Couldn't %@ low-latency mode", enable ? @"enable" : @"disable"]];
+        [alert setInformativeText:@"The audio devices didn't accept the new stream latency."];
+        [alert runModal];
+        return;
+    }
+    
+    audioController->setLatencyTuningEnabled(enable);
+    if (!enable)
+        audioController->setAudioBufferLength(kDefaultAudioBufferLength);
+}
+
+/* An hour of compressed history behind the recording buffers, capped at kHistoryDefaultMaxBytes */
+- (IBAction)longHistoryToggled:(NSButton *)sender {
+    audioController->setHistoryEnabled([sender state] == NSOnState);
+}
+
 @end
 
 
@@ -0,0 +1,450 @@
+//
+//  ScopeFrameProducer.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "ScopeFrameProducer.hpp"
+
+ScopeFrameProducer::ScopeFrameProducer(AudioController *ac, int numWorkers) : audioController(ac), windowMin(0.0f), windowMax(0.0f), resolution(0), front(0), frameReady(false), scrolling(false), scrollSamplesPerColumn(0), scrollColumns(0), scrollChannels(0), scrollColumnEnd(0), scrollWindowMin(0.0f), scrollWindowMax(0.0f), scrollGeneration(0), endFrame(kScopeFrameLive), reviewEndFrame(kScopeFrameLive), reviewWindowMin(0.0f), reviewWindowMax(0.0f), reviewResolution(0), reviewChannels(0), jobFrame(NULL), jobLength(0), jobStartFrame(0), jobStartColumn(0), jobNumColumns(0), jobSamplesPerColumn(0), jobFromHistory(false), nextChannel(0), jobGeneration(0), pendingWorkers(0), workersRunning(true), producerRunning(false), updateInterval(0.0f) {
+
+    /* Default to one worker per spare core. The producer thread also renders channels, so zero workers is valid. */
+    if (numWorkers < 0) {
+        numWorkers = (int)std::thread::hardware_concurrency() - 1;
+        numWorkers = numWorkers < 0 ? 0 : numWorkers;
+    }
+    numWorkers = numWorkers > kScopeFrameMaxWorkers ? kScopeFrameMaxWorkers : numWorkers;
+
+    for (int i = 0; i < numWorkers; i++)
+        workers.push_back(std::thread(&ScopeFrameProducer::workerLoop, this));
+}
+
+ScopeFrameProducer::~ScopeFrameProducer() {
+
+    stop();
+
+    /* Shut down the worker pool */
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        workersRunning = false;
+    }
+    poolCondition.notify_all();
+    for (int i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+#pragma mark - Interface Methods
+bool ScopeFrameProducer::start(float interval) {
+
+    if (interval <= 0.0f) {
+        printf("%s: Invalid update interval %f\n", __PRETTY_FUNCTION__, interval);
+        return false;
+    }
+
+    stop();
+
+    updateInterval = interval;
+    producerRunning = true;
+    producerThread = std::thread(&ScopeFrameProducer::producerLoop, this);
+
+    return true;
+}
+
+void ScopeFrameProducer::stop() {
+
+    if (!producerRunning)
+        return;
+
+    producerRunning = false;
+    producerThread.join();
+}
+
+void ScopeFrameProducer::setVisibleWindow(float tMin, float tMax, int res) {
+
+    if (tMin >= tMax || res < 2) {
+        printf("%s: Invalid window [%f, %f] with resolution %d\n", __PRETTY_FUNCTION__, tMin, tMax, res);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(windowMutex);
+    windowMin = tMin;
+    windowMax = tMax;
+    resolution = res;
+}
+
+const ScopeFrame *ScopeFrameProducer::lockLatestFrame() {
+
+    frameMutex.lock();
+
+    if (!frameReady) {
+        frameMutex.unlock();
+        return NULL;
+    }
+
+    frameReady = false;
+    return &frames[front];
+}
+
+void ScopeFrameProducer::unlockLatestFrame() {
+    frameMutex.unlock();
+}
+
+#pragma mark - Producer Thread
+void ScopeFrameProducer::producerLoop() {
+
+    std::chrono::duration<float> interval(updateInterval);
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+
+    while (producerRunning) {
+
+        produceFrame();
+
+        /* Sleep until the next tick. If we've fallen behind, start counting from now rather than trying to catch up. */
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (next < now)
+            next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void ScopeFrameProducer::produceFrame() {
+
+    float tMin, tMax;
+    int res;
+    {
+        std::lock_guard<std::mutex> lock(windowMutex);
+        tMin = windowMin;
+        tMax = windowMax;
+        res = resolution;
+    }
+
+    if (res < 2)
+        return;
+
+    int nChannels = audioController->getNumInputChannels();
+    float sampleRate = audioController->getSampleRate();
+    if (nChannels <= 0)
+        return;
+
+    /* Visible samples, as in the time-domain scope */
+    int startIdx = fmax(tMin * sampleRate, 0.0f);
+    int endIdx = fmin(tMax * sampleRate, audioController->getRecordingBufferLength());
+    int visibleLength = endIdx - startIdx;
+    if (visibleLength < 2)
+        return;
+
+    /* The back buffer is never touched by the UI, so we can fill it without holding frameMutex */
+    ScopeFrame *frame = &frames[1-front];
+
+    /* Panning or zooming moves every column, so the scroll ring has to be rebuilt */
+    if (tMin != scrollWindowMin || tMax != scrollWindowMax) {
+        scrollWindowMin = tMin;
+        scrollWindowMax = tMax;
+        scrollColumns = 0;
+    }
+
+    /* A window in the past (never later than the newest frame, which moves back if the recording buffers were reallocated) */
+    long long end = endFrame;
+    long long recorded = (long long)audioController->getNumRecordedFrames();
+    end = end > recorded ? recorded : end;
+    /* Back from reviewing: the plots show the old window, so the next scrolling frame has to be a full one even if nothing new was recorded */
+    if (end == kScopeFrameLive && reviewEndFrame != kScopeFrameLive) {
+        reviewEndFrame = kScopeFrameLive;
+        scrollColumns = 0;
+    }
+    
+    bool ready;
+    if (end != kScopeFrameLive)
+        ready = prepareReview(frame, nChannels, visibleLength, res, tMin, tMax, end);
+    else if (scrolling)
+        ready = prepareScroll(frame, nChannels, visibleLength, res);
+    else
+        ready = prepareSnapshot(frame, nChannels, visibleLength, res);
+    if (!ready)
+        return;
+
+    /* Shared x data. Scrolling columns are a whole number of samples apart, ending at tMax; the oldest may fall just left of the window. */
+    int columns = frame->length;
+    if (frame->scrolling) {
+        float step = jobSamplesPerColumn / sampleRate;
+        for (int i = 0; i < columns; i++)
+            frame->x[i] = tMax - (columns-1-i) * step;
+    }
+    else {
+        float xMin = fmax(tMin, 0.0f);
+        float step = (tMax - xMin) / (columns-1);
+        for (int i = 0; i < columns; i++)
+            frame->x[i] = xMin + i * step;
+        frame->x[columns-1] = tMax;
+    }
+
+    /* Hand the channels out to the pool and render our share on this thread */
+    jobFrame = frame;
+    nextChannel = 0;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        pendingWorkers = (int)workers.size();
+        jobGeneration++;
+    }
+    poolCondition.notify_all();
+
+    processChannels();
+
+    {
+        std::unique_lock<std::mutex> lock(poolMutex);
+        while (pendingWorkers > 0)
+            doneCondition.wait(lock);
+    }
+
+    if (frame->scrolling)
+        scrollColumnEnd = frame->columnEnd;
+
+    /* Publish */
+    std::lock_guard<std::mutex> lock(frameMutex);
+    frame->sequence = frames[front].sequence + 1;
+    front = 1-front;
+    frameReady = true;
+}
+
+/* Set up a job that decimates the whole visible window */
+bool ScopeFrameProducer::prepareSnapshot(ScopeFrame *frame, int nChannels, int visibleLength, int res) {
+
+    int columns = visibleLength < res ? visibleLength : res;
+    resizeFrame(frame, nChannels, columns);
+    frame->envelope = (visibleLength / columns) > kScopeFrameEnvelopeThreshold;
+    frame->scrolling = false;
+
+    /* Make sure we have enough history scratch space for each channel */
+    if (history.size() < nChannels)
+        history.resize(nChannels);
+    for (int i = 0; i < nChannels; i++) {
+        if (history[i].size() < visibleLength)
+            history[i].resize(visibleLength);
+    }
+
+    jobLength = visibleLength;
+    jobStartFrame = (long long)audioController->getNumRecordedFrames() - visibleLength;
+    jobFromHistory = false;
+
+    return true;
+}
+
+/* Set up a snapshot job for the window ending at end, or return false if it's the window we last produced */
+bool ScopeFrameProducer::prepareReview(ScopeFrame *frame, int nChannels, int visibleLength, int res, float tMin, float tMax, long long end) {
+
+    if (end == reviewEndFrame && tMin == reviewWindowMin && tMax == reviewWindowMax && res == reviewResolution && nChannels == reviewChannels)
+        return false;
+
+    reviewEndFrame = end;
+    reviewWindowMin = tMin;
+    reviewWindowMax = tMax;
+    reviewResolution = res;
+    reviewChannels = nChannels;
+
+    prepareSnapshot(frame, nChannels, visibleLength, res);
+    jobStartFrame = end - visibleLength;
+    jobFromHistory = true;
+
+    return true;
+}
+
+/* Set up a job that decimates only the columns recorded since the last frame, or rebuilds every column if the window, resolution or channel count changed or we've fallen more than a full window behind */
+bool ScopeFrameProducer::prepareScroll(ScopeFrame *frame, int nChannels, int visibleLength, int res) {
+
+    /* Whole samples per column, so columns stay aligned to absolute sample positions. We always emit res columns (the plots' resolution, so they can scroll in place), which may reach a little past the visible window. */
+    int samplesPerColumn = (visibleLength + res - 1) / res;
+    int columns = res;
+
+    long long columnEnd = (long long)(audioController->getNumRecordedFrames() / samplesPerColumn);
+
+    bool rebuild = samplesPerColumn != scrollSamplesPerColumn ||
+                   columns != scrollColumns ||
+                   nChannels != scrollChannels ||
+                   columnEnd < scrollColumnEnd ||
+                   columnEnd - scrollColumnEnd >= columns;
+
+    long long startColumn;
+    if (rebuild) {
+
+        scrollSamplesPerColumn = samplesPerColumn;
+        scrollColumns = columns;
+        scrollChannels = nChannels;
+        scrollGeneration++;
+
+        if (columnRing.size() < nChannels)
+            columnRing.resize(nChannels);
+        for (int i = 0; i < nChannels; i++)
+            columnRing[i].assign(columns, 0.0f);
+
+        startColumn = columnEnd - columns;      // Negative until we've recorded a full window
+    }
+    else {
+
+        /* Nothing new to show */
+        if (columnEnd == scrollColumnEnd)
+            return false;
+
+        startColumn = scrollColumnEnd;
+    }
+
+    resizeFrame(frame, nChannels, columns);
+    frame->envelope = samplesPerColumn > kScopeFrameEnvelopeThreshold;
+    frame->scrolling = true;
+    frame->generation = scrollGeneration;
+    frame->columnEnd = columnEnd;
+
+    jobStartColumn = startColumn;
+    jobNumColumns = (int)(columnEnd - startColumn);
+    jobSamplesPerColumn = samplesPerColumn;
+    jobLength = jobNumColumns * samplesPerColumn;
+    jobFromHistory = false;
+
+    /* History scratch space only needs to hold the new samples */
+    if (history.size() < nChannels)
+        history.resize(nChannels);
+    for (int i = 0; i < nChannels; i++) {
+        if (history[i].size() < jobLength)
+            history[i].resize(jobLength);
+    }
+
+    return true;
+}
+
+void ScopeFrameProducer::resizeFrame(ScopeFrame *frame, int nChannels, int length) {
+
+    /* Only allocates when the channel count or resolution grows */
+    frame->numChannels = nChannels;
+    frame->length = length;
+    if (frame->x.size() < length)
+        frame->x.resize(length);
+    if (frame->y.size() < nChannels)
+        frame->y.resize(nChannels);
+    for (int i = 0; i < nChannels; i++) {
+        if (frame->y[i].size() < length)
+            frame->y[i].resize(length);
+    }
+}
+
+#pragma mark - Worker Pool
+void ScopeFrameProducer::workerLoop() {
+
+    unsigned long lastGeneration = 0;
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    while (true) {
+
+        while (workersRunning && jobGeneration == lastGeneration)
+            poolCondition.wait(lock);
+
+        if (!workersRunning)
+            return;
+
+        lastGeneration = jobGeneration;
+
+        lock.unlock();
+        processChannels();
+        lock.lock();
+
+        if (--pendingWorkers == 0)
+            doneCondition.notify_one();
+    }
+}
+
+/* Render channels until there are none left in the current job */
+void ScopeFrameProducer::processChannels() {
+
+    int channel;
+    while ((channel = nextChannel++) < jobFrame->numChannels) {
+        if (jobFrame->scrolling)
+            renderScrollingChannel(channel);
+        else
+            renderChannel(channel);
+    }
+}
+
+/* Copy a channel's visible history and decimate it to the frame's column count */
+void ScopeFrameProducer::renderChannel(int channel) {
+
+    SAMPLE *samples = &history[channel][0];
+    float *y = &jobFrame->y[channel][0];
+    int columns = jobFrame->length;
+
+    if (jobFromHistory)
+        audioController->getHistoryFrom(samples, channel, jobStartFrame, jobLength);
+    else
+        audioController->getRecordingBufferFrom(samples, channel, jobStartFrame, jobLength);
+
+    /* One sample per column */
+    if (jobLength == columns) {
+        for (int i = 0; i < columns; i++)
+            y[i] = samples[i];
+    }
+
+    /* Too many samples per column to resample without aliasing, so take the maximum amplitude in each column's window */
+    else if (jobFrame->envelope) {
+
+        int samplesPerColumn = jobLength / columns;
+        float maxInWindow;
+        for (int i = 0; i < columns-1; i++) {
+            const SAMPLE *window = samples + i * samplesPerColumn;
+            maxInWindow = 0.0f;
+            for (int j = 0; j < samplesPerColumn; j++) {
+                float mag = fabsf(window[j]);
+                maxInWindow = mag > maxInWindow ? mag : maxInWindow;
+            }
+            y[i] = maxInWindow;
+        }
+        y[columns-1] = y[columns-2];
+    }
+
+    /* Otherwise sample the waveform at evenly spaced indices */
+    else {
+        float step = (float)(jobLength-1) / (columns-1);
+        for (int i = 0; i < columns; i++)
+            y[i] = samples[(int)(i * step)];
+    }
+}
+
+/* Decimate a channel's newly recorded samples into its column ring, then unroll the ring into the frame oldest-first */
+void ScopeFrameProducer::renderScrollingChannel(int channel) {
+
+    SAMPLE *samples = &history[channel][0];
+    float *ring = &columnRing[channel][0];
+    float *y = &jobFrame->y[channel][0];
+    int columns = jobFrame->length;
+    int samplesPerColumn = jobSamplesPerColumn;
+
+    audioController->getRecordingBufferFrom(samples, channel, jobStartColumn * samplesPerColumn, jobLength);
+
+    /* Ring index of the first new column (startColumn may be negative while the history is filling) */
+    int ringIdx = (int)(((jobStartColumn % columns) + columns) % columns);
+
+    for (int k = 0; k < jobNumColumns; k++) {
+
+        const SAMPLE *window = samples + k * samplesPerColumn;
+
+        if (jobFrame->envelope) {
+            float maxInWindow = 0.0f;
+            for (int j = 0; j < samplesPerColumn; j++) {
+                float mag = fabsf(window[j]);
+                maxInWindow = mag > maxInWindow ? mag : maxInWindow;
+            }
+            ring[ringIdx] = maxInWindow;
+        }
+        else
+            ring[ringIdx] = window[0];
+
+        if (++ringIdx == columns)
+            ringIdx = 0;
+    }
+
+    /* After writing the newest column, ringIdx points at the oldest */
+    for (int i = 0; i < columns; i++) {
+        y[i] = ring[ringIdx];
+        if (++ringIdx == columns)
+            ringIdx = 0;
+    }
+}
@@ -0,0 +1,145 @@
+//
+//  ScopeFrameProducer.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef ScopeFrameProducer_hpp
+#define ScopeFrameProducer_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "AudioController.hpp"
+
+#define kScopeFrameMaxWorkers (4)
+#define kScopeFrameEnvelopeThreshold (12)   // Samples per column above which we plot the max-abs envelope
+#define kScopeFrameLive (-1)                // End frame that follows the newest recorded frame
+
+/* Plot-ready data for all input channels. The x data is shared by every channel; y holds one row per channel. */
+struct ScopeFrame {
+    int numChannels;
+    int length;
+    bool envelope;              // y rows hold max-abs envelope columns (plot symmetrically)
+    unsigned long sequence;
+    std::vector<float> x;
+    std::vector<std::vector<float> > y;
+
+    /* Scrolling mode: columns are aligned to absolute sample positions, so consecutive frames with the same generation differ only by (columnEnd - previous columnEnd) columns shifted in on the right */
+    bool scrolling;
+    unsigned long generation;
+    long long columnEnd;
+
+    ScopeFrame() : numChannels(0), length(0), envelope(false), sequence(0), scrolling(false), generation(0), columnEnd(0) {}
+};
+
+class ScopeFrameProducer {
+
+    AudioController *audioController;
+
+    /* Visible window requested by the UI */
+    std::mutex windowMutex;
+    float windowMin;
+    float windowMax;
+    int resolution;
+
+    /* Double-buffered frames. The producer fills frames[1-front] and publishes it by flipping front under frameMutex; the UI only reads frames[front] while holding frameMutex. */
+    ScopeFrame frames[2];
+    int front;
+    bool frameReady;
+    std::mutex frameMutex;
+
+    /* Per-channel scratch buffers for copying recording history */
+    std::vector<std::vector<SAMPLE> > history;
+
+    /* Scrolling mode state. Each channel keeps a ring of decimated columns so only columns for newly recorded samples are computed each frame. */
+    std::atomic<bool> scrolling;
+    int scrollSamplesPerColumn;
+    int scrollColumns;
+    int scrollChannels;
+    long long scrollColumnEnd;
+    float scrollWindowMin;
+    float scrollWindowMax;
+    unsigned long scrollGeneration;
+    std::vector<std::vector<float> > columnRing;
+
+    /* Review mode: a fixed window ending at endFrame, read through the compressed history. The last window produced is remembered so an unchanged view isn't decoded again. */
+    std::atomic<long long> endFrame;
+    long long reviewEndFrame;
+    float reviewWindowMin;
+    float reviewWindowMax;
+    int reviewResolution;
+    int reviewChannels;
+
+    /* Current job, read by the workers */
+    ScopeFrame *jobFrame;
+    int jobLength;
+    long long jobStartFrame;        // Snapshot jobs read [jobStartFrame, jobStartFrame + jobLength) so every channel shows the same samples
+    long long jobStartColumn;
+    int jobNumColumns;
+    int jobSamplesPerColumn;
+    bool jobFromHistory;            // Read through AudioController::getHistoryFrom() rather than just the recording buffers
+    std::atomic<int> nextChannel;
+
+    /* Worker pool */
+    std::vector<std::thread> workers;
+    std::mutex poolMutex;
+    std::condition_variable poolCondition;
+    std::condition_variable doneCondition;
+    unsigned long jobGeneration;
+    int pendingWorkers;
+    bool workersRunning;
+
+    /* Producer thread */
+    std::thread producerThread;
+    std::atomic<bool> producerRunning;
+    float updateInterval;
+
+#pragma mark - Private Methods
+    void producerLoop();
+    void workerLoop();
+    void produceFrame();
+    bool prepareSnapshot(ScopeFrame *frame, int nChannels, int visibleLength, int res);
+    bool prepareScroll(ScopeFrame *frame, int nChannels, int visibleLength, int res);
+    bool prepareReview(ScopeFrame *frame, int nChannels, int visibleLength, int res, float tMin, float tMax, long long end);
+    void processChannels();
+    void renderChannel(int channel);
+    void renderScrollingChannel(int channel);
+    void resizeFrame(ScopeFrame *frame, int nChannels, int length);
+
+public:
+
+    /* Constructor/Destructor */
+    ScopeFrameProducer(AudioController *ac, int numWorkers = -1);
+    ~ScopeFrameProducer();
+
+    /* Starting/stopping the producer thread */
+    bool start(float interval);
+    void stop();
+    bool isRunning() { return producerRunning; }
+
+    /* Set the visible time range (seconds) and number of plot columns to produce */
+    void setVisibleWindow(float tMin, float tMax, int res);
+
+    /* In scrolling mode, only columns for samples recorded since the last frame are decimated */
+    void setScrolling(bool scroll) { scrolling = scroll; }
+    bool isScrolling() { return scrolling; }
+
+    /* Show the window ending at an absolute recorded frame (see AudioController::getNumRecordedFrames()) instead of the newest one. Frames older than the recording buffers come from the compressed history, or read as zeros if it doesn't have them. kScopeFrameLive follows the input again. Review frames aren't scrolling frames. */
+    void setEndFrame(long long frame) { endFrame = frame; }
+    long long getEndFrame() { return endFrame; }
+
+    /* Pick up the most recent completed frame. Returns NULL if no new frame has been published since the last call; otherwise the frame stays valid until unlockLatestFrame() */
+    const ScopeFrame *lockLatestFrame();
+    void unlockLatestFrame();
+};
+
+#endif /* ScopeFrameProducer_hpp */
@@ -0,0 +1,415 @@
+//
+//  ScopeRasterizer.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "ScopeRasterizer.hpp"
+
+typedef int PlotInt4 __attribute__((vector_size(16)));
+
+#pragma mark - Vector Helpers
+static inline PlotFloat4 splat(float value) {
+    PlotFloat4 v = {value, value, value, value};
+    return v;
+}
+
+static inline PlotFloat4 vmin(PlotFloat4 a, PlotFloat4 b) {
+    PlotInt4 mask = a < b;
+    return (PlotFloat4)(((PlotInt4)a & mask) | ((PlotInt4)b & ~mask));
+}
+
+static inline PlotFloat4 vmax(PlotFloat4 a, PlotFloat4 b) {
+    PlotInt4 mask = a > b;
+    return (PlotFloat4)(((PlotInt4)a & mask) | ((PlotInt4)b & ~mask));
+}
+
+/* Max the coverage of pixels [c, c + 4) of a row into the coverage buffer, stopping at pixel `right` (the viewport's edge). Callers pass zero coverage for pixels outside their shape, so whole vectors can be written without masking. */
+static inline void accumulate(float *row, int c, PlotFloat4 cov, int right) {
+
+    if (c + 3 <= right) {
+        PlotFloat4 existing;
+        memcpy(&existing, row + c, sizeof(existing));       // Unaligned load
+        existing = vmax(existing, cov);
+        memcpy(row + c, &existing, sizeof(existing));
+    }
+    else {
+        for (int k = 0; k <= right - c; k++)
+            row[c + k] = cov[k] > row[c + k] ? cov[k] : row[c + k];
+    }
+}
+
+#pragma mark - ScopeRasterizer
+ScopeRasterizer::ScopeRasterizer(int w, int h) : width(0), height(0), viewX(0), viewY(0), viewWidth(0), viewHeight(0) {
+    resize(w, h);
+}
+
+void ScopeRasterizer::resize(int w, int h) {
+
+    width = w > 0 ? w : 0;
+    height = h > 0 ? h : 0;
+    pixels.assign(width * height, 0);
+    coverage.assign(width * height, 0.0f);
+
+    setViewport(0, 0, width, height);
+    dirtyMinX = dirtyMinY = 0;
+    dirtyMaxX = dirtyMaxY = -1;
+}
+
+void ScopeRasterizer::setViewport(int x, int y, int w, int h) {
+
+    viewX = x < 0 ? 0 : (x > width ? width : x);
+    viewY = y < 0 ? 0 : (y > height ? height : y);
+    viewWidth = viewX + w > width ? width - viewX : (w > 0 ? w : 0);
+    viewHeight = viewY + h > height ? height - viewY : (h > 0 ? h : 0);
+}
+
+void ScopeRasterizer::clear(ScopeColor color) {
+    std::fill(pixels.begin(), pixels.end(), color);
+}
+
+#pragma mark - Drawing
+void ScopeRasterizer::drawLine(const PlotVertex *vertices, int n, ScopeColor color, float lineWidth) {
+
+    if (n <= 0 || viewWidth <= 0 || viewHeight <= 0)
+        return;
+
+    float halfWidth = 0.5f * lineWidth;
+    float bottom = viewY + viewHeight;
+
+    float x0 = viewX + vertices[0].x;
+    float y0 = bottom - vertices[0].y;
+    if (n == 1)
+        coverSegment(x0, y0, x0, y0, halfWidth);
+
+    for (int i = 1; i < n; i++) {
+        float x1 = viewX + vertices[i].x;
+        float y1 = bottom - vertices[i].y;
+        coverSegment(x0, y0, x1, y1, halfWidth);
+        x0 = x1;
+        y0 = y1;
+    }
+
+    composite(color);
+}
+
+void ScopeRasterizer::fillColumns(const PlotVertex *vertices, int n, float originY, ScopeColor color, float lineWidth) {
+
+    if (n <= 0 || viewWidth <= 0 || viewHeight <= 0)
+        return;
+
+    float halfWidth = 0.5f * lineWidth;
+    float bottom = viewY + viewHeight;
+
+    for (int i = 0; i < n; i++) {
+        float x = viewX + vertices[i].x;
+        float y0 = bottom - vertices[i].y;
+        float y1 = bottom - (2.0f * originY - vertices[i].y);
+        coverRect(x - halfWidth, x + halfWidth, y0 < y1 ? y0 : y1, y0 < y1 ? y1 : y0);
+    }
+
+    composite(color);
+}
+
+void ScopeRasterizer::drawGridLines(bool vertical, const float *positions, int n, ScopeColor color, float lineWidth, float dashLength) {
+
+    if (n <= 0 || viewWidth <= 0 || viewHeight <= 0)
+        return;
+
+    float halfWidth = 0.5f * lineWidth;
+    float length = vertical ? viewHeight : viewWidth;
+    float period = dashLength > 0.0f ? 2.0f * dashLength : length;
+    float dash = dashLength > 0.0f ? dashLength : length;
+
+    for (int i = 0; i < n; i++) {
+
+        /* Dashes start where the Cocoa paths do: the bottom of vertical lines and the left end of horizontal ones */
+        for (float d = 0.0f; d < length; d += period) {
+
+            float end = d + dash < length ? d + dash : length;
+            if (vertical) {
+                float x = viewX + positions[i];
+                coverRect(x - halfWidth, x + halfWidth, viewY + viewHeight - end, viewY + viewHeight - d);
+            }
+            else {
+                float y = viewY + viewHeight - positions[i];
+                coverRect(viewX + d, viewX + end, y - halfWidth, y + halfWidth);
+            }
+        }
+    }
+
+    composite(color);
+}
+
+void ScopeRasterizer::drawColormapRows(const uint8_t *const *rows, int nRows, const ScopeColor *colormap) {
+
+    for (int r = 0; r < viewHeight; r++) {
+
+        ScopeColor *dst = &pixels[(viewY + r) * width + viewX];
+        if (r >= nRows) {
+            std::fill(dst, dst + viewWidth, colormap[0]);
+            continue;
+        }
+
+        const uint8_t *levels = rows[r];
+        for (int c = 0; c < viewWidth; c++)
+            dst[c] = colormap[levels[c]];
+    }
+}
+
+#pragma mark - Colors
+ScopeColor ScopeRasterizer::makeColor(float red, float green, float blue, float alpha) {
+
+    float channels[4] = {red, green, blue, alpha};
+    ScopeColor color = 0;
+    for (int i = 0; i < 4; i++) {
+        float c = channels[i] < 0.0f ? 0.0f : (channels[i] > 1.0f ? 1.0f : channels[i]);
+        color |= (ScopeColor)(c * 255.0f + 0.5f) << (8 * i);
+    }
+    return color;
+}
+
+ScopeColor ScopeRasterizer::colorWithHue(float hue, float saturation, float brightness, float alpha) {
+
+    float h = (hue - floorf(hue)) * 6.0f;
+    int sector = (int)h % 6;
+    float f = h - floorf(h);
+
+    float p = brightness * (1.0f - saturation);
+    float q = brightness * (1.0f - saturation * f);
+    float t = brightness * (1.0f - saturation * (1.0f - f));
+
+    switch (sector) {
+        case 0:  return makeColor(brightness, t, p, alpha);
+        case 1:  return makeColor(q, brightness, p, alpha);
+        case 2:  return makeColor(p, brightness, t, alpha);
+        case 3:  return makeColor(p, q, brightness, alpha);
+        case 4:  return makeColor(t, p, brightness, alpha);
+        default: return makeColor(brightness, p, q, alpha);
+    }
+}
+
+#pragma mark - Private Methods
+/* Coverage of a segment of half-width halfWidth, in image coordinates (y down), as spans: one horizontal span per row for steep segments and one vertical span per column for shallow ones, each as wide as the line's cross-section along that axis and box-filtered at its ends. Ends are extended by halfWidth so joints and peaks aren't clipped. Polylines from PlotGeometry are dense (a few vertices per column), so spans follow them closely and each row or column of a segment is usually a single four-pixel group. */
+void ScopeRasterizer::coverSegment(float x0, float y0, float x1, float y1, float halfWidth) {
+
+    if (!isfinite(x0) || !isfinite(y0) || !isfinite(x1) || !isfinite(y1))
+        return;
+
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float length = sqrtf(dx * dx + dy * dy);
+
+    if (fabsf(dy) >= fabsf(dx))
+        coverSpans(x0, y0, x1, y1, halfWidth, dy != 0.0f ? halfWidth * length / fabsf(dy) : halfWidth, false);
+    else
+        coverSpans(y0, x0, y1, x1, halfWidth, halfWidth * length / fabsf(dx), true);
+}
+
+/* Spans across the major axis u of a segment, stepping along v. Each step's span is centered on the segment and `across` wide on either side. transposed: u is y and v is x. */
+void ScopeRasterizer::coverSpans(float u0, float v0, float u1, float v1, float halfWidth, float across, bool transposed) {
+
+    if (v1 < v0) {
+        float tu = u0, tv = v0;
+        u0 = u1; v0 = v1;
+        u1 = tu; v1 = tv;
+    }
+    float slope = v1 > v0 ? (u1 - u0) / (v1 - v0) : 0.0f;
+
+    /* Steps covering [v0 - halfWidth, v1 + halfWidth], clipped to the viewport */
+    float vStart = v0 - halfWidth, vEnd = v1 + halfWidth;
+    int vFirst = transposed ? viewX : viewY;
+    int vLast = transposed ? viewX + viewWidth - 1 : viewY + viewHeight - 1;
+    int uFirst = transposed ? viewY : viewX;
+    int uLast = transposed ? viewY + viewHeight - 1 : viewX + viewWidth - 1;
+
+    int stepMin = (int)floorf(vStart);
+    int stepMax = (int)ceilf(vEnd) - 1;
+    stepMin = stepMin < vFirst ? vFirst : stepMin;
+    stepMax = stepMax > vLast ? vLast : stepMax;
+
+    float uLo = (u0 < u1 ? u0 : u1) - across;
+    float uHi = (u0 < u1 ? u1 : u0) + across;
+    int spanMin = (int)floorf(uLo);
+    int spanMax = (int)ceilf(uHi) - 1;
+    spanMin = spanMin < uFirst ? uFirst : spanMin;
+    spanMax = spanMax > uLast ? uLast : spanMax;
+    if (stepMin > stepMax || spanMin > spanMax)
+        return;
+
+    if (transposed)
+        markDirty(stepMin, stepMax, spanMin, spanMax);
+    else
+        markDirty(spanMin, spanMax, stepMin, stepMax);
+
+    PlotFloat4 lane = {0.0f, 1.0f, 2.0f, 3.0f};
+    PlotFloat4 zero = splat(0.0f), one = splat(1.0f);
+
+    for (int v = stepMin; v <= stepMax; v++) {
+
+        /* Fraction of this step inside the extended segment */
+        float top = vStart > v ? vStart : v;
+        float bottom = vEnd < v + 1 ? vEnd : v + 1;
+        float weight = bottom - top;
+
+        /* Span centered on the segment at the middle of the step */
+        float vc = v + 0.5f;
+        vc = vc < v0 ? v0 : (vc > v1 ? v1 : vc);
+        float uc = u0 + (vc - v0) * slope;
+        float left = uc - across, right = uc + across;
+
+        int first = (int)floorf(left);
+        int last = (int)ceilf(right) - 1;
+        first = first < spanMin ? spanMin : first;
+        last = last > spanMax ? spanMax : last;
+
+        PlotFloat4 vLeft = splat(left), vRight = splat(right), vWeight = splat(weight);
+
+        for (int u = first; u <= last; u += 4) {
+
+            PlotFloat4 pu = splat((float)u) + lane;
+            PlotFloat4 cov = vmax(vmin(vRight, pu + one) - vmax(vLeft, pu), zero) * vWeight;
+
+            if (!transposed)
+                accumulate(&coverage[v * width], u, cov, uLast);
+            else {
+                int n = uLast - u + 1 < 4 ? uLast - u + 1 : 4;
+                for (int k = 0; k < n; k++) {
+                    float *dst = &coverage[(u + k) * width + v];
+                    *dst = cov[k] > *dst ? cov[k] : *dst;
+                }
+            }
+        }
+    }
+}
+
+/* Coverage of an axis-aligned rectangle with fractional edges, in image coordinates */
+void ScopeRasterizer::coverRect(float x0, float x1, float y0, float y1) {
+
+    if (!isfinite(x0) || !isfinite(x1) || !isfinite(y0) || !isfinite(y1))
+        return;
+
+    int xMin = (int)floorf(x0);
+    int xMax = (int)ceilf(x1) - 1;
+    int yMin = (int)floorf(y0);
+    int yMax = (int)ceilf(y1) - 1;
+    xMin = xMin < viewX ? viewX : xMin;
+    xMax = xMax > viewX + viewWidth - 1 ? viewX + viewWidth - 1 : xMax;
+    yMin = yMin < viewY ? viewY : yMin;
+    yMax = yMax > viewY + viewHeight - 1 ? viewY + viewHeight - 1 : yMax;
+    if (xMin > xMax || yMin > yMax)
+        return;
+
+    markDirty(xMin, xMax, yMin, yMax);
+
+    PlotFloat4 lane = {0.0f, 1.0f, 2.0f, 3.0f};
+    PlotFloat4 left = splat(x0), right = splat(x1);
+    PlotFloat4 zero = splat(0.0f);
+
+    for (int r = yMin; r <= yMax; r++) {
+
+        /* Vertical overlap of the row; only the end rows of a column are partial */
+        float top = y0 > r ? y0 : r;
+        float bottom = y1 < r + 1 ? y1 : r + 1;
+        PlotFloat4 vertical = splat(bottom - top);
+        float *row = &coverage[r * width];
+
+        for (int c = xMin; c <= xMax; c += 4) {
+            PlotFloat4 px = splat((float)c) + lane;
+            PlotFloat4 horizontal = vmax(vmin(right, px + splat(1.0f)) - vmax(left, px), zero);
+            accumulate(row, c, horizontal * vertical, viewX + viewWidth - 1);
+        }
+    }
+}
+
+void ScopeRasterizer::markDirty(int xMin, int xMax, int yMin, int yMax) {
+
+    if (dirtyMaxX < dirtyMinX) {
+        dirtyMinX = xMin;
+        dirtyMaxX = xMax;
+        dirtyMinY = yMin;
+        dirtyMaxY = yMax;
+        return;
+    }
+
+    dirtyMinX = xMin < dirtyMinX ? xMin : dirtyMinX;
+    dirtyMaxX = xMax > dirtyMaxX ? xMax : dirtyMaxX;
+    dirtyMinY = yMin < dirtyMinY ? yMin : dirtyMinY;
+    dirtyMaxY = yMax > dirtyMaxY ? yMax : dirtyMaxY;
+}
+
+/* Blend the color over the frame by the accumulated coverage, four pixels at a time, and clear the coverage */
+void ScopeRasterizer::composite(ScopeColor color) {
+
+    if (dirtyMaxX < dirtyMinX)
+        return;
+
+    PlotFloat4 red = splat(color & 0xff);
+    PlotFloat4 green = splat((color >> 8) & 0xff);
+    PlotFloat4 blue = splat((color >> 16) & 0xff);
+    PlotFloat4 opaque = splat(255.0f);
+    PlotFloat4 alpha = splat(((color >> 24) & 0xff) / 255.0f);
+    PlotFloat4 zero = splat(0.0f), half = splat(0.5f);
+    PlotUInt4 mask = {0xff, 0xff, 0xff, 0xff};
+
+    for (int r = dirtyMinY; r <= dirtyMaxY; r++) {
+
+        float *cov = &coverage[r * width];
+        ScopeColor *dst = &pixels[r * width];
+
+        for (int c = dirtyMinX; c <= dirtyMaxX; c += 4) {
+
+            int count = dirtyMaxX - c + 1;
+            count = count > 4 ? 4 : count;
+
+            /* Fixed-size copies compile to single vector loads; only the right edge needs a partial one */
+            PlotFloat4 k = zero;
+            PlotUInt4 p = {0, 0, 0, 0};
+            if (count == 4)
+                memcpy(&k, cov + c, sizeof(k));
+            else
+                memcpy(&k, cov + c, count * sizeof(float));
+
+            /* Skip untouched pixels */
+            PlotInt4 touched = k > zero;
+            if (!(touched[0] | touched[1] | touched[2] | touched[3]))
+                continue;
+
+            if (count == 4)
+                memcpy(&p, dst + c, sizeof(p));
+            else
+                memcpy(&p, dst + c, count * sizeof(ScopeColor));
+
+            k *= alpha;
+
+            PlotFloat4 r0 = __builtin_convertvector(p & mask, PlotFloat4);
+            PlotFloat4 g0 = __builtin_convertvector((p >> 8) & mask, PlotFloat4);
+            PlotFloat4 b0 = __builtin_convertvector((p >> 16) & mask, PlotFloat4);
+            PlotFloat4 a0 = __builtin_convertvector((p >> 24) & mask, PlotFloat4);
+
+            r0 += (red - r0) * k + half;
+            g0 += (green - g0) * k + half;
+            b0 += (blue - b0) * k + half;
+            a0 += (opaque - a0) * k + half;
+
+            p = __builtin_convertvector(r0, PlotUInt4) |
+                (__builtin_convertvector(g0, PlotUInt4) << 8) |
+                (__builtin_convertvector(b0, PlotUInt4) << 16) |
+                (__builtin_convertvector(a0, PlotUInt4) << 24);
+
+            if (count == 4) {
+                memcpy(dst + c, &p, sizeof(p));
+                memcpy(cov + c, &zero, sizeof(zero));
+            }
+            else {
+                memcpy(dst + c, &p, count * sizeof(ScopeColor));
+                memset(cov + c, 0, count * sizeof(float));
+            }
+        }
+    }
+
+    dirtyMinX = dirtyMinY = 0;
+    dirtyMaxX = dirtyMaxY = -1;
+}
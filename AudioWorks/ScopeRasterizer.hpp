@@ -0,0 +1,91 @@
+//
+//  ScopeRasterizer.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef ScopeRasterizer_hpp
+#define ScopeRasterizer_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include "PlotGeometry.hpp"
+
+/* 8-bit RGBA pixel, red in the low byte (R, G, B, A in memory on little-endian machines) */
+typedef uint32_t ScopeColor;
+
+/* Four-wide float vector (SSE on x86, NEON on ARM) for coverage and compositing */
+typedef float PlotFloat4 __attribute__((vector_size(16)));
+
+/* Four-wide unsigned int vector for unpacking four pixels at once */
+typedef uint32_t PlotUInt4 __attribute__((vector_size(16)));
+
+/* Headless replacement for the drawRect: methods of METScopePlotDataView and METScopeGridView: draws plot data into an RGBA frame buffer with no window system.
+
+    Drawing happens in a viewport (a panel of the frame) using the same pixel coordinates as the Cocoa views, i.e. origin at the bottom left and y up, so PlotGeometry's reduced vertices can be passed straight in. Image rows are stored top-down.
+
+    Each draw call first accumulates anti-aliased coverage (0-1 per pixel, taking the maximum where shapes overlap, so polyline joints aren't blended twice) and then composites the covered region in one pass with the draw color. Coverage is box-filtered spans (a row or column at a time, four pixels per vector) rather than exact distances, and compositing also runs four pixels at a time. */
+class ScopeRasterizer {
+
+    int width;
+    int height;
+    std::vector<ScopeColor> pixels;
+    std::vector<float> coverage;
+
+    /* Viewport, in image pixels; y is the top row */
+    int viewX, viewY, viewWidth, viewHeight;
+
+    /* Bounding box of nonzero coverage since the last composite (inclusive) */
+    int dirtyMinX, dirtyMaxX, dirtyMinY, dirtyMaxY;
+
+#pragma mark - Private Methods
+    void coverSegment(float x0, float y0, float x1, float y1, float halfWidth);
+    void coverSpans(float u0, float v0, float u1, float v1, float halfWidth, float across, bool transposed);
+    void coverRect(float x0, float x1, float y0, float y1);
+    void markDirty(int xMin, int xMax, int yMin, int yMax);
+    void composite(ScopeColor color);
+
+public:
+
+    /* Constructor */
+    ScopeRasterizer(int w, int h);
+
+    /* Resize the frame buffer. The viewport is reset to the whole frame. */
+    void resize(int w, int h);
+
+    /* Restrict drawing to a panel of the frame. y is the panel's top row. */
+    void setViewport(int x, int y, int w, int h);
+
+    /* Fill the whole frame (not just the viewport) */
+    void clear(ScopeColor color);
+
+    /* Stroke a connected polyline, as -[METScopePlotDataView drawRect:] does in kMETScopePlotModeLine */
+    void drawLine(const PlotVertex *vertices, int n, ScopeColor color, float lineWidth);
+
+    /* One vertical bar per vertex, mirrored about originY, as drawRect: does in kMETScopePlotModeFillSymmetrical */
+    void fillColumns(const PlotVertex *vertices, int n, float originY, ScopeColor color, float lineWidth);
+
+    /* Dashed full-height (vertical) or full-width (horizontal) grid lines at the given viewport pixel positions, as METScopeGridView draws them */
+    void drawGridLines(bool vertical, const float *positions, int n, ScopeColor color, float lineWidth, float dashLength);
+
+    /* Fill the viewport with rows of 8-bit levels mapped through a 256-entry colormap. rows[0] goes at the top; each row must be at least the viewport's width. Rows past nRows are filled with colormap[0]. */
+    void drawColormapRows(const uint8_t *const *rows, int nRows, const ScopeColor *colormap);
+
+    /* Colors */
+    static ScopeColor makeColor(float red, float green, float blue, float alpha);
+    static ScopeColor colorWithHue(float hue, float saturation, float brightness, float alpha);    // As +[NSColor colorWithHue:saturation:brightness:alpha:]
+
+    /* Getters */
+    int getWidth() { return width; }
+    int getHeight() { return height; }
+    const ScopeColor *getPixels() { return pixels.empty() ? NULL : &pixels[0]; }
+};
+
+#endif /* ScopeRasterizer_hpp */
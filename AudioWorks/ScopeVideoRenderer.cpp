@@ -0,0 +1,532 @@
+//
+//  ScopeVideoRenderer.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "ScopeVideoRenderer.hpp"
+
+#define kScopeVideoWaterfallBlock (64)      // Waterfall rows claimed by a worker at a time
+
+#pragma mark - ScopeVideoRenderer
+ScopeVideoRenderer::ScopeVideoRenderer(const float *const *sessionChannels, int nChannels, long long nFrames, float fs) : channels(sessionChannels), numChannels(nChannels), numFrames(nFrames), sampleRate(fs), width(1280), height(720), frameRate(60.0f), showTimeDomain(true), showSpectrum(true), showWaterfall(true), timeWindow(0.1f), minDecibels(-80.0f), maxDecibels(0.0f), waterfallChannel(0), fftSize(0), log2FFTSize(0), nextFrame(0), aborted(false), deliveredFrames(0) {
+
+    if (numChannels <= 0 || numFrames <= 0 || sampleRate <= 0.0f) {
+        printf("%s: Empty session (%d channels, %lld frames at %f Hz)\n", __PRETTY_FUNCTION__, numChannels, numFrames, sampleRate);
+        numChannels = 0;
+        numFrames = 0;
+        sampleRate = 44100.0f;
+    }
+
+    /* Same limits as METScopeView's frequency domain mode */
+    minFrequency = 0.0f;
+    maxFrequency = sampleRate / 2.0f < 12000.0f ? sampleRate / 2.0f : 12000.0f;
+
+    /* Same colors as the live scope: black background, translucent white grid, channel hues spread over [0, 0.75] */
+    backgroundColor = ScopeRasterizer::makeColor(0.0f, 0.0f, 0.0f, 1.0f);
+    gridColor = ScopeRasterizer::makeColor(1.0f, 1.0f, 1.0f, kScopeVideoGridAlpha);
+    for (int i = 0; i < numChannels; i++)
+        plotColors.push_back(ScopeRasterizer::colorWithHue(numChannels > 1 ? 0.75f * i / (numChannels - 1) : 0.0f, 1.0f, 1.0f, 1.0f));
+
+    /* Waterfall colormap: black -> blue -> magenta -> red -> yellow -> white */
+    const float stops[6][3] = {{0, 0, 0}, {0, 0, 1}, {1, 0, 1}, {1, 0, 0}, {1, 1, 0}, {1, 1, 1}};
+    for (int i = 0; i < 256; i++) {
+        float position = i / 255.0f * 5.0f;
+        int s = position >= 5.0f ? 4 : (int)position;
+        float f = position - s;
+        colormap[i] = ScopeRasterizer::makeColor(stops[s][0] + f * (stops[s+1][0] - stops[s][0]),
+                                                 stops[s][1] + f * (stops[s+1][1] - stops[s][1]),
+                                                 stops[s][2] + f * (stops[s+1][2] - stops[s][2]), 1.0f);
+    }
+
+    setFFTSize(2048);
+}
+
+ScopeVideoRenderer::~ScopeVideoRenderer() {
+    for (int i = 0; i < (int)slots.size(); i++)
+        delete slots[i];
+}
+
+#pragma mark - Setters
+bool ScopeVideoRenderer::setFrameSize(int w, int h) {
+
+    if (w <= 0 || h <= 0) {
+        printf("%s: Invalid frame size %d x %d\n", __PRETTY_FUNCTION__, w, h);
+        return false;
+    }
+    width = w;
+    height = h;
+    return true;
+}
+
+bool ScopeVideoRenderer::setFrameRate(float fps) {
+
+    if (fps <= 0.0f) {
+        printf("%s: Invalid frame rate %f\n", __PRETTY_FUNCTION__, fps);
+        return false;
+    }
+    frameRate = fps;
+    return true;
+}
+
+bool ScopeVideoRenderer::setTimeWindow(float seconds) {
+
+    if (seconds <= 0.0f) {
+        printf("%s: Invalid time window %f\n", __PRETTY_FUNCTION__, seconds);
+        return false;
+    }
+    timeWindow = seconds;
+    return true;
+}
+
+bool ScopeVideoRenderer::setFFTSize(int size) {
+
+    if (size < 16 || size > 65536 || (size & (size - 1))) {
+        printf("%s: Invalid FFT size %d. Must be a power of two in [16, 65536].\n", __PRETTY_FUNCTION__, size);
+        return false;
+    }
+    fftSize = size;
+    setUpFFT();
+    return true;
+}
+
+bool ScopeVideoRenderer::setSpectrumRange(float fMin, float fMax, float dBMin, float dBMax) {
+
+    fMax = fMax > sampleRate / 2.0f ? sampleRate / 2.0f : fMax;
+    if (fMin < 0.0f || fMin >= fMax || dBMin >= dBMax) {
+        printf("%s: Invalid range f = [%f, %f], dB = [%f, %f]\n", __PRETTY_FUNCTION__, fMin, fMax, dBMin, dBMax);
+        return false;
+    }
+    minFrequency = fMin;
+    maxFrequency = fMax;
+    minDecibels = dBMin;
+    maxDecibels = dBMax;
+    return true;
+}
+
+bool ScopeVideoRenderer::setWaterfallChannel(int channel) {
+
+    if (channel < 0 || channel >= numChannels) {
+        printf("%s: Invalid channel index %d. Session has %d channels.\n", __PRETTY_FUNCTION__, channel, numChannels);
+        return false;
+    }
+    waterfallChannel = channel;
+    return true;
+}
+
+void ScopeVideoRenderer::setViews(bool timeDomain, bool spectrum, bool waterfall) {
+    showTimeDomain = timeDomain;
+    showSpectrum = spectrum;
+    showWaterfall = waterfall;
+}
+
+#pragma mark - Rendering
+bool ScopeVideoRenderer::render(ScopeVideoFrameCallback *callback, void *userData, int numWorkers) {
+
+    long nVideoFrames = getNumVideoFrames();
+    if (nVideoFrames <= 0 || getNumPanels() == 0 || height < getNumPanels()) {
+        printf("%s: Nothing to render (%ld frames, %d views, %d pixels high)\n", __PRETTY_FUNCTION__, nVideoFrames, getNumPanels(), height);
+        return false;
+    }
+
+    if (numWorkers <= 0)
+        numWorkers = std::thread::hardware_concurrency();
+    numWorkers = numWorkers < 1 ? 1 : (numWorkers > kScopeVideoMaxWorkers ? kScopeVideoMaxWorkers : numWorkers);
+
+    std::vector<Worker> workers(numWorkers);
+    for (int i = 0; i < numWorkers; i++)
+        setUpWorker(&workers[i]);
+    std::vector<std::thread> threads;
+
+    /* Every frame's waterfall row, so frames can be drawn independently */
+    if (showWaterfall) {
+
+        waterfallRows.resize((size_t)nVideoFrames * width);
+        nextFrame = 0;
+        for (int i = 0; i < numWorkers; i++)
+            threads.push_back(std::thread(&ScopeVideoRenderer::renderWaterfallRows, this, &workers[i]));
+        for (int i = 0; i < numWorkers; i++)
+            threads[i].join();
+        threads.clear();
+    }
+
+    /* Frame ring */
+    int numSlots = numWorkers * kScopeVideoFramesPerWorker;
+    for (int i = 0; i < (int)slots.size(); i++)
+        delete slots[i];
+    slots.resize(numSlots);
+    for (int i = 0; i < numSlots; i++)
+        slots[i] = new ScopeRasterizer(width, height);
+    slotFrames.assign(numSlots, -1);
+    deliveredFrames = 0;
+    nextFrame = 0;
+    aborted = false;
+
+    for (int i = 0; i < numWorkers; i++)
+        threads.push_back(std::thread(&ScopeVideoRenderer::renderFrames, this, &workers[i]));
+
+    /* Deliver in order */
+    for (long frame = 0; frame < nVideoFrames; frame++) {
+
+        int s = (int)(frame % numSlots);
+        {
+            std::unique_lock<std::mutex> lock(slotMutex);
+            slotCondition.wait(lock, [&]{ return slotFrames[s] == frame; });
+        }
+
+        bool keepGoing = callback(frame, slots[s]->getPixels(), width, height, userData);
+        {
+            std::lock_guard<std::mutex> lock(slotMutex);
+            deliveredFrames = frame + 1;
+            if (!keepGoing)
+                aborted = true;
+        }
+        slotCondition.notify_all();
+
+        if (!keepGoing)
+            break;
+    }
+
+    for (int i = 0; i < numWorkers; i++)
+        threads[i].join();
+
+    for (int i = 0; i < numSlots; i++)
+        delete slots[i];
+    slots.clear();
+    std::vector<uint8_t>().swap(waterfallRows);
+
+    return !aborted;
+}
+
+bool ScopeVideoRenderer::renderFrame(long frame, ScopeRasterizer *raster) {
+
+    if (frame < 0 || frame >= getNumVideoFrames() || getNumPanels() == 0 || height < getNumPanels()) {
+        printf("%s: Invalid frame %ld. %ld frames, %d views.\n", __PRETTY_FUNCTION__, frame, getNumVideoFrames(), getNumPanels());
+        return false;
+    }
+
+    Worker w;
+    setUpWorker(&w);
+    drawFrame(&w, frame, raster, false);
+    return true;
+}
+
+#pragma mark - Private Methods
+void ScopeVideoRenderer::setUpFFT() {
+
+    log2FFTSize = 0;
+    while ((1 << log2FFTSize) < fftSize)
+        log2FFTSize++;
+
+    /* Periodic Hann, as vDSP_hann_window(..., vDSP_HANN_NORM) */
+    window.resize(fftSize);
+    for (int i = 0; i < fftSize; i++)
+        window[i] = 0.5f * (1.0f - cosf(2.0f * M_PI * i / fftSize));
+
+    twiddleReal.resize(fftSize / 2);
+    twiddleImag.resize(fftSize / 2);
+    for (int k = 0; k < fftSize / 2; k++) {
+        twiddleReal[k] = cos(2.0 * M_PI * k / fftSize);
+        twiddleImag[k] = -sin(2.0 * M_PI * k / fftSize);
+    }
+
+    bitReverse.resize(fftSize);
+    for (int i = 0; i < fftSize; i++) {
+        int r = 0;
+        for (int b = 0; b < log2FFTSize; b++)
+            r |= ((i >> b) & 1) << (log2FFTSize - 1 - b);
+        bitReverse[i] = r;
+    }
+}
+
+void ScopeVideoRenderer::setUpWorker(Worker *w) {
+
+    int timeLength = (int)(timeWindow * sampleRate + 0.5f);
+    timeLength = timeLength < 2 ? 2 : timeLength;
+
+    w->samples.resize(timeLength > fftSize ? timeLength : fftSize);
+    w->x.resize(timeLength > width ? timeLength : width);
+    w->y.resize(w->x.size());
+    w->fftReal.resize(fftSize);
+    w->fftImag.resize(fftSize);
+    w->magnitude.resize(fftSize / 2);
+
+    w->frequencies.resize(fftSize / 2);
+    for (int k = 0; k < fftSize / 2; k++)
+        w->frequencies[k] = k * sampleRate / fftSize;
+}
+
+/* Session samples [start, start + length) of a channel, zero outside the session */
+void ScopeVideoRenderer::readSession(int channel, long long start, int length, float *dst) {
+
+    for (int i = 0; i < length; i++) {
+        long long frame = start + i;
+        dst[i] = frame >= 0 && frame < numFrames ? channels[channel][frame] : 0.0f;
+    }
+}
+
+/* Magnitude spectrum of the fftSize samples up to endFrame into w->magnitude, scaled as FFTPlan::computeMagnitude() */
+void ScopeVideoRenderer::computeSpectrum(Worker *w, int channel, long long endFrame) {
+
+    float *re = &w->fftReal[0];
+    float *im = &w->fftImag[0];
+
+    readSession(channel, endFrame - fftSize, fftSize, &w->samples[0]);
+    for (int i = 0; i < fftSize; i++) {
+        re[bitReverse[i]] = w->samples[i] * window[i];
+        im[i] = 0.0f;
+    }
+
+    /* Iterative radix-2 decimation in time */
+    for (int size = 2; size <= fftSize; size *= 2) {
+
+        int half = size / 2;
+        int step = fftSize / size;
+
+        for (int start = 0; start < fftSize; start += size) {
+            for (int k = 0; k < half; k++) {
+
+                float wr = twiddleReal[k * step];
+                float wi = twiddleImag[k * step];
+                int a = start + k;
+                int b = a + half;
+
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+
+    /* vDSP's real FFTs come out scaled by 2, and FFTPlan then scales by 2 / size */
+    float scale = 4.0f / fftSize;
+    for (int k = 0; k < fftSize / 2; k++)
+        w->magnitude[k] = sqrtf(re[k] * re[k] + im[k] * im[k]) * scale;
+}
+
+/* One frame's waterfall row: the peak level of the bins under each pixel column */
+void ScopeVideoRenderer::computeWaterfallRow(Worker *w, long frame, uint8_t *row) {
+
+    computeSpectrum(w, waterfallChannel, getEndFrame(frame));
+
+    int numBins = fftSize / 2;
+    float binWidth = sampleRate / fftSize;
+    float columnWidth = (maxFrequency - minFrequency) / width;
+    float range = maxDecibels - minDecibels;
+
+    for (int c = 0; c < width; c++) {
+
+        float f0 = minFrequency + c * columnWidth;
+        float f1 = f0 + columnWidth;
+        int lo = (int)ceilf(f0 / binWidth);
+        int hi = (int)ceilf(f1 / binWidth) - 1;
+        hi = hi > numBins - 1 ? numBins - 1 : hi;
+
+        /* Columns narrower than a bin take the nearest one */
+        if (lo > hi) {
+            lo = (int)roundf(0.5f * (f0 + f1) / binWidth);
+            lo = hi = lo > numBins - 1 ? numBins - 1 : lo;
+        }
+
+        float peak = 0.0f;
+        for (int k = lo; k <= hi; k++)
+            peak = w->magnitude[k] > peak ? w->magnitude[k] : peak;
+
+        float level = (20.0f * log10f(peak + 10e-16f) - minDecibels) / range;
+        level = level < 0.0f ? 0.0f : (level > 1.0f ? 1.0f : level);
+        row[c] = (uint8_t)(level * 255.0f + 0.5f);
+    }
+}
+
+void ScopeVideoRenderer::renderWaterfallRows(Worker *w) {
+
+    long nVideoFrames = getNumVideoFrames();
+    long start;
+
+    while ((start = nextFrame.fetch_add(kScopeVideoWaterfallBlock)) < nVideoFrames) {
+        long end = start + kScopeVideoWaterfallBlock < nVideoFrames ? start + kScopeVideoWaterfallBlock : nVideoFrames;
+        for (long frame = start; frame < end; frame++)
+            computeWaterfallRow(w, frame, &waterfallRows[(size_t)frame * width]);
+    }
+}
+
+void ScopeVideoRenderer::renderFrames(Worker *w) {
+
+    long nVideoFrames = getNumVideoFrames();
+    long numSlots = slots.size();
+    long frame;
+
+    while ((frame = nextFrame++) < nVideoFrames) {
+
+        /* Wait until this frame's slot has been delivered */
+        {
+            std::unique_lock<std::mutex> lock(slotMutex);
+            slotCondition.wait(lock, [&]{ return aborted || frame < deliveredFrames + numSlots; });
+            if (aborted)
+                return;
+        }
+
+        int s = (int)(frame % numSlots);
+        drawFrame(w, frame, slots[s], true);
+
+        {
+            std::lock_guard<std::mutex> lock(slotMutex);
+            slotFrames[s] = frame;
+        }
+        slotCondition.notify_all();
+    }
+}
+
+void ScopeVideoRenderer::drawFrame(Worker *w, long frame, ScopeRasterizer *raster, bool waterfallReady) {
+
+    if (raster->getWidth() != width || raster->getHeight() != height)
+        raster->resize(width, height);
+
+    raster->setViewport(0, 0, width, height);
+    raster->clear(backgroundColor);
+
+    long long endFrame = getEndFrame(frame);
+    int panelHeight = height / getNumPanels();
+    int top = 0;
+
+    /* The last panel takes any leftover rows */
+    if (showTimeDomain) {
+        int h = top + 2 * panelHeight > height ? height - top : panelHeight;
+        drawTimeDomain(w, endFrame, raster, top, h);
+        top += h;
+    }
+    if (showSpectrum) {
+        int h = top + 2 * panelHeight > height ? height - top : panelHeight;
+        drawSpectrum(w, endFrame, raster, top, h);
+        top += h;
+    }
+    if (showWaterfall)
+        drawWaterfall(w, frame, raster, top, height - top, waterfallReady);
+}
+
+void ScopeVideoRenderer::drawTimeDomain(Worker *w, long long endFrame, ScopeRasterizer *raster, int top, int panelHeight) {
+
+    raster->setViewport(0, top, width, panelHeight);
+    drawGrid(raster, -timeWindow, 0.0f, -1.0f, 1.0f, width, panelHeight,
+             autoScaleTick(timeWindow, 1.0f, 6, 8), autoScaleTick(2.0f, 0.25f, 4, 6), true);
+
+    int length = (int)(timeWindow * sampleRate + 0.5f);
+    length = length < 2 ? 2 : length;
+    long long start = endFrame - length;
+
+    w->geometry.setTransform(-timeWindow, 0.0f, -1.0f, 1.0f, width, panelHeight, false);
+    float originY = 0.5f * panelHeight;
+    bool envelope = length / width > kScopeVideoEnvelopeThreshold;
+
+    /* x positions are the same for every channel */
+    int numPoints = envelope ? width : length;
+    for (int i = 0; i < numPoints; i++)
+        w->x[i] = envelope ? -timeWindow + (i + 0.5f) * timeWindow / width : (i - length) / sampleRate;
+
+    for (int channel = 0; channel < numChannels; channel++) {
+
+        readSession(channel, start, length, &w->samples[0]);
+
+        /* Too many samples per column: plot each column's max-abs, mirrored */
+        if (envelope) {
+
+            for (int c = 0; c < width; c++) {
+                int a = (int)((long long)c * length / width);
+                int b = (int)((long long)(c + 1) * length / width);
+                float peak = 0.0f;
+                for (int i = a; i < b; i++)
+                    peak = fabsf(w->samples[i]) > peak ? fabsf(w->samples[i]) : peak;
+                w->y[c] = peak;
+            }
+
+            w->geometry.transform(&w->x[0], &w->y[0], width);
+            int n = w->geometry.reduceColumns(originY);
+            raster->fillColumns(w->geometry.getVertices(), n, originY, plotColors[channel], kScopeVideoLineWidth);
+        }
+        else {
+            w->geometry.transform(&w->x[0], &w->samples[0], length);
+            int n = w->geometry.reduceLine();
+            raster->drawLine(w->geometry.getVertices(), n, plotColors[channel], kScopeVideoLineWidth);
+        }
+    }
+}
+
+void ScopeVideoRenderer::drawSpectrum(Worker *w, long long endFrame, ScopeRasterizer *raster, int top, int panelHeight) {
+
+    raster->setViewport(0, top, width, panelHeight);
+    drawGrid(raster, minFrequency, maxFrequency, minDecibels, maxDecibels, width, panelHeight,
+             autoScaleTick(maxFrequency - minFrequency, 4000.0f, 6, 8), autoScaleTick(maxDecibels - minDecibels, 20.0f, 4, 6), true);
+
+    w->geometry.setTransform(minFrequency, maxFrequency, minDecibels, maxDecibels, width, panelHeight, true);
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        computeSpectrum(w, channel, endFrame);
+        w->geometry.transform(&w->frequencies[0], &w->magnitude[0], fftSize / 2);
+        int n = w->geometry.reduceLine();
+        raster->drawLine(w->geometry.getVertices(), n, plotColors[channel], kScopeVideoLineWidth);
+    }
+}
+
+void ScopeVideoRenderer::drawWaterfall(Worker *w, long frame, ScopeRasterizer *raster, int top, int panelHeight, bool waterfallReady) {
+
+    /* Newest row at the top, one row per video frame */
+    int nRows = frame + 1 < panelHeight ? (int)frame + 1 : panelHeight;
+    w->rows.resize(nRows);
+
+    if (waterfallReady) {
+        for (int r = 0; r < nRows; r++)
+            w->rows[r] = &waterfallRows[(size_t)(frame - r) * width];
+    }
+    else {
+        w->rowScratch.resize((size_t)nRows * width);
+        for (int r = 0; r < nRows; r++) {
+            computeWaterfallRow(w, frame - r, &w->rowScratch[(size_t)r * width]);
+            w->rows[r] = &w->rowScratch[(size_t)r * width];
+        }
+    }
+
+    raster->setViewport(0, top, width, panelHeight);
+    raster->drawColormapRows(nRows ? &w->rows[0] : NULL, nRows, colormap);
+    drawGrid(raster, minFrequency, maxFrequency, 0.0f, 1.0f, width, panelHeight,
+             autoScaleTick(maxFrequency - minFrequency, 4000.0f, 6, 8), 1.0f, false);
+}
+
+/* Dashed grid lines at multiples of the tick spacing, as METScopeGridView draws them */
+void ScopeVideoRenderer::drawGrid(ScopeRasterizer *raster, float xMin, float xMax, float yMin, float yMax, int panelWidth, int panelHeight, float xTick, float yTick, bool horizontalLines) {
+
+    float positions[64];
+    int n = 0;
+
+    for (float x = ceilf(xMin / xTick) * xTick; x <= xMax && n < 64; x += xTick)
+        positions[n++] = (x - xMin) * panelWidth / (xMax - xMin);
+    raster->drawGridLines(true, positions, n, gridColor, kScopeVideoGridLineWidth, kScopeVideoGridDashLength);
+
+    if (!horizontalLines)
+        return;
+
+    n = 0;
+    for (float y = ceilf(yMin / yTick) * yTick; y <= yMax && n < 64; y += yTick)
+        positions[n++] = (y - yMin) * panelHeight / (yMax - yMin);
+    raster->drawGridLines(false, positions, n, gridColor, kScopeVideoGridLineWidth, kScopeVideoGridDashLength);
+}
+
+/* Tick spacing for a visible range, starting from a default spacing, the way -[METScopeView performAutoScale] picks it */
+float ScopeVideoRenderer::autoScaleTick(float range, float tick, int minTicks, int maxTicks) {
+
+    float orderOfMag = floorf(log10f(range)) - 1;
+
+    /* Double or halve the tick units if we've got too few or too many within visible bounds */
+    while (range / tick > maxTicks)
+        tick *= 2.0f;
+    while (range / tick < minTicks)
+        tick /= 2.0f;
+
+    /* Round tick units to a reasonable number based on the order of magnitude */
+    tick = floorf(tick / powf(10, orderOfMag) + 0.5f) * powf(10, orderOfMag);
+    return tick > 0.0f ? tick : range;
+}
@@ -0,0 +1,144 @@
+//
+//  ScopeVideoRenderer.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef ScopeVideoRenderer_hpp
+#define ScopeVideoRenderer_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "PlotGeometry.hpp"
+#include "ScopeRasterizer.hpp"
+
+#define kScopeVideoMaxWorkers (32)
+#define kScopeVideoFramesPerWorker (2)          // Finished frames each worker may get ahead of delivery
+#define kScopeVideoEnvelopeThreshold (12)       // Samples per column above which we plot the max-abs envelope, as the live scope does
+#define kScopeVideoLineWidth (2.0f)
+#define kScopeVideoGridLineWidth (0.3f)
+#define kScopeVideoGridAlpha (0.5f)
+#define kScopeVideoGridDashLength (5.0f)
+
+/* Called with each finished frame, in order. Return false to stop rendering. */
+typedef bool ScopeVideoFrameCallback(long frameIndex, const ScopeColor *pixels, int width, int height, void *userData);
+
+/* Renders a recorded session to a sequence of video frames (or single thumbnails) without a window system, using PlotGeometry for the plot unit -> pixel reduction and ScopeRasterizer for drawing.
+
+    Each frame stacks the enabled views top to bottom: time domain (the last timeWindow seconds of every channel), spectrum (of the fftSize samples up to the frame, Hann-windowed and scaled as FFTPlan::computeMagnitude()) and a waterfall of one channel's spectra with the newest frame's at the top. Colors, line widths and the dashed grid follow ScopeViewController's and METScopeView's defaults; axis labels aren't drawn.
+
+    render() first computes the waterfall rows (one per frame) in parallel, then gives each worker the next undrawn frame. Frames depend only on the session and the waterfall rows, so they're drawn in any order and delivered to the callback in order from a small ring of frame buffers. The FFT is a plain radix-2 implementation so the renderer runs anywhere, not just where Accelerate does. */
+class ScopeVideoRenderer {
+
+    /* Session, not owned */
+    const float *const *channels;
+    int numChannels;
+    long long numFrames;
+    float sampleRate;
+
+    /* Output */
+    int width;
+    int height;
+    float frameRate;
+    bool showTimeDomain;
+    bool showSpectrum;
+    bool showWaterfall;
+
+    /* Views */
+    float timeWindow;
+    float minFrequency, maxFrequency;
+    float minDecibels, maxDecibels;
+    int waterfallChannel;
+
+    /* Colors */
+    ScopeColor backgroundColor;
+    ScopeColor gridColor;
+    std::vector<ScopeColor> plotColors;
+    ScopeColor colormap[256];
+
+    /* FFT */
+    int fftSize;
+    int log2FFTSize;
+    std::vector<float> window;
+    std::vector<float> twiddleReal, twiddleImag;
+    std::vector<int> bitReverse;
+
+    /* Waterfall levels, one row of width columns per video frame */
+    std::vector<uint8_t> waterfallRows;
+
+    /* Per-thread scratch */
+    struct Worker {
+        PlotGeometry geometry;
+        std::vector<float> samples;
+        std::vector<float> x, y;
+        std::vector<float> fftReal, fftImag;
+        std::vector<float> magnitude, frequencies;
+        std::vector<uint8_t> rowScratch;
+        std::vector<const uint8_t *> rows;
+    };
+
+    /* Render job */
+    std::atomic<long> nextFrame;
+    std::atomic<bool> aborted;
+    std::vector<ScopeRasterizer *> slots;
+    std::vector<long> slotFrames;           // Frame finished in each slot, or -1
+    long deliveredFrames;
+    std::mutex slotMutex;
+    std::condition_variable slotCondition;
+
+#pragma mark - Private Methods
+    void setUpFFT();
+    void setUpWorker(Worker *w);
+    void readSession(int channel, long long start, int length, float *dst);
+    void computeSpectrum(Worker *w, int channel, long long endFrame);
+    void computeWaterfallRow(Worker *w, long frame, uint8_t *row);
+    void renderWaterfallRows(Worker *w);
+    void renderFrames(Worker *w);
+    void drawFrame(Worker *w, long frame, ScopeRasterizer *raster, bool waterfallReady);
+    void drawTimeDomain(Worker *w, long long endFrame, ScopeRasterizer *raster, int top, int panelHeight);
+    void drawSpectrum(Worker *w, long long endFrame, ScopeRasterizer *raster, int top, int panelHeight);
+    void drawWaterfall(Worker *w, long frame, ScopeRasterizer *raster, int top, int panelHeight, bool waterfallReady);
+    void drawGrid(ScopeRasterizer *raster, float xMin, float xMax, float yMin, float yMax, int panelWidth, int panelHeight, float xTick, float yTick, bool horizontalLines);
+    long long getEndFrame(long frame) { return (long long)((frame + 1) * (double)sampleRate / frameRate); }
+    int getNumPanels() { return showTimeDomain + showSpectrum + showWaterfall; }
+    static float autoScaleTick(float range, float tick, int minTicks, int maxTicks);
+
+public:
+
+    /* Constructor. channels[i] holds nFrames samples of channel i and must outlive the renderer. */
+    ScopeVideoRenderer(const float *const *sessionChannels, int nChannels, long long nFrames, float fs);
+    ~ScopeVideoRenderer();
+
+    /* Setters. Returns false for invalid settings. */
+    bool setFrameSize(int w, int h);
+    bool setFrameRate(float fps);
+    bool setTimeWindow(float seconds);
+    bool setFFTSize(int size);                                  // Power of two
+    bool setSpectrumRange(float fMin, float fMax, float dBMin, float dBMax);
+    bool setWaterfallChannel(int channel);
+    void setViews(bool timeDomain, bool spectrum, bool waterfall);
+
+    /* Render every frame of the session across numWorkers threads (-1 = one per core), passing each to the callback in order on the calling thread. Returns false if the callback stopped it. */
+    bool render(ScopeVideoFrameCallback *callback, void *userData, int numWorkers = -1);
+
+    /* Render one frame (e.g. a thumbnail) into a rasterizer on the calling thread. The rasterizer is resized to the frame size. */
+    bool renderFrame(long frame, ScopeRasterizer *raster);
+
+    /* Getters */
+    long getNumVideoFrames() { return (long)(numFrames / (double)sampleRate * frameRate); }
+    int getWidth() { return width; }
+    int getHeight() { return height; }
+    float getFrameRate() { return frameRate; }
+};
+
+#endif /* ScopeVideoRenderer_hpp */
@@ -9,17 +9,67 @@
 #import <Cocoa/Cocoa.h>
 
 #import "AudioController.hpp"
+#import "ScopeFrameProducer.hpp"
+#import "OctaveBandAnalyzer.hpp"
+#import "SpectrumAverager.hpp"
+#import "ZoomSpectrumAnalyzer.hpp"
+#import "CrossChannelAnalyzer.hpp"
+#import "FeatureExtractor.hpp"
 #import "METScopeView.h"
 
 #define kScopeUpdateRate (0.05)
+#define kScopeFFTSize (2048)
+#define kScopeSpectrumOverlap (0.75f)      // A 10.7 ms hop at 48 kHz, fine enough for the onsets the feature extractor picks from the same hops
+#define kScopeSpectrumAverages (16)
+#define kScopeAnalysisBlockLength (4096)    // Frames read from the recording buffers per analyzer update
+#define kScopeSmoothingTimeMin (0.05f)      // Exponential averaging time constant range, in seconds
+#define kScopeSmoothingTimeMax (5.0f)
+#define kScopePeakDecayRateMax (60.0f)      // Peak-hold decay range, in dB/second (0 holds forever)
+#define kScopeHistoryLiveThreshold (0.05f) // Lookback in seconds close enough to the slider's right end to count as live
 
 @interface ScopeViewController : NSViewController <METScopeViewDelegate> {
 
     IBOutlet METScopeView *scopeView;
+    IBOutlet NSPopUpButton *spectrumAverageSelector;    // Frequency domain averaging mode, tagged with SpectrumAverageMode values
+    IBOutlet NSSlider *spectrumSmoothingSlider;         // Time constant or peak decay rate, depending on the mode
+    IBOutlet NSTextField *spectrumSmoothingLabel;
+    IBOutlet NSButton *zoomFFTCheckbox;                 // Zoom-FFT narrow frequency bands
+    IBOutlet NSSlider *historySlider;                   // Time domain lookback in seconds, 0 (at the right) for live
+    IBOutlet NSTextField *historyLabel;
     NSTimer *scopeClock;
     int numPlots;
     
-    float *plotTimes;
+    ScopeFrameProducer *frameProducer;  // Prepares time-domain plot data off the main thread
+    unsigned long lastFrameGeneration;  // Last scrolling frame plotted, so we only shift in new columns
+    long long lastFrameColumnEnd;
+    
+    OctaveBandAnalyzer *bandAnalyzer;   // Fractional-octave spectrum for the octave band display mode
+    long long bandReadFrame;            // Next recorded frame the analyzer hasn't seen
+    float *bandOctaves;                 // Band centers in octaves relative to kMETScopeOctaveReferenceFrequency
+    
+    SpectrumAverageMode spectrumAverageMode;    // Welch-averaged spectrum for the frequency domain display mode, from featureTracker
+    float spectrumSmoothingTime;
+    float spectrumPeakDecayRate;
+    float *spectrumMagnitude;
+    float *spectrumFrequencies;
+    
+    ZoomSpectrumAnalyzer *zoomAnalyzer;     // High-resolution spectrum of the visible band, when it's narrow enough
+    long long zoomReadFrame;
+    bool zoomEnabled;
+    float *zoomMagnitude;
+    
+    CrossChannelAnalyzer *crossAnalyzer;    // Inter-channel delays, fed on demand
+    long long crossReadFrame;
+    
+    FeatureTracker *featureTracker;         // Averaged spectrum, onsets and spectral features for every channel, on their own thread regardless of display mode
+    FeatureEventLog *featureEvents;         // Outlives the tracker, so readers can hold on to it
+    unsigned long long featureCursor;       // Our place in the log
+    NSTimer *featureClock;                  // Reads the log; the analysis itself never runs on the main thread
+    FeatureEvent latestFeatures[kMaxNumAudioChannels];
+    unsigned long onsetCounts[kMaxNumAudioChannels];
+    int numFeatureChannels;
+    
+    float *analysisScratch[kMaxNumAudioChannels];   // Recorded frames on their way to an analyzer
 }
 
 @property AudioController *audioController;
@@ -27,6 +77,15 @@
 
 - (IBAction)domainChanged:(NSSegmentedControl *)sender;
 - (IBAction)muteButtonPressed:(id)sender;
+- (IBAction)spectrumAverageModeChanged:(NSPopUpButton *)sender;
+- (IBAction)spectrumSmoothingChanged:(NSSlider *)sender;
+- (IBAction)zoomFFTToggled:(NSButton *)sender;
+- (IBAction)historySliderChanged:(NSSlider *)sender;
+- (void)setSpectrumAverageMode:(SpectrumAverageMode)mode;
+- (void)setZoomFFTEnabled:(bool)enable;
+- (bool)getDelayOfChannel:(int)a relativeTo:(int)b delay:(float *)seconds peak:(float *)peak coherence:(float *)coh;
+- (FeatureEventLog *)featureLog;
+- (bool)getFeaturesOfChannel:(int)channel latest:(FeatureEvent *)event onsets:(unsigned long *)nOnsets;
 - (void)magnifyBegan:(METScopeView*)sender;
 - (void)magnifyUpdate:(METScopeView*)sender;
 - (void)magnifyEnded:(METScopeView*)sender;
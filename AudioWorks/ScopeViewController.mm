@@ -9,7 +9,12 @@
 #import "ScopeViewController.h"
 
 @interface ScopeViewController ()
-
+- (int)readRecordedFrames:(long long *)readFrame;
+- (void)updateCrossChannelAnalyzer;
+- (void)readFeatureEvents;
+- (bool)updateZoomSpectrum;
+- (void)updateSpectrumControls;
+- (void)updateHistoryControls;
 @end
 
 @implementation ScopeViewController
@@ -25,7 +30,7 @@
     [scopeView setYLabelPosition:kMETScopeYLabelPositionOutsideLeft];
     
     [scopeView setSamplingRate:audioController->getSampleRate()];
-    [scopeView setUpFFTWithSize:2048];
+    [scopeView setUpFFTWithSize:kScopeFFTSize];
     
     [scopeView setHardXLim:-0.001 max:audioController->getRecordingBufferDuration()];
     [scopeView setVisibleXLim:-0.001 max:audioController->getAudioBufferDuration()];
@@ -34,6 +39,53 @@
     numPlots = 0;
     [self reallocatePlots];
     
+    /* Time domain plot data is decimated in parallel off the main thread */
+    frameProducer = new ScopeFrameProducer(audioController);
+    frameProducer->setScrolling(true);
+    lastFrameGeneration = 0;
+    lastFrameColumnEnd = 0;
+    frameProducer->setVisibleWindow(scopeView.visiblePlotMin.x, scopeView.visiblePlotMax.x, [scopeView plotResolution]);
+    
+    /* Octave band analyzer is created on first use, when we know the channel count and sample rate */
+    bandAnalyzer = NULL;
+    bandReadFrame = 0;
+    bandOctaves = NULL;
+    
+    /* The averaged spectrum comes from the feature tracker */
+    spectrumAverageMode = kSpectrumAverageMean;
+    spectrumSmoothingTime = 0.5f;
+    spectrumPeakDecayRate = 0.0f;
+    spectrumMagnitude = (float *)malloc(kScopeFFTSize/2 * sizeof(float));
+    spectrumFrequencies = (float *)malloc(kScopeFFTSize/2 * sizeof(float));
+    
+    /* Zoom analyzers are made for whatever band is visible */
+    zoomAnalyzer = NULL;
+    zoomReadFrame = 0;
+    zoomEnabled = true;
+    zoomMagnitude = (float *)malloc(kZoomFFTSize/2 * sizeof(float));
+    
+    crossAnalyzer = NULL;
+    crossReadFrame = 0;
+    
+    /* The spectrum and features are analyzed on their own thread, from the same hops, so they keep up whatever the scope is showing; we just read the results */
+    featureEvents = new FeatureEventLog();
+    featureTracker = new FeatureTracker(audioController, featureEvents, kScopeFFTSize, kScopeSpectrumOverlap, kScopeSpectrumAverages);
+    featureTracker->setSmoothingTime(spectrumSmoothingTime);
+    featureTracker->setPeakDecayRate(spectrumPeakDecayRate);
+    featureTracker->start();
+    featureCursor = featureEvents->getHead();
+    numFeatureChannels = 0;
+    featureClock = [NSTimer scheduledTimerWithTimeInterval:kScopeUpdateRate
+                                                    target:self
+                                                  selector:@selector(readFeatureEvents)
+                                                  userInfo:nil
+                                                   repeats:YES];
+    
+    for (int i = 0; i < kMaxNumAudioChannels; i++)
+        analysisScratch[i] = (float *)malloc(kScopeAnalysisBlockLength * sizeof(float));
+    
+    [self updateSpectrumControls];
+    [self updateHistoryControls];
     [self muteButtonPressed:self];
 }
 
@@ -41,6 +93,32 @@
     [self setScopeClockRate:kScopeUpdateRate];
 }
 
+- (void)dealloc {
+    
+    if ([scopeClock isValid])
+        [scopeClock invalidate];
+    if ([featureClock isValid])
+        [featureClock invalidate];
+    
+    delete frameProducer;
+    
+    if (bandAnalyzer)
+        delete bandAnalyzer;
+    if (bandOctaves)
+        free(bandOctaves);
+    free(spectrumMagnitude);
+    free(spectrumFrequencies);
+    if (zoomAnalyzer)
+        delete zoomAnalyzer;
+    free(zoomMagnitude);
+    if (crossAnalyzer)
+        delete crossAnalyzer;
+    delete featureTracker;     // Stops the analysis thread before the log goes away
+    delete featureEvents;
+    for (int i = 0; i < kMaxNumAudioChannels; i++)
+        free(analysisScratch[i]);
+}
+
 - (void)reallocatePlots {
     
     int nChannels = audioController->getNumInputChannels();
@@ -55,6 +133,7 @@
                                                       alpha:1.0]
                             lineWidth:2.0];
     numPlots = nChannels;
+    lastFrameGeneration = 0;    // New plots need a full frame
 }
 
 #pragma mark - Plot Updates
@@ -63,19 +142,38 @@
     if ([scopeClock isValid])
         [scopeClock invalidate];
     
-    if ([scopeView displayMode] == kMETScopeDisplayModeTimeDomain)
+    if ([scopeView displayMode] == kMETScopeDisplayModeTimeDomain) {
+        
+        /* The producer keeps running at the base rate; the timer just picks up its latest frame */
+        if (!frameProducer->isRunning())
+            frameProducer->start(kScopeUpdateRate);
+        
         scopeClock = [NSTimer scheduledTimerWithTimeInterval:rate
                                                         target:self
                                                       selector:@selector(updateTDScope)
                                                       userInfo:nil
                                                        repeats:YES];
-    else
+    }
+    else if ([scopeView displayMode] == kMETScopeDisplayModeOctaveBands) {
+        
+        frameProducer->stop();
+        
+        scopeClock = [NSTimer scheduledTimerWithTimeInterval:rate
+                                                      target:self
+                                                    selector:@selector(updateBandScope)
+                                                    userInfo:nil
+                                                     repeats:YES];
+    }
+    else {
+        
+        frameProducer->stop();
+        
         scopeClock = [NSTimer scheduledTimerWithTimeInterval:rate
                                                       target:self
                                                     selector:@selector(updateFDScope)
                                                     userInfo:nil
                                                      repeats:YES];
-    
+    }
 }
 
 - (void)updateTDScope {
@@ -86,32 +184,40 @@
     if (numPlots != audioController->getNumInputChannels())
         [self reallocatePlots];
     
-    int startIdx = fmax(scopeView.visiblePlotMin.x * audioController->getSampleRate(), 0.0f);
-    int endIdx = fmin(scopeView.visiblePlotMax.x * audioController->getSampleRate(),
-                      audioController->getRecordingBufferLength());
-    int visibleBufferLength = endIdx - startIdx;
-
-    /* Get buffer of times for each sample */
-    plotTimes = (float *)malloc(visibleBufferLength * sizeof(float));
-    [self linspace:fmax(scopeView.visiblePlotMin.x, 0.0f)
-               max:scopeView.visiblePlotMax.x
-       numElements:visibleBufferLength
-             array:plotTimes];
+    [self updateHistoryControls];
     
-    /* Allocate wet/dry signal buffers */
-    float *ybuffer = (float *)malloc(visibleBufferLength * sizeof(float));
+    /* Tell the producer what's visible, and plot the most recent frame it's finished */
+    frameProducer->setVisibleWindow(scopeView.visiblePlotMin.x, scopeView.visiblePlotMax.x, [scopeView plotResolution]);
     
-    for (int channel = 0; channel < audioController->getNumInputChannels(); channel++) {
+    const ScopeFrame *frame = frameProducer->lockLatestFrame();
+    if (!frame)
+        return;
+    
+    /* If this frame continues the last one we plotted, shift the plots and convert only the new columns */
+    int shift = 0;
+    if (frame->scrolling && frame->generation == lastFrameGeneration)
+        shift = (int)(frame->columnEnd - lastFrameColumnEnd);
+    
+    for (int channel = 0; channel < frame->numChannels && channel < numPlots; channel++) {
         
-        audioController->getRecordingBuffer((SAMPLE *)ybuffer, channel, visibleBufferLength);
-        [scopeView setPlotDataAtIndex:channel
-                             withLength:visibleBufferLength
-                                  xData:plotTimes
-                                  yData:ybuffer];
+        if (shift > 0 && [scopeView scrollPlotDataAtIndex:channel
+                                                byColumns:shift
+                                               withLength:frame->length
+                                                    yData:&frame->y[channel][0]
+                                                 envelope:frame->envelope])
+            continue;
+        
+        [scopeView setDecimatedPlotDataAtIndex:channel
+                                    withLength:frame->length
+                                         xData:&frame->x[0]
+                                         yData:&frame->y[channel][0]
+                                      envelope:frame->envelope];
     }
     
-    free(plotTimes);
-    free(ybuffer);
+    lastFrameGeneration = frame->scrolling ? frame->generation : 0;
+    lastFrameColumnEnd = frame->columnEnd;
+    
+    frameProducer->unlockLatestFrame();
 }
 
 - (void)updateFDScope {
@@ -122,30 +228,127 @@
     if (numPlots != audioController->getNumInputChannels())
         [self reallocatePlots];
     
+    /* Narrow visible bands get a zoom-FFT instead. The averager keeps running on the feature thread meanwhile, so zooming back out shows a current average. */
+    if ([self updateZoomSpectrum])
+        return;
+    
+    /* Every hop recorded goes through the averager exactly once, on the feature tracker's thread; we just copy out the result */
+    int nChannels = audioController->getNumInputChannels();
+    for (int channel = 0; channel < nChannels; channel++) {
+        
+        int nBins = featureTracker->getMagnitude(channel, spectrumAverageMode, spectrumMagnitude, spectrumFrequencies, kScopeFFTSize/2);
+        if (nBins > 0)
+            [scopeView setCoordinatesInFDModeAtIndex:channel
+                                          withLength:nBins
+                                               xData:spectrumFrequencies
+                                               yData:spectrumMagnitude];
+    }
+}
+
+/* Plot a zoom-FFT of the visible band if it's narrow enough to be worth it. Returns false if the full-band spectrum should be plotted instead. */
+- (bool)updateZoomSpectrum {
+    
     int nChannels = audioController->getNumInputChannels();
-    int bufferLength = audioController->getAudioBufferLength();
     float sampleRate = audioController->getSampleRate();
+    float fMin = scopeView.visiblePlotMin.x;
+    float fMax = scopeView.visiblePlotMax.x;
+    
+    if (!zoomEnabled || !ZoomSpectrumAnalyzer::bandIsZoomable(sampleRate, fMin, fMax)) {
+        if (zoomAnalyzer) {
+            delete zoomAnalyzer;
+            zoomAnalyzer = NULL;
+        }
+        return false;
+    }
     
-    /* Get buffer of times for each sample */
-    plotTimes = (float *)malloc(bufferLength * sizeof(float));
-    [self linspace:0.0 max:(bufferLength * sampleRate) numElements:bufferLength array:plotTimes];
+    /* The analyzed band only has to cover the visible one. Rebuild when the view moves outside it or zooms in far enough to want finer bins, not on every small pan or pinch. */
+    bool bandChanged = true;
+    if (zoomAnalyzer) {
+        float analyzedWidth = zoomAnalyzer->getMaxFrequency() - zoomAnalyzer->getMinFrequency();
+        bandChanged = zoomAnalyzer->getMinFrequency() > fmaxf(fMin, 0.0f) ||
+                      zoomAnalyzer->getMaxFrequency() < fminf(fMax, sampleRate / 2.0f) ||
+                      analyzedWidth > kZoomRebuildWidthRatio * (fMax - fMin);
+    }
     
-    /* Allocate wet/dry signal buffers */
-    float *ybuffer = (float *)malloc(bufferLength * sizeof(float));
+    /* (Re)create the analyzer if the view or stream changed, and prime it with enough recording history for a full spectrum */
+    if (!zoomAnalyzer || bandChanged || zoomAnalyzer->getNumChannels() != nChannels ||
+        zoomAnalyzer->getSampleRate() != sampleRate ||
+        audioController->getNumRecordedFrames() < zoomReadFrame) {
+        
+        /* Leave some room around the visible band, if it's still narrow enough to zoom */
+        float margin = kZoomBandMargin * (fMax - fMin);
+        float bandMin = fmaxf(fMin - margin, 0.0f);
+        float bandMax = fminf(fMax + margin, sampleRate / 2.0f);
+        if (!ZoomSpectrumAnalyzer::bandIsZoomable(sampleRate, bandMin, bandMax)) {
+            bandMin = fMin;
+            bandMax = fMax;
+        }
+        
+        if (zoomAnalyzer)
+            delete zoomAnalyzer;
+        zoomAnalyzer = new ZoomSpectrumAnalyzer(sampleRate, nChannels, bandMin, bandMax);
+        zoomReadFrame = (long long)audioController->getNumRecordedFrames() - zoomAnalyzer->getPrimingLength();
+    }
+    
+    int length;
+    while ((length = [self readRecordedFrames:&zoomReadFrame]) > 0)
+        zoomAnalyzer->process(analysisScratch, length);
     
     for (int channel = 0; channel < nChannels; channel++) {
+        
+        zoomAnalyzer->getMagnitude(channel, zoomMagnitude);
+        [scopeView setCoordinatesInFDModeAtIndex:channel
+                                      withLength:zoomAnalyzer->getNumBins()
+                                           xData:(float *)zoomAnalyzer->getBinFrequencies()
+                                           yData:zoomMagnitude];
+    }
+    
+    return true;
+}
+
+- (void)updateBandScope {
+    
+    if ([scopeView currentPan] || [scopeView currentMagnify])
+        return;
     
-        /* Get current visible samples from the audio controller */
-        audioController->getRecordingBuffer((SAMPLE *)ybuffer, channel, bufferLength);
+    if (numPlots != audioController->getNumInputChannels())
+        [self reallocatePlots];
+    
+    int nChannels = audioController->getNumInputChannels();
+    float sampleRate = audioController->getSampleRate();
+    
+    /* (Re)create the analyzer if the stream changed, and prime it with just enough recording history for the lowest octave to fill in right away */
+    if (!bandAnalyzer || bandAnalyzer->getNumChannels() != nChannels ||
+        bandAnalyzer->getSampleRate() != sampleRate ||
+        audioController->getNumRecordedFrames() < bandReadFrame) {
+        
+        if (bandAnalyzer)
+            delete bandAnalyzer;
+        bandAnalyzer = new OctaveBandAnalyzer(sampleRate, nChannels);
         
-        [scopeView setPlotDataAtIndex:channel
-                             withLength:bufferLength
-                                  xData:plotTimes
-                                  yData:ybuffer];
+        if (bandOctaves)
+            free(bandOctaves);
+        int nBands = bandAnalyzer->getNumBands();
+        bandOctaves = (float *)malloc(nBands * sizeof(float));
+        const float *centers = bandAnalyzer->getBandCenters();
+        for (int i = 0; i < nBands; i++)
+            bandOctaves[i] = log2f(centers[i] / kMETScopeOctaveReferenceFrequency);
+        
+        bandReadFrame = (long long)audioController->getNumRecordedFrames() - bandAnalyzer->getPrimingLength();
     }
     
-    free(plotTimes);
-    free(ybuffer);
+    /* Feed the analyzer everything recorded since the last update */
+    int length;
+    while ((length = [self readRecordedFrames:&bandReadFrame]) > 0)
+        bandAnalyzer->process(analysisScratch, length);
+    
+    bandAnalyzer->computeBands();
+    
+    for (int channel = 0; channel < nChannels; channel++)
+        [scopeView setCoordinatesInFDModeAtIndex:channel
+                                      withLength:bandAnalyzer->getNumBands()
+                                           xData:bandOctaves
+                                           yData:(float *)bandAnalyzer->getBandMagnitudes(channel)];
 }
 
 
@@ -160,19 +363,225 @@
         case 1:
             [scopeView setDisplayMode:kMETScopeDisplayModeFrequencyDomain];
             break;
+        case 2:
+            [scopeView setDisplayMode:kMETScopeDisplayModeOctaveBands];
+            break;
         default:
             return;
     }
     
+    [self updateSpectrumControls];
+    [self updateHistoryControls];
     [self setScopeClockRate:kScopeUpdateRate];
 }
 
-- (IBAction)muteButtonPressed:(id)sender {
+#pragma mark - History
+/* Look back from the live input. The window stays put at the chosen moment while recording goes on; older than the recording buffers, it's decoded from the compressed history (if enabled in Preferences). */
+- (IBAction)historySliderChanged:(NSSlider *)sender {
     
-    if (audioController->getOutputGain() == 1.0)
-        audioController->setOutputGain(0.0);
+    float secondsBack = -[sender floatValue];
+    if (secondsBack < kScopeHistoryLiveThreshold)
+        frameProducer->setEndFrame(kScopeFrameLive);
     else
-        audioController->setOutputGain(1.0);
+        frameProducer->setEndFrame((long long)audioController->getNumRecordedFrames() - (long long)(secondsBack * audioController->getSampleRate()));
+    
+    [self updateHistoryControls];
+}
+
+/* Show the lookback slider in the time domain, with its range covering everything we can still read back */
+- (void)updateHistoryControls {
+    
+    bool timeDomain = [scopeView displayMode] == kMETScopeDisplayModeTimeDomain;
+    [historySlider setHidden:!timeDomain];
+    [historyLabel setHidden:!timeDomain];
+    if (!timeDomain)
+        return;
+    
+    float sampleRate = audioController->getSampleRate();
+    long long recorded = (long long)audioController->getNumRecordedFrames();
+    long long oldest = audioController->getOldestHistoryFrame();
+    long long end = frameProducer->getEndFrame();
+    
+    /* Older than we can read any more (e.g. the history was turned off); go back to live */
+    if (end != kScopeFrameLive && (end < oldest || end > recorded)) {
+        frameProducer->setEndFrame(kScopeFrameLive);
+        end = kScopeFrameLive;
+    }
+    
+    float secondsBack = end == kScopeFrameLive ? 0.0f : (recorded - end) / sampleRate;
+    [historySlider setMinValue:-(recorded - oldest) / sampleRate];
+    [historySlider setMaxValue:0.0];
+    [historySlider setFloatValue:-secondsBack];
+    
+    if (end == kScopeFrameLive)
+        [historyLabel setStringValue:@"Live"];
+    else if (secondsBack < 60.0f)
+        [historyLabel setStringValue:[NSString stringWithFormat:@"%.1f s ago", secondsBack]];
+    else
+        [historyLabel setStringValue:[NSString stringWithFormat:@"%d:%02d ago", (int)secondsBack / 60, (int)secondsBack % 60]];
+}
+
+#pragma mark - Spectrum Averaging
+- (IBAction)spectrumAverageModeChanged:(NSPopUpButton *)sender {
+    [self setSpectrumAverageMode:(SpectrumAverageMode)[sender selectedTag]];
+}
+
+/* The slider sets the exponential time constant or the peak-hold decay rate, whichever the current mode uses */
+- (IBAction)spectrumSmoothingChanged:(NSSlider *)sender {
+    
+    if (spectrumAverageMode == kSpectrumAverageExponential) {
+        spectrumSmoothingTime = [sender floatValue];
+        featureTracker->setSmoothingTime(spectrumSmoothingTime);
+    }
+    else if (spectrumAverageMode == kSpectrumAveragePeakHold) {
+        spectrumPeakDecayRate = [sender floatValue];
+        featureTracker->setPeakDecayRate(spectrumPeakDecayRate);
+    }
+    
+    [self updateSpectrumControls];
+}
+
+/* Every segment updates all of the averager's accumulators, so switching modes shows the new one's history right away */
+- (void)setSpectrumAverageMode:(SpectrumAverageMode)mode {
+    spectrumAverageMode = mode;
+    [self updateSpectrumControls];
+}
+
+/* Show the averaging controls in the frequency domain, and point the slider at whichever parameter the mode uses */
+- (void)updateSpectrumControls {
+    
+    bool frequencyDomain = [scopeView displayMode] == kMETScopeDisplayModeFrequencyDomain;
+    [spectrumAverageSelector setHidden:!frequencyDomain];
+    [spectrumAverageSelector selectItemWithTag:spectrumAverageMode];
+    
+    switch (spectrumAverageMode) {
+            
+        case kSpectrumAverageExponential:
+            [spectrumSmoothingSlider setMinValue:kScopeSmoothingTimeMin];
+            [spectrumSmoothingSlider setMaxValue:kScopeSmoothingTimeMax];
+            [spectrumSmoothingSlider setFloatValue:spectrumSmoothingTime];
+            [spectrumSmoothingLabel setStringValue:[NSString stringWithFormat:@"%.2f s", spectrumSmoothingTime]];
+            break;
+        case kSpectrumAveragePeakHold:
+            [spectrumSmoothingSlider setMinValue:0.0];
+            [spectrumSmoothingSlider setMaxValue:kScopePeakDecayRateMax];
+            [spectrumSmoothingSlider setFloatValue:spectrumPeakDecayRate];
+            [spectrumSmoothingLabel setStringValue:spectrumPeakDecayRate > 0.0f ? [NSString stringWithFormat:@"%.0f dB/s", spectrumPeakDecayRate] : @"Hold"];
+            break;
+        default:
+            break;
+    }
+    
+    [zoomFFTCheckbox setHidden:!frequencyDomain];
+    [zoomFFTCheckbox setState:zoomEnabled ? NSOnState : NSOffState];
+    
+    bool adjustable = frequencyDomain && (spectrumAverageMode == kSpectrumAverageExponential || spectrumAverageMode == kSpectrumAveragePeakHold);
+    [spectrumSmoothingSlider setHidden:!adjustable];
+    [spectrumSmoothingLabel setHidden:!adjustable];
+}
+
+- (IBAction)zoomFFTToggled:(NSButton *)sender {
+    [self setZoomFFTEnabled:[sender state] == NSOnState];
+}
+
+/* When enabled, zooming the frequency domain view in on a narrow enough band switches to a zoom-FFT of that band. The next update drops any zoom analyzer when it's disabled. */
+- (void)setZoomFFTEnabled:(bool)enable {
+    zoomEnabled = enable;
+    [self updateSpectrumControls];
+}
+
+#pragma mark - Channel Alignment
+/* Delay of channel a relative to channel b in seconds (positive if a lags b), with the GCC-PHAT peak height and mean coherence of the pair. Cheap enough to call for every pair at display rate. */
+- (bool)getDelayOfChannel:(int)a relativeTo:(int)b delay:(float *)seconds peak:(float *)peak coherence:(float *)coh {
+    
+    int nChannels = audioController->getNumInputChannels();
+    if (a < 0 || b < 0 || a >= nChannels || b >= nChannels || a == b)
+        return false;
+    
+    [self updateCrossChannelAnalyzer];
+    
+    if (seconds)    *seconds = crossAnalyzer->getDelay(a, b);
+    if (peak)       *peak = crossAnalyzer->getCorrelationPeak(a, b);
+    if (coh)        *coh = crossAnalyzer->getCoherence(a, b);
+    return true;
+}
+
+/* Feed the cross-channel analyzer everything recorded since it was last asked for delays. Nothing runs unless someone asks. */
+- (void)updateCrossChannelAnalyzer {
+    
+    int nChannels = audioController->getNumInputChannels();
+    float sampleRate = audioController->getSampleRate();
+    long long recorded = audioController->getNumRecordedFrames();
+    
+    /* (Re)create the analyzer if the stream changed, and prime it with about one smoothing time constant of recording history */
+    if (!crossAnalyzer || crossAnalyzer->getNumChannels() != nChannels ||
+        crossAnalyzer->getSampleRate() != sampleRate ||
+        recorded < crossReadFrame) {
+        
+        if (crossAnalyzer)
+            delete crossAnalyzer;
+        crossAnalyzer = new CrossChannelAnalyzer(sampleRate, nChannels);
+        crossReadFrame = recorded - crossAnalyzer->getPrimingLength();
+    }
+    
+    /* Asked again after a long pause; anything older would be mostly smoothed away, so start over from the same bounded window */
+    else if (crossReadFrame < recorded - crossAnalyzer->getPrimingLength()) {
+        crossAnalyzer->reset();
+        crossReadFrame = recorded - crossAnalyzer->getPrimingLength();
+    }
+    
+    int length;
+    while ((length = [self readRecordedFrames:&crossReadFrame]) > 0)
+        crossAnalyzer->process(analysisScratch, length);
+    
+    crossAnalyzer->computeCorrelations();
+}
+
+/* Events from the feature extractor. The log can be read from any thread; readers keep their own cursors (start from getHead()). Channel numbers in events refer to the channel layout at the time of the event. */
+- (FeatureEventLog *)featureLog {
+    return featureEvents;
+}
+
+/* Most recent features and onset count of a channel, from the events read so far. Returns false if we haven't seen any for it. */
+- (bool)getFeaturesOfChannel:(int)channel latest:(FeatureEvent *)event onsets:(unsigned long *)nOnsets {
+    
+    if (channel < 0 || channel >= numFeatureChannels || latestFeatures[channel].frame == 0)
+        return false;
+    
+    *event = latestFeatures[channel];
+    *nOnsets = onsetCounts[channel];
+    return true;
+}
+
+/* Catch up on the feature log */
+- (void)readFeatureEvents {
+    
+    /* Channel numbers in older events refer to the old layout */
+    int nChannels = audioController->getNumInputChannels();
+    if (nChannels != numFeatureChannels) {
+        memset(latestFeatures, 0, sizeof(latestFeatures));
+        memset(onsetCounts, 0, sizeof(onsetCounts));
+        numFeatureChannels = nChannels;
+    }
+    
+    FeatureEvent events[256];
+    int n;
+    while ((n = featureEvents->read(&featureCursor, events, 256)) > 0) {
+        for (int i = 0; i < n; i++) {
+            int channel = events[i].channel;
+            if (channel >= numFeatureChannels)
+                continue;
+            if (events[i].type == kFeatureEventOnset)
+                onsetCounts[channel]++;
+            else
+                latestFeatures[channel] = events[i];
+        }
+    }
+}
+
+- (IBAction)muteButtonPressed:(id)sender {
+    
+    audioController->setMuted(!audioController->getMuted());
 }
 
 
@@ -198,6 +607,28 @@
 
 
 #pragma mark - Utility
+/* Read up to kScopeAnalysisBlockLength frames recorded since *readFrame into analysisScratch for all input channels and advance *readFrame past them. Frames that have already fallen out of the recording buffers are skipped. Returns the number of frames read. */
+- (int)readRecordedFrames:(long long *)readFrame {
+    
+    long long recorded = audioController->getNumRecordedFrames();
+    long long oldest = recorded - audioController->getRecordingBufferLength();
+    
+    if (*readFrame < oldest)
+        *readFrame = oldest;
+    if (*readFrame < 0)
+        *readFrame = 0;
+    
+    int length = (int)(recorded - *readFrame);
+    length = length > kScopeAnalysisBlockLength ? kScopeAnalysisBlockLength : length;
+    if (length <= 0)
+        return 0;
+    
+    audioController->getRecordingBuffersFrom((SAMPLE **)analysisScratch, audioController->getNumInputChannels(), *readFrame, length);
+    
+    *readFrame += length;
+    return length;
+}
+
 /* Generate a linearly-spaced set of indices for sampling an incoming waveform */
 - (void)linspace:(float)minVal max:(float)maxVal numElements:(int)size array:(float *)array {
     
@@ -0,0 +1,245 @@
+//
+//  SpectrumAverager.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "SpectrumAverager.hpp"
+#include "FeatureExtractor.hpp"
+
+SpectrumAverager::SpectrumAverager(float fs, int nChannels, int nFFT, float overlap, int nAverages) : sampleRate(fs), numChannels(nChannels), fftSize(2048), hopSize(1024), numAverages(nAverages), segmentFill(0), numSegments(0), nextFrame(0), meanHead(0), meanCount(0), smoothingTime(0.5f), peakDecayRate(0.0f), fftPlan(NULL), features(NULL) {
+
+    if (!FFTPlanCache::isSupportedSize(nFFT)) {
+        printf("%s: Invalid FFT size %d. Must be f * 2^n for f in {1, 3, 5, 15} and n >= %d. Using %d.\n", __PRETTY_FUNCTION__, nFFT, kFFTMinLog2Size, fftSize);
+        nFFT = fftSize;
+    }
+    fftSize = nFFT;
+    numBins = fftSize / 2;
+
+    if (numAverages < 1 || numAverages > kSpectrumMaxAverages) {
+        printf("%s: Invalid number of averages %d. Using 8.\n", __PRETTY_FUNCTION__, numAverages);
+        numAverages = 8;
+    }
+
+    segments.resize(numChannels);
+    latest.resize(numChannels);
+    meanRing.resize(numChannels);
+    meanSum.resize(numChannels);
+    exponential.resize(numChannels);
+    peak.resize(numChannels);
+    for (int i = 0; i < numChannels; i++) {
+        segments[i].assign(fftSize, 0.0f);
+        latest[i].assign(numBins, 0.0f);
+        meanRing[i].assign(numAverages * numBins, 0.0f);
+        meanSum[i].assign(numBins, 0.0f);
+        exponential[i].assign(numBins, 0.0f);
+        peak[i].assign(numBins, 0.0f);
+    }
+
+    /* Hann-windowed plan */
+    power.resize(numBins);
+    fftPlan = fftPlans.getPlan(fftSize, kFFTWindowHann);
+
+    binFrequencies.resize(numBins);
+    for (int i = 0; i < numBins; i++)
+        binFrequencies[i] = i * sampleRate / fftSize;
+
+    /* vDSP's real transforms scale by 2; with the Hann window's coherent gain of 1/2 this puts a sinusoid's peak bin at its amplitude */
+    scale = 2.0f / fftSize;
+
+    if (!setOverlap(overlap))
+        setOverlap(0.5f);
+}
+
+#pragma mark - Interface Methods
+void SpectrumAverager::process(const float * const *input, int length) {
+
+    int offset = 0;
+    while (offset < length) {
+
+        /* Fill the current segment */
+        int n = fftSize - segmentFill;
+        n = n > length - offset ? length - offset : n;
+
+        for (int channel = 0; channel < numChannels; channel++)
+            memcpy(&segments[channel][segmentFill], input[channel] + offset, n * sizeof(float));
+
+        segmentFill += n;
+        offset += n;
+
+        if (segmentFill < fftSize)
+            break;
+
+        /* Complete segment: analyze it, then slide forward by one hop */
+        unsigned long long centerFrame = nextFrame + offset - fftSize / 2;
+        for (int channel = 0; channel < numChannels; channel++) {
+            analyzeSegment(channel);
+            if (features)
+                features->analyzeSpectrum(channel, &segments[channel][0], &power[0], centerFrame);
+            memmove(&segments[channel][0], &segments[channel][hopSize], (fftSize - hopSize) * sizeof(float));
+        }
+
+        meanHead = (meanHead + 1) % numAverages;
+        meanCount = meanCount < numAverages ? meanCount + 1 : numAverages;
+        numSegments++;
+        segmentFill = fftSize - hopSize;
+    }
+
+    nextFrame += length;
+}
+
+void SpectrumAverager::reset() {
+
+    segmentFill = 0;
+    numSegments = 0;
+    meanHead = 0;
+    meanCount = 0;
+
+    for (int i = 0; i < numChannels; i++) {
+        vDSP_vclr(&segments[i][0], 1, fftSize);
+        vDSP_vclr(&latest[i][0], 1, numBins);
+        vDSP_vclr(&meanRing[i][0], 1, numAverages * numBins);
+        vDSP_vclr(&meanSum[i][0], 1, numBins);
+        vDSP_vclr(&exponential[i][0], 1, numBins);
+        vDSP_vclr(&peak[i][0], 1, numBins);
+    }
+}
+
+bool SpectrumAverager::setFeatureExtractor(FeatureExtractor *extractor) {
+
+    if (extractor && (extractor->getFFTSize() != fftSize || extractor->getHopSize() != hopSize || extractor->getNumChannels() != numChannels)) {
+        printf("%s: Feature extractor (FFT %d, hop %d, %d channels) doesn't match (FFT %d, hop %d, %d channels)\n", __PRETTY_FUNCTION__, extractor->getFFTSize(), extractor->getHopSize(), extractor->getNumChannels(), fftSize, hopSize, numChannels);
+        return false;
+    }
+
+    features = extractor;
+    return true;
+}
+
+bool SpectrumAverager::setOverlap(float overlap) {
+
+    if (overlap < 0.0f || overlap > kSpectrumMaxOverlap) {
+        printf("%s: Invalid overlap %f. Must be in [0, %f]\n", __PRETTY_FUNCTION__, overlap, kSpectrumMaxOverlap);
+        return false;
+    }
+
+    int hop = (int)floorf(fftSize * (1.0f - overlap) + 0.5f);
+    hopSize = hop < 1 ? 1 : hop;
+
+    if (features && features->getHopSize() != hopSize)
+        features = NULL;
+
+    updateCoefficients();
+    reset();
+    return true;
+}
+
+bool SpectrumAverager::setNumAverages(int nAverages) {
+
+    if (nAverages < 1 || nAverages > kSpectrumMaxAverages) {
+        printf("%s: Invalid number of averages %d. Must be in [1, %d]\n", __PRETTY_FUNCTION__, nAverages, kSpectrumMaxAverages);
+        return false;
+    }
+
+    numAverages = nAverages;
+    for (int i = 0; i < numChannels; i++)
+        meanRing[i].assign(numAverages * numBins, 0.0f);
+
+    reset();
+    return true;
+}
+
+void SpectrumAverager::setSmoothingTime(float seconds) {
+    smoothingTime = seconds < 0.0f ? 0.0f : seconds;
+    updateCoefficients();
+}
+
+void SpectrumAverager::setPeakDecayRate(float dBPerSecond) {
+    peakDecayRate = dBPerSecond < 0.0f ? 0.0f : dBPerSecond;
+    updateCoefficients();
+}
+
+bool SpectrumAverager::getMagnitude(int channel, SpectrumAverageMode mode, float *magnitude) {
+
+    if (channel < 0 || channel >= numChannels) {
+        printf("%s: Invalid channel index %d. %d channels.\n", __PRETTY_FUNCTION__, channel, numChannels);
+        return false;
+    }
+
+    const float *src;
+    float gain = 1.0f;
+
+    switch (mode) {
+        case kSpectrumAverageMean:
+            src = &meanSum[channel][0];
+            gain = meanCount > 0 ? 1.0f / meanCount : 0.0f;
+            break;
+        case kSpectrumAverageExponential:
+            src = &exponential[channel][0];
+            break;
+        case kSpectrumAveragePeakHold:
+            src = &peak[channel][0];
+            break;
+        default:
+            src = &latest[channel][0];
+            break;
+    }
+
+    for (int i = 0; i < numBins; i++)
+        magnitude[i] = sqrtf(src[i] * gain) * scale;
+
+    return true;
+}
+
+#pragma mark - Private Methods
+/* Power spectrum of a channel's current segment, folded into every accumulator */
+void SpectrumAverager::analyzeSegment(int channel) {
+
+    fftPlan->computePower(&segments[channel][0], fftSize, &power[0]);
+
+    const float *p = &power[0];
+    memcpy(&latest[channel][0], p, numBins * sizeof(float));
+
+    /* Running mean: swap this segment into the ring in place of the oldest one */
+    float *slot = &meanRing[channel][meanHead * numBins];
+    float *sum = &meanSum[channel][0];
+    if (meanCount == numAverages)
+        vDSP_vsub(slot, 1, sum, 1, sum, 1, numBins);
+    memcpy(slot, p, numBins * sizeof(float));
+
+    /* Re-sum the ring once per pass so float error in the running sum doesn't build up */
+    if (meanHead == numAverages - 1) {
+        memcpy(sum, &meanRing[channel][0], numBins * sizeof(float));
+        for (int i = 1; i < numAverages; i++)
+            vDSP_vadd(sum, 1, &meanRing[channel][i * numBins], 1, sum, 1, numBins);
+    }
+    else
+        vDSP_vadd(sum, 1, p, 1, sum, 1, numBins);
+
+    /* Exponential and peak-hold start from the first segment */
+    float *ema = &exponential[channel][0];
+    float *pk = &peak[channel][0];
+    if (numSegments == 0) {
+        memcpy(ema, p, numBins * sizeof(float));
+        memcpy(pk, p, numBins * sizeof(float));
+        return;
+    }
+
+    float oneMinus = 1.0f - expCoefficient;
+    vDSP_vsmsma(ema, 1, &expCoefficient, p, 1, &oneMinus, ema, 1, numBins);
+
+    if (peakCoefficient < 1.0f)
+        vDSP_vsmul(pk, 1, &peakCoefficient, pk, 1, numBins);
+    vDSP_vmax(pk, 1, p, 1, pk, 1, numBins);
+}
+
+/* Per-segment exponential weight and peak decay (in power) for the current hop */
+void SpectrumAverager::updateCoefficients() {
+
+    float hopTime = hopSize / sampleRate;
+
+    expCoefficient = smoothingTime > 0.0f ? expf(-hopTime / smoothingTime) : 0.0f;
+    peakCoefficient = powf(10.0f, -peakDecayRate * hopTime / 10.0f);
+}
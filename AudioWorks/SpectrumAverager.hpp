@@ -0,0 +1,116 @@
+//
+//  SpectrumAverager.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef SpectrumAverager_hpp
+#define SpectrumAverager_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <Accelerate/Accelerate.h>
+#include <vector>
+#include "FFTPlanCache.hpp"
+
+#define kSpectrumMaxAverages (64)           // Longest running mean, in segments
+#define kSpectrumMaxOverlap (0.9375f)       // Hop is at least 1/16 of the FFT
+
+typedef enum SpectrumAverageMode {
+    kSpectrumAverageNone,           // Most recent segment only
+    kSpectrumAverageMean,           // Mean of the last numAverages segments (Welch)
+    kSpectrumAverageExponential,    // Exponentially-weighted mean
+    kSpectrumAveragePeakHold        // Per-bin maximum, optionally decaying
+} SpectrumAverageMode;
+
+class FeatureExtractor;
+
+/* Welch-style power spectrum averager for all input channels.
+
+    Input is cut into Hann-windowed segments of fftSize samples (any size FFTPlanCache supports, so segments can match exact time spans) spaced hopSize apart, and each segment's power spectrum is computed exactly once, as soon as its last sample arrives. Every segment updates all of the accumulators (latest, running mean, exponential and peak-hold), so switching modes doesn't lose history. An attached FeatureExtractor gets every segment's power spectrum too, so features don't need FFTs of their own. All buffers are allocated up front; process() doesn't allocate. */
+class SpectrumAverager {
+
+    float sampleRate;
+    int numChannels;
+    int fftSize;
+    int numBins;
+    int hopSize;
+    int numAverages;
+
+    /* Input segment, shared fill count across channels */
+    std::vector<std::vector<float> > segments;
+    int segmentFill;
+    unsigned long numSegments;      // Segments analyzed since the last reset
+    unsigned long long nextFrame;   // Absolute frame of the next input sample
+
+    /* Accumulators, one row per channel, numBins power values each */
+    std::vector<std::vector<float> > latest;
+    std::vector<std::vector<float> > meanRing;      // numAverages spectra per channel
+    std::vector<std::vector<float> > meanSum;
+    std::vector<std::vector<float> > exponential;
+    std::vector<std::vector<float> > peak;
+    int meanHead;
+    int meanCount;
+
+    /* Smoothing */
+    float smoothingTime;            // Exponential time constant in seconds
+    float peakDecayRate;            // Peak-hold decay in dB/second (0 holds forever)
+    float expCoefficient;           // Per-segment weights derived from the above and the hop
+    float peakCoefficient;
+
+    /* FFT */
+    FFTPlanCache fftPlans;
+    FFTPlan *fftPlan;               // fftSize, Hann window
+    std::vector<float> power;
+    std::vector<float> binFrequencies;
+    float scale;
+
+    FeatureExtractor *features;
+
+#pragma mark - Private Methods
+    void analyzeSegment(int channel);
+    void updateCoefficients();
+
+public:
+
+    /* Constructor/Destructor */
+    SpectrumAverager(float fs, int nChannels, int nFFT = 2048, float overlap = 0.5f, int nAverages = 8);
+    ~SpectrumAverager() {}
+
+    /* Push a block of non-interleaved input, one row per channel */
+    void process(const float * const *input, int length);
+
+    /* Clear all accumulators and any partial segment */
+    void reset();
+
+    /* Absolute frame number of the next sample passed to process(), e.g. after skipping input. Only used to stamp feature events. */
+    void setNextFrame(unsigned long long frame) { nextFrame = frame; }
+
+    /* Pass every segment's power spectrum on to a feature extractor with the same FFT size, hop and channel count, or NULL to stop. The caller owns it. */
+    bool setFeatureExtractor(FeatureExtractor *extractor);
+
+    /* Setters. Changing the overlap or number of averages resets the accumulators. Changing the overlap detaches the feature extractor. */
+    bool setOverlap(float overlap);
+    bool setNumAverages(int nAverages);
+    void setSmoothingTime(float seconds);
+    void setPeakDecayRate(float dBPerSecond);
+
+    /* Write numBins magnitudes for a channel, scaled so a sinusoid's peak bin reads its amplitude (as in -[METScopeView computeMagnitudeFFT:]) */
+    bool getMagnitude(int channel, SpectrumAverageMode mode, float *magnitude);
+
+    /* Getters */
+    int getNumChannels() { return numChannels; }
+    int getFFTSize() { return fftSize; }
+    int getNumBins() { return numBins; }
+    int getHopSize() { return hopSize; }
+    int getNumAverages() { return numAverages; }
+    int getPrimingLength() { return fftSize + (numAverages - 1) * hopSize; }   // Input samples behind a full mean of numAverages segments
+    float getSampleRate() { return sampleRate; }
+    unsigned long getNumSegments() { return numSegments; }
+    const float *getBinFrequencies() { return &binFrequencies[0]; }
+};
+
+#endif /* SpectrumAverager_hpp */
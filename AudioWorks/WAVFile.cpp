@@ -0,0 +1,112 @@
+//
+//  WAVFile.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "WAVFile.hpp"
+
+WAVFile::WAVFile(std::string filePath) : path(filePath), numChannels(0), numFrames(0), sampleRate(0.0) {}
+
+/* Minimal RIFF/WAVE reader: finds the 'fmt ' and 'data' chunks and converts the samples to float */
+bool WAVFile::load() {
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        printf("%s: Couldn't open %s\n", __PRETTY_FUNCTION__, path.c_str());
+        return false;
+    }
+
+    unsigned char header[12];
+    if (fread(header, 1, 12, file) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) {
+        printf("%s: %s is not a WAV file\n", __PRETTY_FUNCTION__, path.c_str());
+        fclose(file);
+        return false;
+    }
+
+    int format = 0, bitsPerSample = 0;
+    bool haveFormat = false;
+    std::vector<unsigned char> data;
+
+    unsigned char chunk[8];
+    while (fread(chunk, 1, 8, file) == 8) {
+
+        unsigned int chunkLength = readLittleEndian(chunk + 4, 4);
+        std::vector<unsigned char> body(chunkLength);
+        if (fread(body.data(), 1, chunkLength, file) != chunkLength)
+            break;
+        if (chunkLength & 1)
+            fseek(file, 1, SEEK_CUR);       // Chunks are padded to even lengths
+
+        if (!memcmp(chunk, "fmt ", 4) && chunkLength >= 16) {
+            format = readLittleEndian(&body[0], 2);
+            numChannels = readLittleEndian(&body[2], 2);
+            sampleRate = readLittleEndian(&body[4], 4);
+            bitsPerSample = readLittleEndian(&body[14], 2);
+            if (format == 0xFFFE && chunkLength >= 26)
+                format = readLittleEndian(&body[24], 2);    // WAVE_FORMAT_EXTENSIBLE: subformat GUID starts with the format tag
+            haveFormat = true;
+        }
+        else if (!memcmp(chunk, "data", 4)) {
+            data.swap(body);
+            break;
+        }
+    }
+    fclose(file);
+
+    bool isInteger = format == 1 && (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+    bool isFloat = format == 3 && bitsPerSample == 32;
+
+    if (!haveFormat || numChannels <= 0 || sampleRate <= 0.0 || !(isInteger || isFloat)) {
+        printf("%s: Unsupported format in %s (format %d, %d channels, %d bits)\n", __PRETTY_FUNCTION__, path.c_str(), format, numChannels, bitsPerSample);
+        numChannels = 0;
+        return false;
+    }
+
+    int bytesPerSample = bitsPerSample / 8;
+    numFrames = (int)(data.size() / (bytesPerSample * numChannels));
+    if (numFrames == 0) {
+        printf("%s: No audio in %s\n", __PRETTY_FUNCTION__, path.c_str());
+        return false;
+    }
+
+    samples.resize((size_t)numFrames * numChannels);
+    const unsigned char *src = data.data();
+    for (size_t i = 0; i < samples.size(); i++, src += bytesPerSample) {
+        unsigned int bits = readLittleEndian(src, bytesPerSample);
+        if (isFloat) {
+            float f;
+            memcpy(&f, &bits, sizeof(float));
+            samples[i] = f;
+        }
+        else {
+            /* Left-justify and sign-extend to 32 bits */
+            int32_t value = (int32_t)(bits << (32 - bitsPerSample));
+            samples[i] = value / 2147483648.0f;
+        }
+    }
+
+    return true;
+}
+
+/* Copy one channel out of the interleaved samples */
+void WAVFile::getChannel(int channel, float *outBuffer) {
+
+    if (channel < 0 || channel >= numChannels) {
+        printf("%s: Invalid channel %d. %d channels.\n", __PRETTY_FUNCTION__, channel, numChannels);
+        return;
+    }
+
+    for (int i = 0; i < numFrames; i++)
+        outBuffer[i] = samples[(size_t)i * numChannels + channel];
+}
+
+unsigned int WAVFile::readLittleEndian(const unsigned char *bytes, int numBytes) {
+
+    unsigned int value = 0;
+    for (int i = numBytes - 1; i >= 0; i--)
+        value = (value << 8) | bytes[i];
+    return value;
+}
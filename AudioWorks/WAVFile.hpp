@@ -0,0 +1,49 @@
+//
+//  WAVFile.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef WAVFile_hpp
+#define WAVFile_hpp
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+/* A whole PCM WAV file in memory as interleaved floats. Reads 16/24/32-bit integer and 32-bit float PCM. Has no platform dependencies, so the command line tools can use it as well as FileInputDevice. */
+class WAVFile {
+
+    std::string path;
+    std::vector<float> samples;     // Interleaved
+    int numChannels;
+    int numFrames;
+    double sampleRate;
+
+#pragma mark - Private Methods
+    static unsigned int readLittleEndian(const unsigned char *bytes, int numBytes);
+
+public:
+
+    /* Constructor */
+    WAVFile(std::string filePath);
+
+    /* Read the file. Returns false if it can't be read or isn't a supported format. */
+    bool load();
+
+    /* Copy numFrames samples of one channel into outBuffer */
+    void getChannel(int channel, float *outBuffer);
+
+    /* Getters */
+    std::string getPath() { return path; }
+    std::vector<float> &getSamples() { return samples; }
+    int getNumChannels() { return numChannels; }
+    int getNumFrames() { return numFrames; }
+    double getSampleRate() { return sampleRate; }
+};
+
+#endif /* WAVFile_hpp */
@@ -0,0 +1,235 @@
+//
+//  ZoomSpectrumAnalyzer.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#include "ZoomSpectrumAnalyzer.hpp"
+
+/* Decimation factor for a band, before the minimum is applied */
+static int zoomDecimation(float fs, float fMin, float fMax) {
+
+    fMin = fMin < 0.0f ? 0.0f : fMin;
+    fMax = fMax > fs / 2.0f ? fs / 2.0f : fMax;
+    if (fMax <= fMin)
+        return 0;
+
+    return (int)floorf(fs / (kZoomOversample * (fMax - fMin)));
+}
+
+#pragma mark - ZoomSpectrumAnalyzer
+ZoomSpectrumAnalyzer::ZoomSpectrumAnalyzer(float fs, int nChannels, float fMin, float fMax) : sampleRate(fs), numChannels(nChannels), fftSize(kZoomFFTSize), dftSetup(NULL) {
+
+    minFrequency = fMin < 0.0f ? 0.0f : fMin;
+    maxFrequency = fMax > sampleRate / 2.0f ? sampleRate / 2.0f : fMax;
+
+    decimation = zoomDecimation(sampleRate, minFrequency, maxFrequency);
+    if (decimation < kZoomMinDecimation) {
+        printf("%s: Band [%.1f, %.1f] Hz is too wide to zoom at fs = %.0f (decimation %d < %d)\n", __PRETTY_FUNCTION__, fMin, fMax, sampleRate, decimation, kZoomMinDecimation);
+        decimation = 0;
+        numBins = 0;
+        return;
+    }
+
+    centerFrequency = (minFrequency + maxFrequency) / 2.0f;
+    decimatedRate = sampleRate / decimation;
+    hopSize = fftSize / 2;
+    numBins = fftSize / 2;
+
+    /* Oscillator at -centerFrequency, advanced by a complex rotation in double precision */
+    double w = -2.0 * M_PI * centerFrequency / sampleRate;
+    stepRe = cos(w);
+    stepIm = sin(w);
+    oscillatorCos.resize(kZoomMixBlockLength);
+    oscillatorNegSin.resize(kZoomMixBlockLength);
+
+    /* Blackman-windowed sinc low-pass with unity DC gain, cut off halfway between the band edge (decimatedRate / 4) and where aliases begin (3 * decimatedRate / 4) */
+    numTaps = kZoomTapsPerDecimation * decimation + 1;
+    taps.resize(numTaps);
+    float cutoff = 0.5f / decimation;       // Cycles per input sample
+    std::vector<float> blackman(numTaps);
+    vDSP_blkman_window(&blackman[0], numTaps, 0);
+    float sum = 0.0f;
+    for (int i = 0; i < numTaps; i++) {
+        float t = i - (numTaps - 1) / 2.0f;
+        taps[i] = (t == 0.0f ? 2.0f * cutoff : sinf(2.0f * M_PI * cutoff * t) / (M_PI * t)) * blackman[i];
+        sum += taps[i];
+    }
+    float normalize = 1.0f / sum;
+    vDSP_vsmul(&taps[0], 1, &normalize, &taps[0], 1, numTaps);
+
+    /* Mixed input holds at most a filter length plus a decimation period of leftovers, plus one mixing block */
+    int mixedCapacity = numTaps + decimation + kZoomMixBlockLength;
+    mixedRe.resize(numChannels);
+    mixedIm.resize(numChannels);
+    segmentRe.resize(numChannels);
+    segmentIm.resize(numChannels);
+    average.resize(numChannels);
+    for (int i = 0; i < numChannels; i++) {
+        mixedRe[i].resize(mixedCapacity);
+        mixedIm[i].resize(mixedCapacity);
+        segmentRe[i].resize(fftSize);
+        segmentIm[i].resize(fftSize);
+        average[i].resize(numBins);
+    }
+
+    /* FFT buffers and Hann window */
+    window.resize(fftSize);
+    inRe.resize(fftSize);
+    inIm.resize(fftSize);
+    outRe.resize(fftSize);
+    outIm.resize(fftSize);
+    power.resize(fftSize);
+    vDSP_hann_window(&window[0], fftSize, vDSP_HANN_NORM);
+    dftSetup = vDSP_DFT_zop_CreateSetup(NULL, fftSize, vDSP_DFT_FORWARD);
+
+    /* The band is the middle half of the shifted spectrum: offsets [-fftSize/4, fftSize/4) from the center */
+    binFrequencies.resize(numBins);
+    for (int i = 0; i < numBins; i++)
+        binFrequencies[i] = centerFrequency + (i - fftSize / 4) * decimatedRate / fftSize;
+
+    /* A sinusoid of amplitude A mixes down to A/2 at baseband, and the Hann window's coherent gain is 1/2 */
+    scale = 4.0f / fftSize;
+
+    reset();
+}
+
+ZoomSpectrumAnalyzer::~ZoomSpectrumAnalyzer() {
+    if (dftSetup)
+        vDSP_DFT_DestroySetup(dftSetup);
+}
+
+#pragma mark - Interface Methods
+void ZoomSpectrumAnalyzer::process(const float * const *input, int length) {
+
+    if (!isValid())
+        return;
+
+    int offset = 0;
+    while (offset < length) {
+
+        int n = length - offset;
+        n = n > kZoomMixBlockLength ? kZoomMixBlockLength : n;
+
+        /* Oscillator samples for this block, renormalized so rounding doesn't change its amplitude */
+        for (int i = 0; i < n; i++) {
+            oscillatorCos[i] = oscillatorRe;
+            oscillatorNegSin[i] = oscillatorIm;
+            double re = oscillatorRe * stepRe - oscillatorIm * stepIm;
+            oscillatorIm = oscillatorRe * stepIm + oscillatorIm * stepRe;
+            oscillatorRe = re;
+        }
+        double magnitude = sqrt(oscillatorRe * oscillatorRe + oscillatorIm * oscillatorIm);
+        oscillatorRe /= magnitude;
+        oscillatorIm /= magnitude;
+
+        /* Heterodyne */
+        for (int channel = 0; channel < numChannels; channel++) {
+            vDSP_vmul(input[channel] + offset, 1, &oscillatorCos[0], 1, &mixedRe[channel][mixedFill], 1, n);
+            vDSP_vmul(input[channel] + offset, 1, &oscillatorNegSin[0], 1, &mixedIm[channel][mixedFill], 1, n);
+        }
+        mixedFill += n;
+        offset += n;
+
+        decimate();
+    }
+}
+
+void ZoomSpectrumAnalyzer::reset() {
+
+    if (!isValid())
+        return;
+
+    oscillatorRe = 1.0;
+    oscillatorIm = 0.0;
+    mixedFill = 0;
+    segmentFill = 0;
+    numSegments = 0;
+
+    for (int i = 0; i < numChannels; i++)
+        vDSP_vclr(&average[i][0], 1, numBins);
+}
+
+bool ZoomSpectrumAnalyzer::getMagnitude(int channel, float *magnitude) {
+
+    if (!isValid() || channel < 0 || channel >= numChannels) {
+        printf("%s: Invalid channel %d (or invalid band)\n", __PRETTY_FUNCTION__, channel);
+        return false;
+    }
+
+    int n = numBins;
+    vvsqrtf(magnitude, &average[channel][0], &n);
+    vDSP_vsmul(magnitude, 1, &scale, magnitude, 1, numBins);
+    return true;
+}
+
+bool ZoomSpectrumAnalyzer::bandIsZoomable(float fs, float fMin, float fMax) {
+    return zoomDecimation(fs, fMin, fMax) >= kZoomMinDecimation;
+}
+
+#pragma mark - Private Methods
+/* Filter and decimate as much of the mixed input as we can, analyzing each segment as it completes */
+void ZoomSpectrumAnalyzer::decimate() {
+
+    if (mixedFill < numTaps)
+        return;
+
+    int numOutputs = (mixedFill - numTaps) / decimation + 1;
+    int consumed = 0;
+
+    while (numOutputs > 0) {
+
+        int m = fftSize - segmentFill;
+        m = m > numOutputs ? numOutputs : m;
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            vDSP_desamp(&mixedRe[channel][consumed], decimation, &taps[0], &segmentRe[channel][segmentFill], m, numTaps);
+            vDSP_desamp(&mixedIm[channel][consumed], decimation, &taps[0], &segmentIm[channel][segmentFill], m, numTaps);
+        }
+        consumed += m * decimation;
+        segmentFill += m;
+        numOutputs -= m;
+
+        /* Complete segment: analyze it, then slide forward by one hop */
+        if (segmentFill == fftSize) {
+
+            numSegments++;
+            float weight = 1.0f / (numSegments < kZoomAverages ? numSegments : kZoomAverages);
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                analyzeSegment(channel, weight);
+                memmove(&segmentRe[channel][0], &segmentRe[channel][hopSize], (fftSize - hopSize) * sizeof(float));
+                memmove(&segmentIm[channel][0], &segmentIm[channel][hopSize], (fftSize - hopSize) * sizeof(float));
+            }
+            segmentFill = fftSize - hopSize;
+        }
+    }
+
+    /* Keep what the next outputs still need */
+    for (int channel = 0; channel < numChannels; channel++) {
+        memmove(&mixedRe[channel][0], &mixedRe[channel][consumed], (mixedFill - consumed) * sizeof(float));
+        memmove(&mixedIm[channel][0], &mixedIm[channel][consumed], (mixedFill - consumed) * sizeof(float));
+    }
+    mixedFill -= consumed;
+}
+
+/* Power spectrum of a channel's current segment into its average. The first kZoomAverages segments form a plain mean. */
+void ZoomSpectrumAnalyzer::analyzeSegment(int channel, float weight) {
+
+    vDSP_vmul(&segmentRe[channel][0], 1, &window[0], 1, &inRe[0], 1, fftSize);
+    vDSP_vmul(&segmentIm[channel][0], 1, &window[0], 1, &inIm[0], 1, fftSize);
+    vDSP_DFT_Execute(dftSetup, &inRe[0], &inIm[0], &outRe[0], &outIm[0]);
+
+    DSPSplitComplex split;
+    split.realp = &outRe[0];
+    split.imagp = &outIm[0];
+    vDSP_zvmags(&split, 1, &power[0], 1, fftSize);
+
+    /* Bins [fftSize - fftSize/4, fftSize) are the lower half of the band, [0, fftSize/4) the upper half */
+    float *avg = &average[channel][0];
+    int quarter = fftSize / 4;
+    vDSP_vintb(avg, 1, &power[fftSize - quarter], 1, &weight, avg, 1, quarter);
+    vDSP_vintb(avg + quarter, 1, &power[0], 1, &weight, avg + quarter, 1, quarter);
+}
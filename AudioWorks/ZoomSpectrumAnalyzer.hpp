@@ -0,0 +1,114 @@
+//
+//  ZoomSpectrumAnalyzer.hpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+#ifndef ZoomSpectrumAnalyzer_hpp
+#define ZoomSpectrumAnalyzer_hpp
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <Accelerate/Accelerate.h>
+#include <vector>
+
+#define kZoomFFTSize (2048)             // Complex points on the decimated signal; the middle half is the band
+#define kZoomOversample (2.0f)          // Decimated sample rate / band width
+#define kZoomTapsPerDecimation (12)     // Anti-aliasing filter length per unit of decimation
+#define kZoomMinDecimation (4)          // Narrower zoom isn't worth it; use the full-band spectrum
+#define kZoomAverages (4)               // Segments in the (exponential) spectrum average
+#define kZoomMixBlockLength (512)       // Input samples heterodyned at a time
+#define kZoomBandMargin (0.125f)        // Extra band on each side, as a fraction of the visible width, so small pans don't rebuild the analyzer
+#define kZoomRebuildWidthRatio (2.0f)   // Rebuild for finer resolution once the visible band is this much narrower than the analyzed one
+
+/* Zoom-FFT: a high-resolution spectrum of one narrow band, for all input channels.
+
+    The band is mixed down to 0 Hz with a complex oscillator, low-pass filtered and decimated by D (a windowed-sinc FIR evaluated only at the kept samples, with vDSP_desamp), and the decimated complex signal is Hann-windowed and transformed with 50% overlap. The decimated rate is kZoomOversample times the band width, so the middle half of the kZoomFFTSize bins covers the band and the aliasing from the filter's transition band falls outside it. Bins are D times narrower than a full-band FFT of the same size would give, at roughly 2 * kZoomTapsPerDecimation multiply-adds per input sample, and the memory is a full-band transform's divided by about D.
+
+    All buffers are allocated up front; process() doesn't allocate. Changing the band means making a new analyzer. */
+class ZoomSpectrumAnalyzer {
+
+    float sampleRate;
+    int numChannels;
+    float minFrequency;
+    float maxFrequency;
+    float centerFrequency;
+    int decimation;
+    float decimatedRate;
+
+    /* Heterodyne oscillator (shared by all channels) */
+    double oscillatorRe;
+    double oscillatorIm;
+    double stepRe;
+    double stepIm;
+    std::vector<float> oscillatorCos;
+    std::vector<float> oscillatorNegSin;
+
+    /* Anti-aliasing filter and mixed input waiting to be decimated, shared fill count across channels */
+    std::vector<float> taps;
+    int numTaps;
+    std::vector<std::vector<float> > mixedRe;
+    std::vector<std::vector<float> > mixedIm;
+    int mixedFill;
+
+    /* Decimated segments */
+    int fftSize;
+    int hopSize;
+    int numBins;                    // Bins in the band (fftSize / 2)
+    std::vector<std::vector<float> > segmentRe;
+    std::vector<std::vector<float> > segmentIm;
+    int segmentFill;
+    unsigned long numSegments;
+
+    /* FFT */
+    vDSP_DFT_Setup dftSetup;
+    std::vector<float> window;
+    std::vector<float> inRe;
+    std::vector<float> inIm;
+    std::vector<float> outRe;
+    std::vector<float> outIm;
+    std::vector<float> power;
+    std::vector<std::vector<float> > average;   // numBins power values per channel
+    std::vector<float> binFrequencies;
+    float scale;
+
+#pragma mark - Private Methods
+    void decimate();
+    void analyzeSegment(int channel, float weight);
+
+public:
+
+    /* Constructor/Destructor. The band is clamped to [0, fs/2]; check isValid() in case it's too wide to be worth zooming. */
+    ZoomSpectrumAnalyzer(float fs, int nChannels, float fMin, float fMax);
+    ~ZoomSpectrumAnalyzer();
+
+    /* Push a block of non-interleaved input, one row per channel */
+    void process(const float * const *input, int length);
+
+    /* Clear the average, the filter and any partial segment */
+    void reset();
+
+    /* Write numBins magnitudes for a channel, scaled so a sinusoid's peak bin reads its amplitude (as in SpectrumAverager) */
+    bool getMagnitude(int channel, float *magnitude);
+
+    /* Whether a band is narrow enough (relative to fs) for a zoom to be worthwhile */
+    static bool bandIsZoomable(float fs, float fMin, float fMax);
+
+    /* Getters */
+    bool isValid() { return decimation >= kZoomMinDecimation; }
+    int getNumChannels() { return numChannels; }
+    int getNumBins() { return numBins; }
+    int getDecimation() { return decimation; }
+    float getSampleRate() { return sampleRate; }
+    float getMinFrequency() { return minFrequency; }
+    float getMaxFrequency() { return maxFrequency; }
+    float getBinWidth() { return decimatedRate / fftSize; }
+    int getPrimingLength() { return (fftSize - 1) * decimation + numTaps; }   // Input samples behind the first spectrum
+    unsigned long getNumSegments() { return numSegments; }
+    const float *getBinFrequencies() { return &binFrequencies[0]; }
+};
+
+#endif /* ZoomSpectrumAnalyzer_hpp */
@@ -0,0 +1,191 @@
+//
+//  ScopeRender.cpp
+//  AudioWorks
+//
+//  Created by Jeff Gregorio on 10/18/26.
+//  Copyright © 2026 Jeff Gregorio. All rights reserved.
+//
+
+/* Command line front end for ScopeVideoRenderer: draws a recorded session (a multichannel WAV file) to numbered PPM frames, or to a PPM stream on stdout for piping into an encoder, e.g.
+
+    scoperender -r 30 session.wav - | ffmpeg -f image2pipe -c:v ppm -framerate 30 -i - session.mp4
+
+   Needs nothing but a C++11 compiler and POSIX, so sessions can be rendered on a Linux box. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <string>
+
+#include "WAVFile.hpp"
+#include "ScopeVideoRenderer.hpp"
+
+struct FrameWriter {
+    std::string directory;          // Empty for stdout
+    std::vector<unsigned char> row;
+    long numWritten;
+};
+
+static void printUsage(const char *name) {
+
+    fprintf(stderr, "Usage: %s [options] session.wav output_directory|-\n"
+                    "  -s WxH        Frame size (default 1280x720)\n"
+                    "  -r fps        Frame rate (default 60)\n"
+                    "  -t seconds    Time domain window (default 0.1)\n"
+                    "  -n size       FFT size, a power of two (default 2048)\n"
+                    "  -f min:max    Spectrum frequency range in Hz (default 0:12000)\n"
+                    "  -d min:max    Spectrum level range in dB (default -80:0)\n"
+                    "  -c channel    Waterfall channel, counting from 1 (default 1)\n"
+                    "  -v views      Any of t (time domain), s (spectrum) and w (waterfall) (default tsw)\n"
+                    "  -j workers    Rendering threads (default one per core)\n"
+                    "  -i frame      Render just this frame, counting from 0 (e.g. for a thumbnail)\n"
+                    "Frames are written as binary PPM, to output_directory/frame_000000.ppm, ... or one after another to stdout for \"-\".\n", name);
+}
+
+/* Binary PPM. Pixels are RGBA with red in the low byte; alpha is dropped. */
+static bool writePPM(FILE *file, const ScopeColor *pixels, int width, int height, std::vector<unsigned char> &row) {
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+    row.resize(3 * width);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            ScopeColor c = pixels[y * width + x];
+            row[3*x]   = c & 0xFF;
+            row[3*x+1] = (c >> 8) & 0xFF;
+            row[3*x+2] = (c >> 16) & 0xFF;
+        }
+        if (fwrite(&row[0], 1, row.size(), file) != row.size())
+            return false;
+    }
+
+    return true;
+}
+
+static bool writeFrame(long frameIndex, const ScopeColor *pixels, int width, int height, void *userData) {
+
+    FrameWriter *writer = (FrameWriter *)userData;
+
+    if (writer->directory.empty()) {
+        if (!writePPM(stdout, pixels, width, height, writer->row)) {
+            fprintf(stderr, "Couldn't write frame %ld to stdout\n", frameIndex);
+            return false;
+        }
+    }
+    else {
+        char name[32];
+        snprintf(name, sizeof(name), "/frame_%06ld.ppm", frameIndex);
+        std::string path = writer->directory + name;
+
+        FILE *file = fopen(path.c_str(), "wb");
+        if (!file) {
+            fprintf(stderr, "Couldn't open %s\n", path.c_str());
+            return false;
+        }
+        bool written = writePPM(file, pixels, width, height, writer->row);
+        written &= fclose(file) == 0;
+        if (!written) {
+            fprintf(stderr, "Couldn't write %s\n", path.c_str());
+            return false;
+        }
+    }
+
+    writer->numWritten++;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+
+    int width = 1280, height = 720;
+    float frameRate = 60.0f;
+    float timeWindow = 0.1f;
+    int fftSize = 2048;
+    float fMin = -1.0f, fMax = -1.0f;
+    float dBMin = -80.0f, dBMax = 0.0f;
+    int waterfallChannel = 1;
+    const char *views = "tsw";
+    int numWorkers = -1;
+    long singleFrame = -1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:t:n:f:d:c:v:j:i:h")) != -1) {
+
+        bool valid = true;
+        switch (opt) {
+            case 's': valid = sscanf(optarg, "%dx%d", &width, &height) == 2; break;
+            case 'r': frameRate = atof(optarg); break;
+            case 't': timeWindow = atof(optarg); break;
+            case 'n': fftSize = atoi(optarg); break;
+            case 'f': valid = sscanf(optarg, "%f:%f", &fMin, &fMax) == 2; break;
+            case 'd': valid = sscanf(optarg, "%f:%f", &dBMin, &dBMax) == 2; break;
+            case 'c': waterfallChannel = atoi(optarg); break;
+            case 'v': views = optarg; break;
+            case 'j': numWorkers = atoi(optarg); break;
+            case 'i': singleFrame = atol(optarg); break;
+            default: valid = false; break;
+        }
+
+        if (!valid) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (argc - optind != 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    /* Session */
+    WAVFile session(argv[optind]);
+    if (!session.load())
+        return 1;
+
+    int nChannels = session.getNumChannels();
+    int nFrames = session.getNumFrames();
+    std::vector<std::vector<float> > channelData(nChannels, std::vector<float>(nFrames));
+    std::vector<const float *> channels(nChannels);
+    for (int i = 0; i < nChannels; i++) {
+        session.getChannel(i, &channelData[i][0]);
+        channels[i] = &channelData[i][0];
+    }
+    session.getSamples().clear();
+    session.getSamples().shrink_to_fit();
+
+    /* Renderer */
+    ScopeVideoRenderer renderer(&channels[0], nChannels, nFrames, (float)session.getSampleRate());
+
+    bool valid = renderer.setFrameSize(width, height) && renderer.setFrameRate(frameRate) &&
+                 renderer.setTimeWindow(timeWindow) && renderer.setFFTSize(fftSize) &&
+                 renderer.setWaterfallChannel(waterfallChannel - 1);
+    if (fMin >= 0.0f)
+        valid &= renderer.setSpectrumRange(fMin, fMax, dBMin, dBMax);
+    else
+        valid &= renderer.setSpectrumRange(0.0f, 12000.0f, dBMin, dBMax);
+    if (!valid)
+        return 1;
+
+    renderer.setViews(strchr(views, 't') != NULL, strchr(views, 's') != NULL, strchr(views, 'w') != NULL);
+
+    /* Output */
+    FrameWriter writer;
+    writer.numWritten = 0;
+    if (strcmp(argv[optind + 1], "-"))
+        writer.directory = argv[optind + 1];
+
+    fprintf(stderr, "%s: %d channels, %.0f Hz, %.1f s -> %ld frames of %d x %d at %.2f fps\n", argv[optind], nChannels, session.getSampleRate(), nFrames / session.getSampleRate(), renderer.getNumVideoFrames(), width, height, frameRate);
+
+    if (singleFrame >= 0) {
+        ScopeRasterizer raster(width, height);
+        if (!renderer.renderFrame(singleFrame, &raster))
+            return 1;
+        return writeFrame(singleFrame, raster.getPixels(), raster.getWidth(), raster.getHeight(), &writer) ? 0 : 1;
+    }
+
+    bool finished = renderer.render(writeFrame, &writer, numWorkers);
+    fprintf(stderr, "Wrote %ld frames\n", writer.numWritten);
+
+    return finished ? 0 : 1;
+}